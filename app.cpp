@@ -1,8 +1,17 @@
 #include "app.hpp"
+#include "ht_env.hpp"
+#include "ht_object_data.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <exception>
+#include <iostream>
+#include <random>
 #include <stdexcept>
+#include <string>
+#include <thread>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // glm assumes openGl standard, depth [-1,1]
@@ -17,26 +26,282 @@ struct SimplePushConstantData {
   alignas(16) glm::vec3 color;
 };
 
+// bindless mode: objects are fetched from the global table per instance
+struct BindlessPushConstantData {
+  uint32_t objectBuffer; // storage buffer slot in HtBindlessTable
+  uint32_t firstObject;  // index of the first ObjectData for this draw
+};
+
 App::App() {
+  // HT_CULL_BENCH=<object count> reports the CPU culling rate per kernel
+  auto benchObjects = static_cast<uint32_t>(envNumber("HT_CULL_BENCH", 0));
+  if (benchObjects > 0) {
+    HtFrustumCuller::benchmark(benchObjects, &htThreadPool);
+  }
+  // HT_GEOMETRY_POOL_TEST=1 checks freeing and compaction on a small pool
+  if (envFlag("HT_GEOMETRY_POOL_TEST")) {
+    HtGeometryPool::selfTest(htDevice, htUploadScheduler);
+  }
+  // HT_DRAW_STATS=1 periodically prints how many binds the draw queue saved
+  reportDrawStats = envFlag("HT_DRAW_STATS");
+  reportUpdateStats = envFlag("HT_UPDATE_STATS");
+  overdrawActive = envFlag("HT_OVERDRAW");
+  std::string overdrawCsvPath = envString("HT_OVERDRAW_CSV");
+  if (!overdrawCsvPath.empty()) {
+    overdrawCsv.open(overdrawCsvPath);
+    if (!overdrawCsv.is_open()) {
+      throw std::runtime_error("failed to open overdraw csv: " +
+                               overdrawCsvPath);
+    }
+    overdrawCsv << "frame,average_covered,average_screen,max" << std::endl;
+  }
+  htOverdrawView.setRampMax(static_cast<float>(
+      envNumber("HT_OVERDRAW_RAMP", HtOverdrawView::DEFAULT_RAMP_MAX)));
+  // nothing streams large data yet, so pressure is only reported
+  htMemoryBudget.setPressureCallback(
+      [](uint32_t heapIndex, const HtMemoryBudget::Heap &heap,
+         bool underPressure) {
+        std::cout << "memory heap " << heapIndex
+                  << (underPressure ? " under pressure: " : " recovered: ")
+                  << static_cast<int>(heap.load() * 100.0) << "% of budget"
+                  << std::endl;
+      });
+  if (envNumber("HT_GEOMETRY_POOL", 1) != 0) {
+    htGeometryPool = std::make_unique<HtGeometryPool>(
+        htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT, sizeof(HtModel::Vertex));
+  }
   loadModels();
-  // loadSierpinskiModel();
+  if (envFlag("HT_SIERPINSKI")) {
+    loadSierpinskiModel();
+  }
+  loadScene();
+  createBindlessTable();
+  createCommandCache();
+  createIndirectRenderer();
+  createCommandTrace();
+  createReadbackRing();
+  createQueryProfiler();
+  createSubmitThread();
   createPipelineLayout();
-  recreateSwapChain();
+  // a window that starts minimized gets its swap chain from the render loop,
+  // which can wait for a nonzero extent while the main thread pumps events
+  VkExtent2D extent = htWindow.getExtent();
+  if (extent.width != 0 && extent.height != 0) {
+    recreateSwapChain();
+  }
   createCommandBuffers();
 }
 App::~App() {
-  vkDestroyPipelineLayout(htDevice.device(), pipelineLayout, nullptr);
+  vkDestroyPipelineLayout(htDevice.device(), pipelineLayout,
+                          htDevice.allocator());
 }
 
 void App::run() {
-  while (!htWindow.shouldClose()) {
-    glfwPollEvents();
+  std::exception_ptr renderError;
+  std::atomic<bool> rendering{true};
+  std::thread renderThread([&]() {
+    try {
+      renderLoop();
+    } catch (...) {
+      renderError = std::current_exception();
+    }
+    rendering = false;
+    htWindow.wakeEventLoop();
+  });
+
+  // GLFW events have to be handled on the main thread, which does nothing
+  // else so a stalled present never blocks input and vice versa
+  while (rendering && !htWindow.shouldClose()) {
+    htWindow.waitEvents();
+  }
+  renderThread.join();
+  if (renderError) {
+    std::rethrow_exception(renderError);
+  }
+}
+
+void App::renderLoop() {
+  htSimulation.start();
+  while (processWindowEvents()) {
+    if (htSwapChain == nullptr) {
+      recreateSwapChain();
+      continue;
+    }
     drawFrame();
   }
+  htSimulation.stop();
+  // the device wait must not race the submit thread for the queues
+  if (htSubmitThread) {
+    htSubmitThread->flush();
+  }
   vkDeviceWaitIdle(htDevice.device());
 }
 
+// drains the window's event queue, returns false once the window should close
+bool App::processWindowEvents() {
+  HtWindowEvent event;
+  while (htWindow.pollEvent(event)) {
+    switch (event.type) {
+    case HtWindowEvent::Type::Resize:
+      framebufferResized = true;
+      break;
+    case HtWindowEvent::Type::Close:
+      return false;
+    case HtWindowEvent::Type::Key:
+      if (event.key == GLFW_KEY_ESCAPE && event.action == GLFW_PRESS) {
+        htWindow.requestClose();
+        return false;
+      }
+      if (event.key == GLFW_KEY_F12 && event.action == GLFW_PRESS &&
+          htReadbackRing) {
+        requestScreenshot("screenshot_" + std::to_string(frameNumber) +
+                          ".ppm");
+      }
+      if (event.key == GLFW_KEY_F9 && event.action == GLFW_PRESS) {
+        overdrawActive = !overdrawActive;
+        std::cout << "overdraw view " << (overdrawActive ? "on" : "off")
+                  << std::endl;
+      }
+      break;
+    }
+  }
+  // the close event may have been dropped from a full queue
+  return !htWindow.shouldClose();
+}
+
+// large scenes stream all their instance data through the frame allocator
+VkDeviceSize App::frameAllocatorSize() {
+  VkDeviceSize sceneBytes =
+      static_cast<VkDeviceSize>(envNumber("HT_SCENE_OBJECTS", 0)) *
+      sizeof(ObjectData);
+  return std::max(HtFrameAllocator::DEFAULT_BYTES_PER_FRAME,
+                  sceneBytes + 1024 * 1024);
+}
+
+void App::createBindlessTable() {
+  if (!htDevice.bindlessEnabled()) {
+    return;
+  }
+  // the table is the scene layout's only set
+  HtBindlessTable::OtherSets otherSets{};
+  htBindlessTable = std::make_unique<HtBindlessTable>(
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT, otherSets);
+  // per-object data lives in the frame allocator. The whole buffer can
+  // exceed maxStorageBufferRange, so each frame gets a slot over its own
+  // region, clamped like the allocator's own storage binding
+  for (uint32_t i = 0; i < HtSwapChain::MAX_FRAMES_IN_FLIGHT; i++) {
+    frameObjectsSlots.push_back(htBindlessTable->addStorageBuffer(
+        htFrameAllocator.getBuffer(), htFrameAllocator.bytesPerFrame() * i,
+        htFrameAllocator.getStorageRange()));
+  }
+}
+
+void App::createCommandCache() {
+  if (!htBindlessTable || envNumber("HT_COMMAND_CACHE", 1) == 0) {
+    return;
+  }
+  htCommandCache = std::make_unique<HtCommandCache>(
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT);
+}
+
+void App::createIndirectRenderer() {
+  if (!envFlag("HT_INDIRECT")) {
+    return;
+  }
+  if (htBindlessTable) {
+    std::cout << "indirect rendering: ignored in bindless mode" << std::endl;
+    return;
+  }
+  if (!htDevice.multiDrawIndirectEnabled()) {
+    std::cout << "indirect rendering: not supported" << std::endl;
+    return;
+  }
+  htIndirectRenderer = std::make_unique<HtIndirectRenderer>(
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT,
+      std::max(HtIndirectRenderer::DEFAULT_MAX_DRAWS, htScene.size()));
+}
+
+// HT_CAPTURE=<file> writes HT_CAPTURE_FRAMES frames (default 120), starting
+// at frame HT_CAPTURE_START, for replaying with --replay <file>
+void App::createCommandTrace() {
+  std::string filePath = envString("HT_CAPTURE");
+  if (filePath.empty()) {
+    return;
+  }
+  if (htBindlessTable || htIndirectRenderer) {
+    std::cout << "capture: only the draw queue path can be captured"
+              << std::endl;
+    return;
+  }
+  htCommandTrace = std::make_unique<HtCommandTrace>(
+      htDevice, filePath,
+      static_cast<uint64_t>(envNumber("HT_CAPTURE_START", 0)),
+      static_cast<uint32_t>(envNumber("HT_CAPTURE_FRAMES", 120)));
+}
+
+// HT_READBACK=1 makes F12 save a screenshot, HT_SCREENSHOT=<file> also saves
+// frame HT_SCREENSHOT_FRAME (default 60) for image regression checks
+void App::createReadbackRing() {
+  screenshotPath = envString("HT_SCREENSHOT");
+  screenshotFrame = static_cast<uint64_t>(envNumber("HT_SCREENSHOT_FRAME", 60));
+  if (!envFlag("HT_READBACK") && screenshotPath.empty()) {
+    return;
+  }
+  htReadbackRing = std::make_unique<HtReadbackRing>(
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT);
+}
+
+// the file is written on the render thread when the pixels arrive, which is
+// fine for the odd screenshot but not for dumping every frame
+void App::requestScreenshot(const std::string &filePath) {
+  htReadbackRing->request([filePath](const HtReadbackRing::Image &image) {
+    if (HtReadbackRing::writePpm(image, filePath)) {
+      std::cout << "screenshot of frame " << image.frameNumber << " saved to "
+                << filePath << std::endl;
+    }
+  });
+}
+
+void App::createQueryProfiler() {
+  if (!envFlag("HT_QUERY_STATS")) {
+    return;
+  }
+  htQueryProfiler = std::make_unique<HtQueryProfiler>(
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT);
+  htDrawQueue.setProfiler(htQueryProfiler.get());
+}
+
+void App::createSubmitThread() {
+  if (!envFlag("HT_SUBMIT_THREAD")) {
+    return;
+  }
+  htSubmitThread = std::make_unique<HtSubmitThread>(htDevice);
+  std::cout << "submitting and presenting on a separate thread" << std::endl;
+}
+
+// results lag the recorded frame by the frames in flight
+void App::reportQueryStats() {
+  std::cout << "query stats of frame " << htQueryProfiler->resultsFrame()
+            << ":" << std::endl;
+  for (const auto &result : htQueryProfiler->results()) {
+    std::cout << "  " << result.name << ": " << result.samplesPassed
+              << " samples";
+    if (htQueryProfiler->statisticsEnabled()) {
+      std::cout << ", " << result.inputPrimitives << " primitives, "
+                << result.clippedPrimitives() << " clipped, "
+                << result.vertexInvocations << " vertex invocations ("
+                << static_cast<int>(result.vertexReuse() * 100.0)
+                << "% reuse), " << result.fragmentInvocations
+                << " fragment invocations";
+    }
+    std::cout << std::endl;
+  }
+}
+
 void App::createPipelineLayout() {
+  static_assert(sizeof(BindlessPushConstantData) <=
+                    sizeof(SimplePushConstantData),
+                "push constant range must cover both pipelines");
 
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags =
@@ -44,13 +309,25 @@ void App::createPipelineLayout() {
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
+  // set 0: global bindless table or the indirect renderer's object data,
+  // depending on the mode. The push constant path needs no set; per-object
+  // data of the bindless path reaches the frame allocator through a
+  // bindless slot
+  std::vector<VkDescriptorSetLayout> setLayouts;
+  if (htBindlessTable) {
+    setLayouts.push_back(htBindlessTable->getDescriptorSetLayout());
+  } else if (htIndirectRenderer) {
+    setLayouts.push_back(htIndirectRenderer->getDescriptorSetLayout());
+  }
+
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-  pipelineLayoutInfo.setLayoutCount = 0;
-  pipelineLayoutInfo.pSetLayouts = nullptr;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
   pipelineLayoutInfo.pushConstantRangeCount = 1;
   pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo, nullptr,
+  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo,
+                             htDevice.allocator(),
                              &pipelineLayout) != VK_SUCCESS) {
     throw std::runtime_error("failed to create pipeline layout!");
   }
@@ -66,39 +343,98 @@ void App::createPipeline() {
   HtPipeline::defaultPipelineConfigInfo(pipelineConfig);
 
   pipelineConfig.renderPass = htSwapChain->getRenderPass();
+  pipelineConfig.colorAttachmentFormat = htSwapChain->getSwapChainImageFormat();
+  pipelineConfig.depthAttachmentFormat = htSwapChain->getDepthFormat();
   pipelineConfig.pipelineLayout = pipelineLayout;
-  htPipeline = std::make_unique<HtPipeline>(
-      htDevice, "shaders/simple_shader.vert.spv",
-      "shaders/simple_shader.frag.spv", pipelineConfig);
+  if (htBindlessTable) {
+    htPipeline = std::make_unique<HtPipeline>(
+        htDevice, "shaders/bindless_shader.vert.spv",
+        "shaders/bindless_shader.frag.spv", pipelineConfig);
+  } else if (htIndirectRenderer) {
+    htPipeline = std::make_unique<HtPipeline>(
+        htDevice, "shaders/indirect_shader.vert.spv",
+        "shaders/indirect_shader.frag.spv", pipelineConfig);
+  } else {
+    htPipeline = std::make_unique<HtPipeline>(
+        htDevice, "shaders/simple_shader.vert.spv",
+        "shaders/simple_shader.frag.spv", pipelineConfig);
+  }
+
+  // the counting variant keeps the vertex stage of the scene pipeline
+  PipelineConfigInfo overdrawConfig{};
+  HtPipeline::defaultPipelineConfigInfo(overdrawConfig);
+  htOverdrawView.configureScenePipeline(overdrawConfig);
+  overdrawConfig.pipelineLayout = pipelineLayout;
+  overdrawPipeline = std::make_unique<HtPipeline>(
+      htDevice, htPipeline->getVertFilePath(), "shaders/overdraw.frag.spv",
+      overdrawConfig);
+  htOverdrawView.createResolvePipeline(*htSwapChain);
+}
+
+void App::reportOverdraw(const HtOverdrawView::Stats &stats) {
+  if (overdrawCsv.is_open()) {
+    overdrawCsv << stats.frameNumber << ',' << stats.averageCovered << ','
+                << stats.averageScreen << ',' << stats.maxOverdraw << '\n';
+  }
+  if (stats.frameNumber % 120 == 0) {
+    std::cout << "overdraw of frame " << stats.frameNumber << ": "
+              << stats.averageCovered << " average over covered pixels, "
+              << stats.averageScreen << " over the screen, "
+              << stats.maxOverdraw << " max" << std::endl;
+  }
 }
 
 void App::recreateSwapChain() {
+  // minimized, the main thread keeps handling events in the meantime
   auto extent = htWindow.getExtent();
   while (extent.width == 0 || extent.height == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    if (!processWindowEvents()) {
+      return;
+    }
     extent = htWindow.getExtent();
-    glfwWaitEvents();
   }
-  vkDeviceWaitIdle(htDevice.device());
+  auto start = std::chrono::high_resolution_clock::now();
 
+  // no device wait: the old swap chain hands its frame slots to the new one
+  // and is destroyed once the frames that used it have finished
+  bool formatsChanged = true;
   if (htSwapChain == nullptr) {
-    htSwapChain = std::make_unique<HtSwapChain>(htDevice, extent);
+    htSwapChain = std::make_unique<HtSwapChain>(
+        htDevice, extent, htReadbackRing != nullptr, htSubmitThread.get());
   } else {
-    htSwapChain =
-        std::make_unique<HtSwapChain>(htDevice, extent, std::move(htSwapChain));
-    if (htSwapChain->imageCount() != commandBuffers.size()) {
-      freeCommandBuffers();
-      createCommandBuffers();
-    }
+    std::shared_ptr<HtSwapChain> oldSwapChain = std::move(htSwapChain);
+    htSwapChain = std::make_unique<HtSwapChain>(htDevice, extent, oldSwapChain);
+    formatsChanged = !oldSwapChain->compareSwapFormats(*htSwapChain);
+    htDevice.deletionQueue().push(
+        [oldSwapChain]() mutable { oldSwapChain.reset(); });
+  }
+
+  // with dynamic rendering the pipeline only depends on the attachment
+  // formats; a render pass pipeline is rebuilt against the new render pass
+  if (htPipeline == nullptr || !htSwapChain->usesDynamicRendering() ||
+      formatsChanged) {
+    createPipeline();
+  }
+  // recorded scene passes hold the old viewport and maybe the old pipeline
+  if (htCommandCache) {
+    htCommandCache->markDirty();
   }
 
-  // note that if the previous renderpass is compatible, we do not need to
-  // create a new pipeline
-  createPipeline();
+  if (reportUpdateStats) {
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "swap chain recreated in "
+              << std::chrono::duration<float,
+                                       std::chrono::milliseconds::period>(
+                     end - start)
+                     .count()
+              << " ms" << std::endl;
+  }
 }
 
 void App::createCommandBuffers() {
-  commandBuffers.resize(
-      htSwapChain->imageCount()); // 1 command buffer per frame buffer
+  // one per frame in flight, the slot's fence guards re-recording
+  commandBuffers.resize(HtSwapChain::MAX_FRAMES_IN_FLIGHT);
 
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -112,42 +448,92 @@ void App::createCommandBuffers() {
   }
 }
 
-void App::freeCommandBuffers() {
-  vkFreeCommandBuffers(htDevice.device(), htDevice.getCommandPool(),
-                       static_cast<uint32_t>(commandBuffers.size()),
-                       commandBuffers.data());
-  commandBuffers.clear();
-}
-
 void App::recordCommandBuffer(int imageIndex) {
-  static int frame = 0;
-  frame = (frame + 1) % 100;
-
+  VkCommandBuffer commandBuffer =
+      commandBuffers[htSwapChain->getCurrentFrame()];
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-  if (vkBeginCommandBuffer(commandBuffers[imageIndex], &beginInfo) !=
-      VK_SUCCESS) {
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
     throw std::runtime_error("failed to begin recording command buffer!");
   }
+  if (htQueryProfiler) {
+    htQueryProfiler->beginFrame(commandBuffer, htSwapChain->getCurrentFrame(),
+                                frameNumber);
+  }
 
-  VkRenderPassBeginInfo renderPassInfo{};
-  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = htSwapChain->getRenderPass();
-  renderPassInfo.framebuffer = htSwapChain->getFrameBuffer(imageIndex);
+  if (htIndirectRenderer) {
+    // the culling dispatch has to be recorded before the render pass begins
+    addIndirectDraws();
+    htIndirectRenderer->recordCull(commandBuffer);
+  }
 
-  renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = htSwapChain->getSwapChainExtent();
+  // the overdraw view draws the scene into its count target and only the
+  // resolve into the swap chain
+  VkClearColorValue clearColor{{0.01f, 0.01f, 0.01f, 1.0f}};
+  // query scopes are begun per frame, so profiled frames record inline
+  bool cachedScene = htCommandCache && !overdrawActive && !htQueryProfiler;
+  if (overdrawActive) {
+    htOverdrawView.beginCount(commandBuffer);
+  } else {
+    htSwapChain->beginRendering(commandBuffer, imageIndex, clearColor,
+                                cachedScene);
+  }
 
-  std::array<VkClearValue, 2> clearValues{};
-  clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-  clearValues[1].depthStencil = {1.0f, 0};
-  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  renderPassInfo.pClearValues = clearValues.data();
+  // a replay would draw the counting pipelines into a color target
+  HtCommandTrace *trace = nullptr;
+  if (htCommandTrace && !overdrawActive &&
+      htCommandTrace->captures(frameNumber)) {
+    trace = htCommandTrace.get();
+    trace->beginFrame(htSwapChain->getSwapChainExtent(), clearColor);
+  }
+  htDrawQueue.setTrace(trace);
+
+  if (cachedScene) {
+    recordCachedScene(commandBuffer);
+  } else if (htBindlessTable) {
+    recordSceneState(commandBuffer);
+    scenePipeline().bind(commandBuffer);
+    recordBindlessDraws(commandBuffer, writeBindlessInstances());
+  } else if (htIndirectRenderer) {
+    recordSceneState(commandBuffer);
+    scenePipeline().bind(commandBuffer);
+    uint32_t scope = HtQueryProfiler::NO_SCOPE;
+    if (htQueryProfiler) {
+      scope = htQueryProfiler->beginScope(commandBuffer, "indirect draws");
+    }
+    htIndirectRenderer->recordDraws(commandBuffer, pipelineLayout, 0);
+    if (htQueryProfiler) {
+      htQueryProfiler->endScope(commandBuffer, scope);
+    }
+  } else {
+    recordSceneState(commandBuffer);
+    // the draw queue binds pipelines itself
+    recordSceneDraws(commandBuffer);
+  }
 
-  vkCmdBeginRenderPass(commandBuffers[imageIndex], &renderPassInfo,
-                       VK_SUBPASS_CONTENTS_INLINE);
+  if (trace) {
+    trace->endFrame();
+  }
+  if (overdrawActive) {
+    htOverdrawView.endCount(commandBuffer);
+    htSwapChain->beginRendering(commandBuffer, imageIndex, clearColor);
+    htOverdrawView.recordResolve(commandBuffer);
+  }
+  htSwapChain->endRendering(commandBuffer, imageIndex);
+  if (htReadbackRing && htSwapChain->isReadable()) {
+    htReadbackRing->recordCopy(
+        commandBuffer, htSwapChain->getImage(imageIndex),
+        htSwapChain->getSwapChainImageFormat(),
+        htSwapChain->getSwapChainExtent(), frameNumber);
+  }
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+}
 
+// dynamic state, which secondary command buffers do not inherit
+void App::recordSceneState(VkCommandBuffer commandBuffer) {
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
@@ -157,33 +543,181 @@ void App::recordCommandBuffer(int imageIndex) {
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 0.0f;
   VkRect2D scissor{{0, 0}, htSwapChain->getSwapChainExtent()};
-  vkCmdSetViewport(commandBuffers[imageIndex], 0, 1, &viewport);
-  vkCmdSetScissor(commandBuffers[imageIndex], 0, 1, &scissor);
-
-  htPipeline->bind(commandBuffers[imageIndex]);
-  htModel->bind(commandBuffers[imageIndex]);
-  // htModel->draw(commandBuffers[i]);
-  // sierpinskiModel->bind(commandBuffers[imageIndex]);
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
 
-  for (int i = 0; i < 4; i++) {
+// one push constant draw per visible object, culled on the CPU and sorted
+// by the draw queue so only state changes are bound
+void App::recordSceneDraws(VkCommandBuffer commandBuffer) {
+  htFrustumCuller.clear();
+  htScene.writeBounds(htFrustumCuller, renderOffsets.data());
+
+  const glm::vec2 *offsets = renderOffsets.data();
+  const glm::vec3 *colors = htScene.colors();
+  const HtScene::ModelHandle *models = htScene.modelHandles();
+  // scene objects are unscaled, so one level fits every sierpinski object
+  HtModel *sierpinski = nullptr;
+  if (sierpinskiLods) {
+    sierpinski = sierpinskiLods->select(htSwapChain->getSwapChainExtent());
+  }
+  htDrawQueue.clear();
+  for (uint32_t i : htFrustumCuller.cull(&htThreadPool)) {
+    HtModel *model = &htScene.getModel(models[i]);
+    if (sierpinskiLods && models[i] == sierpinskiHandle) {
+      // even the coarsest level is below a pixel
+      if (sierpinski == nullptr) {
+        continue;
+      }
+      model = sierpinski;
+    }
     SimplePushConstantData push{};
-    push.offset = {-0.5f + frame * 0.05f, -0.4f + i * 0.25f};
-    push.color = {0.0f, 0.0f, 0.2f + 0.2f * i};
+    push.offset = offsets[i];
+    push.color = colors[i];
+    htDrawQueue.submit(scenePipeline(), *model, 0.0f, push);
+  }
+  htDrawQueue.record(commandBuffer, pipelineLayout,
+                     VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+
+  const auto &stats = htDrawQueue.lastStats();
+  if (reportDrawStats && frameNumber % 120 == 0) {
+    std::cout << "draw queue: " << stats.draws << " draws, "
+              << stats.pipelineBinds << " pipeline binds, " << stats.modelBinds
+              << " model binds, " << stats.bindsAvoided << " binds avoided"
+              << std::endl;
+    if (sierpinskiLods) {
+      std::cout << "sierpinski: depth " << sierpinskiLods->selectedLevel() + 1
+                << " of " << sierpinskiLods->levelCount() << std::endl;
+    }
+  }
+}
+
+// the scene streams straight into frame allocator memory, one instanced
+// draw per model
+App::BindlessInstances App::writeBindlessInstances() {
+  BindlessInstances instances{};
+  if (htScene.size() == 0) {
+    return instances;
+  }
+  // align to the element size so the allocation can be indexed from the
+  // start of the region the bindless slot points at
+  auto objects = htFrameAllocator.allocateStorage(
+      sizeof(ObjectData) * htScene.size(), sizeof(ObjectData));
+  auto start = std::chrono::steady_clock::now();
+  instances.batches = &htScene.writeInstances(
+      static_cast<ObjectData *>(objects.data), renderOffsets.data(),
+      &htThreadPool);
+  instanceWriteMs = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  // indexed from the start of this frame's region
+  VkDeviceSize frameOffset =
+      objects.dynamicOffset % htFrameAllocator.bytesPerFrame();
+  if (frameOffset + objects.size > htFrameAllocator.getStorageRange()) {
+    throw std::runtime_error("scene objects exceed the storage range!");
+  }
+  instances.objectBuffer = frameObjectsSlots[htSwapChain->getCurrentFrame()];
+  instances.firstObject =
+      static_cast<uint32_t>(frameOffset / sizeof(ObjectData));
+  return instances;
+}
 
-    vkCmdPushConstants(commandBuffers[imageIndex], pipelineLayout,
+void App::recordBindlessDraws(VkCommandBuffer commandBuffer,
+                              const BindlessInstances &instances) {
+  if (instances.batches == nullptr) {
+    return;
+  }
+  htBindlessTable->bind(commandBuffer, pipelineLayout, 0);
+
+  uint32_t batchIndex = 0;
+  HtModel *boundModel = nullptr;
+  for (const auto &batch : *instances.batches) {
+    uint32_t scope = HtQueryProfiler::NO_SCOPE;
+    if (htQueryProfiler) {
+      scope = htQueryProfiler->beginScope(
+          commandBuffer, "bindless batch " + std::to_string(batchIndex));
+    }
+    batchIndex++;
+    BindlessPushConstantData push{};
+    push.objectBuffer = instances.objectBuffer;
+    push.firstObject = instances.firstObject + batch.firstInstance;
+    vkCmdPushConstants(commandBuffer, pipelineLayout,
                        VK_SHADER_STAGE_VERTEX_BIT |
                            VK_SHADER_STAGE_FRAGMENT_BIT,
-                       0, sizeof(SimplePushConstantData), &push);
-    htModel->draw(commandBuffers[imageIndex]);
+                       0, sizeof(BindlessPushConstantData), &push);
+    if (boundModel == nullptr || !batch.model->sharesBuffers(*boundModel)) {
+      batch.model->bind(commandBuffer);
+      boundModel = batch.model;
+    }
+    batch.model->draw(commandBuffer, batch.instanceCount);
+    if (htQueryProfiler) {
+      htQueryProfiler->endScope(commandBuffer, scope);
+    }
   }
+}
 
-  vkCmdEndRenderPass(commandBuffers[imageIndex]);
-  if (vkEndCommandBuffer(commandBuffers[imageIndex]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to record command buffer!");
+// the recorded pass depends on the frame only through the instance batches
+// and where the frame allocator put them; the instances themselves are
+// rewritten every frame. Swap chain and pipeline changes mark it dirty,
+// geometry pool compaction changes the key
+void App::recordCachedScene(VkCommandBuffer commandBuffer) {
+  BindlessInstances instances = writeBindlessInstances();
+  uint64_t key = HtCommandCache::EMPTY_KEY;
+  if (htGeometryPool) {
+    key = HtCommandCache::hashKey(key, htGeometryPool->generation());
+  }
+  if (instances.batches != nullptr) {
+    key = HtCommandCache::hashKey(key, instances.objectBuffer);
+    key = HtCommandCache::hashKey(key, instances.firstObject);
+    for (const auto &batch : *instances.batches) {
+      key = HtCommandCache::hashKey(key,
+                                    reinterpret_cast<uintptr_t>(batch.model));
+      key = HtCommandCache::hashKey(
+          key, (static_cast<uint64_t>(batch.firstInstance) << 32) |
+                   batch.instanceCount);
+    }
+  }
+
+  HtCommandCache::Target target{};
+  target.renderPass = htSwapChain->getRenderPass();
+  target.colorFormat = htSwapChain->getSwapChainImageFormat();
+  target.depthFormat = htSwapChain->getDepthFormat();
+  VkCommandBuffer scene = htCommandCache->record(
+      htSwapChain->getCurrentFrame(), target, key,
+      [&](VkCommandBuffer secondary) {
+        recordSceneState(secondary);
+        scenePipeline().bind(secondary);
+        recordBindlessDraws(secondary, instances);
+      });
+  vkCmdExecuteCommands(commandBuffer, 1, &scene);
+}
+
+void App::addIndirectDraws() {
+  const glm::vec2 *offsets = renderOffsets.data();
+  const glm::vec3 *colors = htScene.colors();
+  const HtScene::ModelHandle *models = htScene.modelHandles();
+  const uint32_t *flags = htScene.flags();
+  for (uint32_t i = 0; i < htScene.size(); i++) {
+    if (flags[i] & HtScene::OBJECT_HIDDEN) {
+      continue;
+    }
+    ObjectData object{};
+    object.offset = offsets[i];
+    object.color = colors[i];
+    htIndirectRenderer->addDraw(htScene.getModel(models[i]), object);
   }
 }
 
 void App::drawFrame() {
+  // the simulation steps on its own thread, frames only blend its snapshots.
+  // Nothing here touches the GPU, so it overlaps a present still running on
+  // the submit thread
+  auto interpolateStart = std::chrono::steady_clock::now();
+  htSimulation.interpolate(renderOffsets, &htThreadPool);
+  interpolateMs = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - interpolateStart)
+                      .count();
+
   uint32_t imageIndex;
   auto result = htSwapChain->acquireNextImage(&imageIndex);
 
@@ -195,14 +729,68 @@ void App::drawFrame() {
   if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
     throw std::runtime_error("failed to acquire swap chain image!");
   }
+  if (htSubmitThread && htSubmitThread->pending() > 0) {
+    overlappedFrames++;
+  }
+
+  // retire finished uploads and kick off everything queued since last frame;
+  // neither call waits on the GPU
+  htUploadScheduler.collect();
+  htUploadScheduler.submit();
+  htMemoryBudget.update(frameNumber);
+  htFrameAllocator.beginFrame(htSwapChain->getCurrentFrame());
+  if (htBindlessTable) {
+    htBindlessTable->beginFrame(htSwapChain->getCurrentFrame());
+  }
+  if (htGeometryPool) {
+    htGeometryPool->beginFrame(htSwapChain->getCurrentFrame());
+  }
+  if (htIndirectRenderer) {
+    htIndirectRenderer->beginFrame(htSwapChain->getCurrentFrame());
+  }
+  if (overdrawActive &&
+      htOverdrawView.beginFrame(htSwapChain->getCurrentFrame(), frameNumber,
+                                htSwapChain->getSwapChainExtent())) {
+    reportOverdraw(htOverdrawView.lastStats());
+  }
+  if (htReadbackRing) {
+    htReadbackRing->beginFrame(htSwapChain->getCurrentFrame());
+    if (!screenshotPath.empty() && frameNumber == screenshotFrame) {
+      requestScreenshot(screenshotPath);
+    }
+  }
 
+  VkCommandBuffer commandBuffer =
+      commandBuffers[htSwapChain->getCurrentFrame()];
   recordCommandBuffer(imageIndex);
-  result = htSwapChain->submitCommandBuffers(&commandBuffers[imageIndex],
-                                             &imageIndex);
+  if (reportUpdateStats && frameNumber % 120 == 0) {
+    // instance writes only happen on the bindless path
+    std::cout << "instance update: " << htScene.size() << " objects, "
+              << interpolateMs << " ms interpolate, " << instanceWriteMs
+              << " ms write, " << htThreadPool.threadCount() << " threads"
+              << std::endl;
+    if (htCommandCache) {
+      const auto &cacheStats = htCommandCache->stats();
+      std::cout << "scene pass: recorded " << cacheStats.recorded
+                << " times, reused " << cacheStats.reused << " times"
+                << std::endl;
+    }
+    if (htSubmitThread) {
+      std::cout << "submit thread: " << overlappedFrames << " of "
+                << frameNumber + 1
+                << " frames recorded while the previous present was queued"
+                << std::endl;
+    }
+  }
+  if (htQueryProfiler && frameNumber % 120 == 0) {
+    reportQueryStats();
+  }
+  frameNumber++;
+  result = htSwapChain->submitCommandBuffers(&commandBuffer, &imageIndex);
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-      htWindow.wasWindowResized()) {
-    htWindow.resetWindowResizedFlag();
+      framebufferResized) {
+    framebufferResized = false;
     recreateSwapChain();
     return;
   }
@@ -216,49 +804,138 @@ void App::loadModels() {
   std::vector<HtModel::Vertex> vertices{{{-0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}},
                                         {{0.0f, -0.5f}, {0.0f, 1.0f, 0.0f}},
                                         {{0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}}};
-  htModel = std::make_unique<HtModel>(htDevice, vertices);
+  if (!htGeometryPool) {
+    htModel = std::make_unique<HtModel>(htDevice, vertices);
+    return;
+  }
+  htModel = std::make_unique<HtModel>(htDevice, *htGeometryPool,
+                                      htUploadScheduler, vertices);
+  // the scene draws the triangle from the first frame on
+  htUploadScheduler.waitIdle();
 }
 
-void recursiveGen(std::vector<HtModel::Vertex> &vertices,
-                  std::vector<glm::vec2> curTriangle, int level) {
-  if (level < 2) {
-    glm::vec2 a = curTriangle[0];
-    glm::vec2 b = curTriangle[1];
-    glm::vec2 c = curTriangle[2];
-
-    glm::vec2 x = 0.5f * (a + b);
-    glm::vec2 y = 0.5f * (b + c);
-    glm::vec2 z = 0.5f * (a + c);
+void App::loadScene() {
+  HtScene::ModelHandle triangle = htScene.addModel(*htModel);
 
-    vertices.emplace_back(HtModel::Vertex{a, {1.0f, 0.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{x, {0.0f, 1.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{z, {0.0f, 0.0f, 1.0f}});
-    std::vector<glm::vec2> Triangle1{a, x, z};
+  // the original four triangles, drifting right and wrapping around
+  htScene.setWrapBounds({-1.5f, -1.5f}, {1.5f, 1.5f});
+  for (int i = 0; i < 4; i++) {
+    htScene.add(triangle, {-0.5f, -0.4f + i * 0.25f},
+                {0.0f, 0.0f, 0.2f + 0.2f * i}, {0.6f, 0.0f});
+  }
 
-    vertices.emplace_back(HtModel::Vertex{x, {1.0f, 0.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{b, {0.0f, 1.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{y, {0.0f, 0.0f, 1.0f}});
-    std::vector<glm::vec2> Triangle2{x, b, y};
+  // the scene holds the coarsest level, the draw queue path swaps in the
+  // level that fits the screen
+  if (sierpinskiLods) {
+    sierpinskiHandle = htScene.addModel(sierpinskiLods->level(0));
+    htScene.add(sierpinskiHandle, {0.0f, 0.0f}, {0.3f, 0.3f, 0.3f});
+  }
 
-    vertices.emplace_back(HtModel::Vertex{z, {1.0f, 0.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{y, {0.0f, 1.0f, 0.0f}});
-    vertices.emplace_back(HtModel::Vertex{c, {0.0f, 0.0f, 1.0f}});
-    std::vector<glm::vec2> Triangle3{z, y, c};
+  // HT_SCENE_OBJECTS=<n> adds n small random movers for stress testing
+  auto extraObjects = static_cast<uint32_t>(envNumber("HT_SCENE_OBJECTS", 0));
+  htScene.reserve(htScene.size() + extraObjects);
+  std::mt19937 rng{42};
+  std::uniform_real_distribution<float> position{-1.5f, 1.5f};
+  std::uniform_real_distribution<float> speed{-0.5f, 0.5f};
+  std::uniform_real_distribution<float> shade{0.2f, 1.0f};
+  for (uint32_t i = 0; i < extraObjects; i++) {
+    htScene.add(triangle, {position(rng), position(rng)},
+                {shade(rng), shade(rng), shade(rng)},
+                {speed(rng), speed(rng)});
+  }
+}
 
-    recursiveGen(vertices, Triangle1, level + 1);
-    recursiveGen(vertices, Triangle2, level + 1);
-    recursiveGen(vertices, Triangle3, level + 1);
+// emits the triangles left after depth subdivisions, each dropping the
+// middle of its parent. Colors follow the position so the corners that
+// neighbouring triangles share are identical vertices
+void recursiveGen(std::vector<HtModel::Vertex> &vertices,
+                  std::vector<glm::vec2> curTriangle, uint32_t depth) {
+  glm::vec2 a = curTriangle[0];
+  glm::vec2 b = curTriangle[1];
+  glm::vec2 c = curTriangle[2];
+  if (depth == 0) {
+    for (glm::vec2 corner : {a, b, c}) {
+      glm::vec2 uv = 0.5f * (corner + glm::vec2{1.0f});
+      vertices.emplace_back(HtModel::Vertex{corner, {uv.x, uv.y, 1.0f}});
+    }
+    return;
   }
+
+  glm::vec2 x = 0.5f * (a + b);
+  glm::vec2 y = 0.5f * (b + c);
+  glm::vec2 z = 0.5f * (a + c);
+  recursiveGen(vertices, {a, x, z}, depth - 1);
+  recursiveGen(vertices, {x, b, y}, depth - 1);
+  recursiveGen(vertices, {z, y, c}, depth - 1);
 }
 
+// every depth is built up front, optimized for the vertex cache in parallel
+// and streamed in through the upload scheduler; deeper levels become
+// selectable as their uploads finish. HT_MESH_OPT=0 uploads the generator
+// order unindexed, HT_MESH_OVERDRAW=1 adds the overdraw sort
 void App::loadSierpinskiModel() {
-  // std::vector<HtModel::Vertex> modelVertices{
-  //     {{-1.0f, 1.0f}}, {{0.0f, -1.0f}}, {{1.0f, 1.0f}}};
-  std::vector<HtModel::Vertex> modelVertices{};
-  std::vector<glm::vec2> vertices{{-1.0f, 1.0f}, {0.0f, -1.0f}, {1.0f, 1.0f}};
+  std::vector<glm::vec2> triangle{{-1.0f, 1.0f}, {0.0f, -1.0f}, {1.0f, 1.0f}};
+
+  std::vector<HtMesh> meshes(SIERPINSKI_MAX_DEPTH);
+  for (uint32_t depth = 1; depth <= SIERPINSKI_MAX_DEPTH; depth++) {
+    recursiveGen(meshes[depth - 1].vertices, triangle, depth);
+  }
+
+  if (envNumber("HT_MESH_OPT", 1) != 0) {
+    HtMeshOptimizer::Options options{};
+    options.optimizeOverdraw = envFlag("HT_MESH_OVERDRAW");
+    auto start = std::chrono::steady_clock::now();
+    auto reports = HtMeshOptimizer{options}.optimize(meshes, htThreadPool);
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    for (uint32_t i = 0; i < reports.size(); i++) {
+      const auto &report = reports[i];
+      std::cout << "sierpinski depth " << i + 1 << ": "
+                << report.triangleCount << " triangles, ACMR "
+                << report.before.acmr << " -> " << report.after.acmr
+                << ", ATVR " << report.before.atvr << " -> "
+                << report.after.atvr << ", " << report.verticesBefore
+                << " -> " << report.verticesAfter << " vertices" << std::endl;
+    }
+    std::cout << "mesh optimization took " << ms << " ms on "
+              << htThreadPool.threadCount() << " threads" << std::endl;
+  }
 
-  recursiveGen(modelVertices, vertices, 1);
-  sierpinskiModel = std::make_unique<HtModel>(htDevice, modelVertices);
+  sierpinskiLods = std::make_unique<HtLodChain>();
+  size_t vertexCount = 0;
+  for (uint32_t depth = 1; depth <= SIERPINSKI_MAX_DEPTH; depth++) {
+    const HtMesh &mesh = meshes[depth - 1];
+    vertexCount += mesh.vertices.size();
+    // the coarsest level is host visible so there is always one to draw
+    std::unique_ptr<HtModel> model;
+    if (depth == 1) {
+      model = mesh.indices.empty()
+                  ? std::make_unique<HtModel>(htDevice, mesh.vertices)
+                  : std::make_unique<HtModel>(htDevice, mesh.vertices,
+                                              mesh.indices);
+    } else if (htGeometryPool) {
+      model = std::make_unique<HtModel>(htDevice, *htGeometryPool,
+                                        htUploadScheduler, mesh.vertices,
+                                        mesh.indices);
+    } else {
+      model = mesh.indices.empty()
+                  ? std::make_unique<HtModel>(htDevice, htUploadScheduler,
+                                              mesh.vertices)
+                  : std::make_unique<HtModel>(htDevice, htUploadScheduler,
+                                              mesh.vertices, mesh.indices);
+    }
+    sierpinskiLods->addLevel(std::move(model), mesh.vertices, mesh.indices);
+  }
+  std::cout << "sierpinski: " << sierpinskiLods->levelCount()
+            << " levels, " << vertexCount << " vertices" << std::endl;
+  if (htGeometryPool) {
+    HtGeometryPool::Stats stats = htGeometryPool->stats();
+    std::cout << "geometry pool: " << stats.blocks << " blocks, "
+              << stats.verticesUsed << "/" << stats.vertexCapacity
+              << " vertices, " << stats.indicesUsed << "/"
+              << stats.indexCapacity << " indices" << std::endl;
+  }
 }
 
 } // namespace ht
\ No newline at end of file
@@ -1,12 +1,34 @@
 #pragma once
 
+#include "ht_bindless_table.hpp"
+#include "ht_command_cache.hpp"
+#include "ht_command_trace.hpp"
 #include "ht_device.hpp"
+#include "ht_draw_queue.hpp"
+#include "ht_frame_allocator.hpp"
+#include "ht_frustum_culler.hpp"
+#include "ht_geometry_pool.hpp"
+#include "ht_indirect_renderer.hpp"
+#include "ht_lod_chain.hpp"
+#include "ht_memory_budget.hpp"
+#include "ht_mesh_optimizer.hpp"
 #include "ht_model.hpp"
+#include "ht_overdraw_view.hpp"
 #include "ht_pipeline.hpp"
+#include "ht_query_profiler.hpp"
+#include "ht_readback_ring.hpp"
+#include "ht_scene.hpp"
+#include "ht_simulation.hpp"
+#include "ht_submit_thread.hpp"
 #include "ht_swap_chain.hpp"
+#include "ht_thread_pool.hpp"
+#include "ht_upload_scheduler.hpp"
 #include "ht_window.hpp"
 
+#include <chrono>
+#include <fstream>
 #include <memory>
+#include <string>
 
 namespace ht {
 class App {
@@ -20,27 +42,118 @@ public:
   App(const App &) = delete;
   App &operator=(const App &) = delete;
 
+  // renders on a separate thread while the calling thread handles window
+  // events, returns once the window is closed
   void run();
 
 private:
   HtWindow htWindow{WIDTH, HEIGHT, "Hello Vulkan!"};
   HtDevice htDevice{htWindow};
+  HtMemoryBudget htMemoryBudget{htDevice};
+  HtUploadScheduler htUploadScheduler{htDevice};
+  // models share its vertex and index buffers, so it has to outlive them;
+  // HT_GEOMETRY_POOL=0 gives every model buffers of its own
+  std::unique_ptr<HtGeometryPool> htGeometryPool;
+  HtFrameAllocator htFrameAllocator{
+      htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT, frameAllocatorSize()};
+  // only created when the device runs in bindless mode (HT_BINDLESS=1)
+  std::unique_ptr<HtBindlessTable> htBindlessTable;
+  // one per frame in flight, each covering that frame's allocator region
+  std::vector<uint32_t> frameObjectsSlots;
+  // bindless mode reuses the recorded scene pass while the instance batches
+  // stay the same, HT_COMMAND_CACHE=0 records it every frame
+  std::unique_ptr<HtCommandCache> htCommandCache;
+  // only created with HT_INDIRECT=1 and multi draw indirect support
+  std::unique_ptr<HtIndirectRenderer> htIndirectRenderer;
+  HtFrustumCuller htFrustumCuller;
+  HtDrawQueue htDrawQueue;
+  // only created with HT_CAPTURE=<file>, captures the draw queue path
+  std::unique_ptr<HtCommandTrace> htCommandTrace;
+  // only created with HT_READBACK=1 or HT_SCREENSHOT=<file>
+  std::unique_ptr<HtReadbackRing> htReadbackRing;
+  std::string screenshotPath;
+  uint64_t screenshotFrame = 0;
+  // only created with HT_QUERY_STATS=1, results are printed periodically
+  std::unique_ptr<HtQueryProfiler> htQueryProfiler;
+  bool reportDrawStats = false;
+  // set from window events on the render thread
+  bool framebufferResized = false;
+  uint64_t frameNumber = 0;
+  // HT_SUBMIT_THREAD=1 moves submit and present off the render thread, set on
+  // every swap chain so it has to outlive them
+  std::unique_ptr<HtSubmitThread> htSubmitThread;
+  // frames whose recording started while the previous present was still
+  // queued, printed with HT_UPDATE_STATS=1
+  uint64_t overlappedFrames = 0;
   std::unique_ptr<HtSwapChain> htSwapChain;
   std::unique_ptr<HtPipeline> htPipeline;
+  // overdraw heat map, toggled with F9 or started with HT_OVERDRAW=1. Every
+  // scene draw then goes through overdrawPipeline, HT_OVERDRAW_CSV=<file>
+  // logs each frame's figures
+  HtOverdrawView htOverdrawView{htDevice, HtSwapChain::MAX_FRAMES_IN_FLIGHT};
+  std::unique_ptr<HtPipeline> overdrawPipeline;
+  bool overdrawActive = false;
+  std::ofstream overdrawCsv;
   VkPipelineLayout pipelineLayout;
   std::vector<VkCommandBuffer> commandBuffers;
 
   std::unique_ptr<HtModel> htModel;
-  std::unique_ptr<HtModel> sierpinskiModel;
+  // HT_SIERPINSKI=1, one level per recursion depth; only the draw queue path
+  // selects levels, the others draw the coarsest
+  static constexpr uint32_t SIERPINSKI_MAX_DEPTH = 9;
+  std::unique_ptr<HtLodChain> sierpinskiLods;
+  HtScene::ModelHandle sierpinskiHandle = 0;
 
+  // splits the per-frame instance update of large scenes
+  HtThreadPool htThreadPool;
+  HtScene htScene;
+  HtSimulation htSimulation{htScene};
+  // object positions blended from the simulation's last two steps
+  std::vector<glm::vec2> renderOffsets;
+  // HT_UPDATE_STATS=1 periodically prints the instance update cost and times
+  // swap chain recreation
+  bool reportUpdateStats = false;
+  double interpolateMs = 0.0;
+  double instanceWriteMs = 0.0;
+
+  static VkDeviceSize frameAllocatorSize();
+  void createBindlessTable();
+  void createCommandCache();
+  void createIndirectRenderer();
+  void createCommandTrace();
+  void createReadbackRing();
+  void requestScreenshot(const std::string &filePath);
+  void createQueryProfiler();
+  void createSubmitThread();
+  void reportQueryStats();
   void createPipelineLayout();
   void createPipeline();
+  HtPipeline &scenePipeline() {
+    return overdrawActive ? *overdrawPipeline : *htPipeline;
+  }
+  void reportOverdraw(const HtOverdrawView::Stats &stats);
   void createCommandBuffers();
-  void freeCommandBuffers();
+  void renderLoop();
+  bool processWindowEvents();
   void drawFrame();
   void loadModels();
   void loadSierpinskiModel();
+  void loadScene();
   void recreateSwapChain();
   void recordCommandBuffer(int imageIndex);
+  void recordSceneState(VkCommandBuffer commandBuffer);
+  void recordSceneDraws(VkCommandBuffer commandBuffer);
+  // this frame's objects in the frame allocator, batches is null for an
+  // empty scene
+  struct BindlessInstances {
+    const std::vector<HtScene::InstanceBatch> *batches = nullptr;
+    uint32_t objectBuffer = 0;
+    uint32_t firstObject = 0;
+  };
+  BindlessInstances writeBindlessInstances();
+  void recordBindlessDraws(VkCommandBuffer commandBuffer,
+                           const BindlessInstances &instances);
+  void recordCachedScene(VkCommandBuffer commandBuffer);
+  void addIndirectDraws();
 };
 } // namespace ht
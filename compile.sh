@@ -1,2 +1,7 @@
 /usr/local/bin/glslc shaders/simple_shader.vert -o shaders/simple_shader.vert.spv
-/usr/local/bin/glslc shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
\ No newline at end of file
+/usr/local/bin/glslc shaders/simple_shader.frag -o shaders/simple_shader.frag.spv
+/usr/local/bin/glslc shaders/bindless_shader.vert -o shaders/bindless_shader.vert.spv
+/usr/local/bin/glslc shaders/bindless_shader.frag -o shaders/bindless_shader.frag.spv
+/usr/local/bin/glslc shaders/indirect_shader.vert -o shaders/indirect_shader.vert.spv
+/usr/local/bin/glslc shaders/indirect_shader.frag -o shaders/indirect_shader.frag.spv
+/usr/local/bin/glslc shaders/cull.comp -o shaders/cull.comp.spv
@@ -0,0 +1,255 @@
+#include "ht_bindless_table.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace ht {
+
+uint32_t HtBindlessTable::SlotAllocator::allocate() {
+  if (!freeSlots.empty()) {
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+  if (nextSlot >= capacity) {
+    throw std::runtime_error("bindless descriptor table is full!");
+  }
+  return nextSlot++;
+}
+
+HtBindlessTable::HtBindlessTable(HtDevice &device, uint32_t frameCount,
+                                 const OtherSets &otherSets,
+                                 uint32_t maxStorageBuffers,
+                                 uint32_t maxSampledImages)
+    : htDevice{device} {
+  assert(htDevice.bindlessEnabled() &&
+         "bindless table needs descriptor indexing (HT_BINDLESS=1)");
+
+  clampToDeviceLimits(otherSets, maxStorageBuffers, maxSampledImages);
+  storageBufferSlots.capacity = maxStorageBuffers;
+  storageBufferSlots.retiredSlots.resize(frameCount);
+  sampledImageSlots.capacity = maxSampledImages;
+  sampledImageSlots.retiredSlots.resize(frameCount);
+
+  createSampler();
+  createDescriptorSetLayout();
+  createDescriptorSet();
+
+  std::cout << "bindless table: " << maxStorageBuffers
+            << " storage buffers, " << maxSampledImages << " sampled images"
+            << std::endl;
+}
+
+HtBindlessTable::~HtBindlessTable() {
+  vkDestroyDescriptorPool(htDevice.device(), descriptorPool,
+                          htDevice.allocator());
+  vkDestroyDescriptorSetLayout(htDevice.device(), descriptorSetLayout,
+                               htDevice.allocator());
+  vkDestroySampler(htDevice.device(), sampler, htDevice.allocator());
+}
+
+void HtBindlessTable::clampToDeviceLimits(const OtherSets &otherSets,
+                                          uint32_t &maxStorageBuffers,
+                                          uint32_t &maxSampledImages) {
+  VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+  indexingProperties.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+  VkPhysicalDeviceProperties2 properties2{};
+  properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  properties2.pNext = &indexingProperties;
+  vkGetPhysicalDeviceProperties2(htDevice.getPhysicalDevice(), &properties2);
+
+  // the per-stage limits cover the whole pipeline layout, the per-set ones
+  // only this set
+  auto remaining = [](uint32_t limit, uint32_t used) {
+    return limit > used ? limit - used : 0;
+  };
+  const auto &limits = indexingProperties;
+  maxStorageBuffers = std::min(
+      {maxStorageBuffers,
+       remaining(limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+                 otherSets.storageBuffers),
+       limits.maxDescriptorSetUpdateAfterBindStorageBuffers});
+  maxSampledImages = std::min(
+      {maxSampledImages,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+       limits.maxDescriptorSetUpdateAfterBindSampledImages});
+
+  // storage buffers and sampled images also share one per-stage budget,
+  // images give way first
+  uint32_t resources = remaining(limits.maxPerStageUpdateAfterBindResources,
+                                 otherSets.resources);
+  maxStorageBuffers = std::min(maxStorageBuffers, resources);
+  maxSampledImages =
+      std::min(maxSampledImages, resources - maxStorageBuffers);
+  if (maxStorageBuffers == 0 || maxSampledImages == 0) {
+    throw std::runtime_error("bindless descriptor limits too small!");
+  }
+}
+
+void HtBindlessTable::createSampler() {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_LINEAR;
+  samplerInfo.minFilter = VK_FILTER_LINEAR;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.anisotropyEnable = VK_FALSE;
+  samplerInfo.maxAnisotropy = 1.0f;
+  samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK;
+  samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = 0.0f;
+
+  if (vkCreateSampler(htDevice.device(), &samplerInfo, htDevice.allocator(),
+                      &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create bindless sampler!");
+  }
+}
+
+void HtBindlessTable::createDescriptorSetLayout() {
+  std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+  bindings[0].binding = STORAGE_BUFFER_BINDING;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[0].descriptorCount = storageBufferSlots.capacity;
+  bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+
+  bindings[1].binding = SAMPLED_IMAGE_BINDING;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  bindings[1].descriptorCount = sampledImageSlots.capacity;
+  bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+  bindings[2].binding = SAMPLER_BINDING;
+  bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
+  bindings[2].descriptorCount = 1;
+  bindings[2].stageFlags = VK_SHADER_STAGE_ALL;
+  bindings[2].pImmutableSamplers = &sampler;
+
+  VkDescriptorBindingFlags arrayFlags =
+      VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+      VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+  std::array<VkDescriptorBindingFlags, 3> bindingFlags = {arrayFlags,
+                                                          arrayFlags, 0};
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+  bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+  bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.pNext = &bindingFlagsInfo;
+  layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(htDevice.device(), &layoutInfo,
+                                  htDevice.allocator(),
+                                  &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create bindless set layout!");
+  }
+}
+
+void HtBindlessTable::createDescriptorSet() {
+  std::array<VkDescriptorPoolSize, 3> poolSizes{};
+  poolSizes[0] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                  storageBufferSlots.capacity};
+  poolSizes[1] = {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+                  sampledImageSlots.capacity};
+  poolSizes[2] = {VK_DESCRIPTOR_TYPE_SAMPLER, 1};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+  poolInfo.maxSets = 1;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+
+  if (vkCreateDescriptorPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                             &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create bindless descriptor pool!");
+  }
+
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &descriptorSetLayout;
+
+  if (vkAllocateDescriptorSets(htDevice.device(), &allocInfo,
+                               &descriptorSet) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate bindless descriptor set!");
+  }
+}
+
+uint32_t HtBindlessTable::addStorageBuffer(VkBuffer buffer,
+                                           VkDeviceSize offset,
+                                           VkDeviceSize range) {
+  uint32_t slot = storageBufferSlots.allocate();
+
+  VkDescriptorBufferInfo bufferInfo{buffer, offset, range};
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = descriptorSet;
+  write.dstBinding = STORAGE_BUFFER_BINDING;
+  write.dstArrayElement = slot;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  write.pBufferInfo = &bufferInfo;
+  vkUpdateDescriptorSets(htDevice.device(), 1, &write, 0, nullptr);
+  return slot;
+}
+
+uint32_t HtBindlessTable::addSampledImage(VkImageView imageView,
+                                          VkImageLayout layout) {
+  uint32_t slot = sampledImageSlots.allocate();
+
+  VkDescriptorImageInfo imageInfo{VK_NULL_HANDLE, imageView, layout};
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = descriptorSet;
+  write.dstBinding = SAMPLED_IMAGE_BINDING;
+  write.dstArrayElement = slot;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+  write.pImageInfo = &imageInfo;
+  vkUpdateDescriptorSets(htDevice.device(), 1, &write, 0, nullptr);
+  return slot;
+}
+
+void HtBindlessTable::removeStorageBuffer(uint32_t slot) {
+  assert(slot < storageBufferSlots.nextSlot && "invalid storage buffer slot");
+  storageBufferSlots.retiredSlots[currentFrame].push_back(slot);
+}
+
+void HtBindlessTable::removeSampledImage(uint32_t slot) {
+  assert(slot < sampledImageSlots.nextSlot && "invalid sampled image slot");
+  sampledImageSlots.retiredSlots[currentFrame].push_back(slot);
+}
+
+void HtBindlessTable::beginFrame(uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  for (SlotAllocator *slots : {&storageBufferSlots, &sampledImageSlots}) {
+    auto &retired = slots->retiredSlots[frameIndex];
+    slots->freeSlots.insert(slots->freeSlots.end(), retired.begin(),
+                            retired.end());
+    retired.clear();
+  }
+}
+
+void HtBindlessTable::bind(VkCommandBuffer commandBuffer,
+                           VkPipelineLayout pipelineLayout, uint32_t set,
+                           VkPipelineBindPoint bindPoint) {
+  vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, set, 1,
+                          &descriptorSet, 0, nullptr);
+}
+
+} // namespace ht
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace ht {
+
+// One global, update-after-bind descriptor set holding every storage buffer
+// and sampled image the renderer uses. Resources are registered once and get
+// a slot index; shaders pick the resource by that index (passed per draw or
+// per instance), so a frame binds descriptors exactly once.
+//
+// Set layout (requires HtDevice::bindlessEnabled()):
+//   binding 0: VK_DESCRIPTOR_TYPE_STORAGE_BUFFER[] (partially bound)
+//   binding 1: VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE[]  (partially bound)
+//   binding 2: VK_DESCRIPTOR_TYPE_SAMPLER, immutable linear clamp sampler
+class HtBindlessTable {
+public:
+  static constexpr uint32_t STORAGE_BUFFER_BINDING = 0;
+  static constexpr uint32_t SAMPLED_IMAGE_BINDING = 1;
+  static constexpr uint32_t SAMPLER_BINDING = 2;
+  static constexpr uint32_t DEFAULT_MAX_STORAGE_BUFFERS = 64 * 1024;
+  static constexpr uint32_t DEFAULT_MAX_SAMPLED_IMAGES = 16 * 1024;
+
+  // descriptors that the other sets of the pipeline layouts using the table
+  // contribute; they count toward the same per-stage limits
+  struct OtherSets {
+    uint32_t storageBuffers = 0;
+    // every buffer and image descriptor, storage buffers included
+    uint32_t resources = 0;
+  };
+
+  HtBindlessTable(HtDevice &device, uint32_t frameCount,
+                  const OtherSets &otherSets,
+                  uint32_t maxStorageBuffers = DEFAULT_MAX_STORAGE_BUFFERS,
+                  uint32_t maxSampledImages = DEFAULT_MAX_SAMPLED_IMAGES);
+  ~HtBindlessTable();
+
+  HtBindlessTable(const HtBindlessTable &) = delete;
+  HtBindlessTable &operator=(const HtBindlessTable &) = delete;
+
+  uint32_t addStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0,
+                            VkDeviceSize range = VK_WHOLE_SIZE);
+  uint32_t addSampledImage(
+      VkImageView imageView,
+      VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  // slots may still be read by frames in flight, they only become reusable
+  // once the same frame index comes around again in beginFrame()
+  void removeStorageBuffer(uint32_t slot);
+  void removeSampledImage(uint32_t slot);
+
+  void beginFrame(uint32_t frameIndex);
+  void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+            uint32_t set,
+            VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+  VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+  uint32_t storageBufferCapacity() { return storageBufferSlots.capacity; }
+  uint32_t sampledImageCapacity() { return sampledImageSlots.capacity; }
+
+private:
+  struct SlotAllocator {
+    uint32_t capacity = 0;
+    uint32_t nextSlot = 0;
+    std::vector<uint32_t> freeSlots;
+    std::vector<std::vector<uint32_t>> retiredSlots; // per frame index
+
+    uint32_t allocate();
+  };
+
+  void clampToDeviceLimits(const OtherSets &otherSets,
+                           uint32_t &maxStorageBuffers,
+                           uint32_t &maxSampledImages);
+  void createSampler();
+  void createDescriptorSetLayout();
+  void createDescriptorSet();
+
+  HtDevice &htDevice;
+  uint32_t currentFrame = 0;
+
+  SlotAllocator storageBufferSlots;
+  SlotAllocator sampledImageSlots;
+
+  VkSampler sampler;
+  VkDescriptorSetLayout descriptorSetLayout;
+  VkDescriptorPool descriptorPool;
+  VkDescriptorSet descriptorSet;
+};
+
+} // namespace ht
@@ -0,0 +1,105 @@
+#include "ht_command_cache.hpp"
+
+// std lib headers
+#include <stdexcept>
+
+namespace ht {
+
+HtCommandCache::HtCommandCache(HtDevice &device, uint32_t frameCount)
+    : htDevice{device}, slots(frameCount) {
+  createCommandPool();
+
+  std::vector<VkCommandBuffer> commandBuffers(frameCount);
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = frameCount;
+  if (vkAllocateCommandBuffers(htDevice.device(), &allocInfo,
+                               commandBuffers.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate cached command buffers!");
+  }
+  for (uint32_t i = 0; i < frameCount; i++) {
+    slots[i].commandBuffer = commandBuffers[i];
+  }
+}
+
+HtCommandCache::~HtCommandCache() {
+  // frees the buffers along with the pool
+  vkDestroyCommandPool(htDevice.device(), commandPool, htDevice.allocator());
+}
+
+void HtCommandCache::createCommandPool() {
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  // buffers are reset one at a time and kept for many frames, so no
+  // TRANSIENT_BIT
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex =
+      htDevice.findPhysicalQueueFamilies().graphicsFamily;
+  if (vkCreateCommandPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                          &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create command cache pool!");
+  }
+}
+
+void HtCommandCache::markDirty() {
+  for (auto &slot : slots) {
+    slot.dirty = true;
+  }
+}
+
+VkCommandBuffer HtCommandCache::record(uint32_t frameIndex,
+                                       const Target &target, uint64_t key,
+                                       const RecordFunction &recordFunction) {
+  Slot &slot = slots[frameIndex];
+  if (!slot.dirty && slot.key == key &&
+      slot.target.renderPass == target.renderPass &&
+      slot.target.colorFormat == target.colorFormat &&
+      slot.target.depthFormat == target.depthFormat) {
+    stats_.reused++;
+    return slot.commandBuffer;
+  }
+
+  // dynamic rendering: the formats have to match the ones the primary
+  // buffer begins rendering with; the swap chain attaches no stencil
+  VkCommandBufferInheritanceRenderingInfoKHR renderingInfo{};
+  renderingInfo.sType =
+      VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachmentFormats = &target.colorFormat;
+  renderingInfo.depthAttachmentFormat = target.depthFormat;
+  renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+  renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  // no framebuffer, so the buffer serves every swap chain image
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  inheritanceInfo.renderPass = target.renderPass;
+  inheritanceInfo.subpass = 0;
+  if (target.renderPass == VK_NULL_HANDLE) {
+    inheritanceInfo.pNext = &renderingInfo;
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+  // beginning implicitly resets the buffer
+  if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
+  recordFunction(slot.commandBuffer);
+  if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+
+  slot.dirty = false;
+  slot.key = key;
+  slot.target = target;
+  stats_.recorded++;
+  return slot.commandBuffer;
+}
+
+} // namespace ht
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ht {
+
+// Secondary command buffers that are recorded once and then executed every
+// frame until they go stale. There is one buffer per frame in flight, so a
+// buffer is only ever re-recorded once the GPU is done with the frame that
+// last executed it.
+//
+// Whatever changes every frame has to reach the recorded commands through
+// buffers. Everything baked into them (pipelines, vertex buffers, descriptor
+// sets, push constants, viewport) is either covered by the key passed to
+// record(), by markDirty() when its object is destroyed or replaced, or must
+// stay valid for as long as the cache lives, like descriptor sets that are
+// never freed or rewritten.
+class HtCommandCache {
+public:
+  // what the buffers continue: a render pass, or the attachment formats of
+  // dynamic rendering when renderPass is null
+  struct Target {
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+  };
+
+  struct Stats {
+    uint64_t recorded = 0;
+    uint64_t reused = 0;
+  };
+
+  using RecordFunction = std::function<void(VkCommandBuffer)>;
+
+  HtCommandCache(HtDevice &device, uint32_t frameCount);
+  ~HtCommandCache();
+
+  HtCommandCache(const HtCommandCache &) = delete;
+  HtCommandCache &operator=(const HtCommandCache &) = delete;
+
+  // every slot records again on its next use
+  void markDirty();
+  // frameIndex's buffer, first re-recorded through recordFunction when the
+  // slot is dirty or was recorded with another key or target. Must only be
+  // called once the GPU is done with frameIndex's previous use
+  VkCommandBuffer record(uint32_t frameIndex, const Target &target,
+                         uint64_t key, const RecordFunction &recordFunction);
+
+  const Stats &stats() const { return stats_; }
+
+  // FNV-1a step for building keys
+  static uint64_t hashKey(uint64_t key, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      key = (key ^ ((value >> (i * 8)) & 0xff)) * 1099511628211ull;
+    }
+    return key;
+  }
+  static constexpr uint64_t EMPTY_KEY = 14695981039346656037ull;
+
+private:
+  struct Slot {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    bool dirty = true;
+    uint64_t key = EMPTY_KEY;
+    Target target;
+  };
+
+  void createCommandPool();
+
+  HtDevice &htDevice;
+  VkCommandPool commandPool;
+  std::vector<Slot> slots;
+  Stats stats_;
+};
+
+} // namespace ht
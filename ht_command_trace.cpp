@@ -0,0 +1,305 @@
+#include "ht_command_trace.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ht {
+
+// file layout: MAGIC, VERSION, then records of
+//   u8 type | u32 payload size | payload
+// Pipeline and model records precede the first frame that references them.
+// Values are stored in host byte order
+static constexpr uint32_t MAGIC = 0x52544854; // "HTTR"
+static constexpr uint32_t VERSION = 1;
+
+template <typename T>
+static void append(std::vector<uint8_t> &bytes, const T &value) {
+  static_assert(std::is_trivially_copyable<T>::value, "raw bytes only");
+  const auto *begin = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+static void appendBytes(std::vector<uint8_t> &bytes, const void *data,
+                        size_t size) {
+  const auto *begin = static_cast<const uint8_t *>(data);
+  bytes.insert(bytes.end(), begin, begin + size);
+}
+
+static void appendString(std::vector<uint8_t> &bytes, const std::string &s) {
+  append(bytes, static_cast<uint32_t>(s.size()));
+  appendBytes(bytes, s.data(), s.size());
+}
+
+namespace {
+// bounds checked reads from a loaded trace
+struct Reader {
+  const uint8_t *data;
+  size_t size;
+  size_t position = 0;
+
+  void readBytes(void *dst, size_t count) {
+    if (count > size - position) {
+      throw std::runtime_error("failed to read trace: truncated record!");
+    }
+    memcpy(dst, data + position, count);
+    position += count;
+  }
+  template <typename T> T read() {
+    T value;
+    readBytes(&value, sizeof(T));
+    return value;
+  }
+  // element count that is checked against the bytes left before anything
+  // is sized by it; elementSize is the smallest encoding of one element
+  uint32_t readCount(size_t elementSize) {
+    uint32_t count = read<uint32_t>();
+    if (count > (size - position) / elementSize) {
+      throw std::runtime_error("failed to read trace: truncated record!");
+    }
+    return count;
+  }
+  // ids are written in first-seen order, so a new one is the next index
+  uint32_t readId(size_t knownIds) {
+    uint32_t id = read<uint32_t>();
+    if (id > knownIds) {
+      throw std::runtime_error("failed to read trace: corrupt id!");
+    }
+    return id;
+  }
+  std::string readString() {
+    std::string s(readCount(1), '\0');
+    readBytes(&s[0], s.size());
+    return s;
+  }
+  bool done() const { return position == size; }
+};
+} // namespace
+
+HtCommandTrace::HtCommandTrace(HtDevice &device, const std::string &filePath,
+                               uint64_t firstFrame, uint32_t frameCount)
+    : htDevice{device}, filePath{filePath},
+      file{filePath, std::ios::binary | std::ios::trunc},
+      firstFrame{firstFrame}, frameCount{frameCount} {
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open trace file: " + filePath);
+  }
+  file.write(reinterpret_cast<const char *>(&MAGIC), sizeof(MAGIC));
+  file.write(reinterpret_cast<const char *>(&VERSION), sizeof(VERSION));
+  bytesWritten = sizeof(MAGIC) + sizeof(VERSION);
+}
+
+uint32_t
+HtCommandTrace::idOf(std::unordered_map<const void *, uint32_t> &ids,
+                     const void *object, bool &added) {
+  auto result = ids.emplace(object, static_cast<uint32_t>(ids.size()));
+  added = result.second;
+  return result.first->second;
+}
+
+void HtCommandTrace::beginFrame(VkExtent2D extent,
+                                const VkClearColorValue &clearColor) {
+  frame.clear();
+  frameCommands = 0;
+  append(frame, extent.width);
+  append(frame, extent.height);
+  append(frame, clearColor);
+  append(frame, frameCommands); // patched in endFrame
+}
+
+void HtCommandTrace::bindPipeline(const HtPipeline &pipeline) {
+  bool added;
+  uint32_t id = idOf(pipelineIds, &pipeline, added);
+  if (added) {
+    std::vector<uint8_t> payload;
+    append(payload, id);
+    appendString(payload, pipeline.getVertFilePath());
+    appendString(payload, pipeline.getFragFilePath());
+    writeRecord(Record::Pipeline, payload);
+  }
+  append(frame, HtTrace::Op::BindPipeline);
+  append(frame, id);
+  frameCommands++;
+}
+
+void HtCommandTrace::bindModel(HtModel &model) {
+  bool added;
+  uint32_t id = idOf(modelIds, &model, added);
+  if (added) {
+    writeModel(id, model);
+  }
+  append(frame, HtTrace::Op::BindModel);
+  append(frame, id);
+  frameCommands++;
+}
+
+void HtCommandTrace::pushConstants(VkShaderStageFlags stages, uint32_t offset,
+                                   uint32_t size, const void *data) {
+  append(frame, HtTrace::Op::PushConstants);
+  append(frame, stages);
+  append(frame, offset);
+  append(frame, size);
+  appendBytes(frame, data, size);
+  frameCommands++;
+}
+
+void HtCommandTrace::draw(uint32_t instanceCount) {
+  append(frame, HtTrace::Op::Draw);
+  append(frame, instanceCount);
+  frameCommands++;
+}
+
+void HtCommandTrace::endFrame() {
+  memcpy(frame.data() + 2 * sizeof(uint32_t) + sizeof(VkClearColorValue),
+         &frameCommands, sizeof(frameCommands));
+  writeRecord(Record::Frame, frame);
+  framesWritten++;
+
+  if (finished()) {
+    file.close();
+    std::cout << "capture: wrote " << framesWritten << " frames, "
+              << bytesWritten << " bytes to " << filePath << std::endl;
+  }
+}
+
+void HtCommandTrace::writeModel(uint32_t id, HtModel &model) {
+  std::vector<HtModel::Vertex> vertices(model.getVertexCount());
+  std::vector<uint32_t> indices(model.getIndexCount());
+  // pooled models are a range of shared buffers; indices stay relative to
+  // the model's first vertex
+  readBuffer(model.getVertexBuffer(),
+             sizeof(HtModel::Vertex) * model.getFirstVertex(),
+             sizeof(HtModel::Vertex) * vertices.size(), vertices.data());
+  if (model.hasIndexBuffer()) {
+    readBuffer(model.getIndexBuffer(), sizeof(uint32_t) * model.getFirstIndex(),
+               sizeof(uint32_t) * indices.size(), indices.data());
+  }
+
+  std::vector<uint8_t> payload;
+  append(payload, id);
+  append(payload, static_cast<uint32_t>(vertices.size()));
+  appendBytes(payload, vertices.data(),
+              sizeof(HtModel::Vertex) * vertices.size());
+  append(payload, static_cast<uint32_t>(indices.size()));
+  appendBytes(payload, indices.data(), sizeof(uint32_t) * indices.size());
+  writeRecord(Record::Model, payload);
+}
+
+// the buffers may be device local, so always go through a staging copy
+void HtCommandTrace::readBuffer(VkBuffer buffer, VkDeviceSize offset,
+                                VkDeviceSize size, void *data) {
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingBufferMemory;
+  htDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        stagingBuffer, stagingBufferMemory);
+  htDevice.copyBuffer(buffer, stagingBuffer, size, offset);
+
+  void *mapped;
+  vkMapMemory(htDevice.device(), stagingBufferMemory, 0, size, 0, &mapped);
+  memcpy(data, mapped, static_cast<size_t>(size));
+  vkUnmapMemory(htDevice.device(), stagingBufferMemory);
+
+  // copyBuffer waited for the queue, nothing else uses the staging buffer
+  vkDestroyBuffer(htDevice.device(), stagingBuffer, htDevice.allocator());
+  vkFreeMemory(htDevice.device(), stagingBufferMemory, htDevice.allocator());
+}
+
+void HtCommandTrace::writeRecord(Record type,
+                                 const std::vector<uint8_t> &payload) {
+  uint32_t size = static_cast<uint32_t>(payload.size());
+  file.write(reinterpret_cast<const char *>(&type), sizeof(type));
+  file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+  file.write(reinterpret_cast<const char *>(payload.data()), size);
+  if (!file) {
+    throw std::runtime_error("failed to write trace file: " + filePath);
+  }
+  bytesWritten += sizeof(type) + sizeof(size) + size;
+}
+
+HtTrace HtCommandTrace::load(const std::string &filePath) {
+  std::vector<char> bytes = HtPipeline::readFile(filePath);
+  Reader file{reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size()};
+  if (file.read<uint32_t>() != MAGIC || file.read<uint32_t>() != VERSION) {
+    throw std::runtime_error("failed to load trace, unknown format: " +
+                             filePath);
+  }
+
+  HtTrace trace;
+  while (!file.done()) {
+    auto type = file.read<Record>();
+    uint32_t size = file.read<uint32_t>();
+    if (size > file.size - file.position) {
+      throw std::runtime_error("failed to read trace: truncated record!");
+    }
+    Reader record{file.data + file.position, size};
+    file.position += size;
+
+    switch (type) {
+    case Record::Pipeline: {
+      uint32_t id = record.readId(trace.pipelines.size());
+      trace.pipelines.resize(std::max<size_t>(trace.pipelines.size(), id + 1));
+      trace.pipelines[id].vertFilePath = record.readString();
+      trace.pipelines[id].fragFilePath = record.readString();
+      break;
+    }
+    case Record::Model: {
+      uint32_t id = record.readId(trace.models.size());
+      trace.models.resize(std::max<size_t>(trace.models.size(), id + 1));
+      HtTrace::Model &model = trace.models[id];
+      model.vertices.resize(record.readCount(sizeof(HtModel::Vertex)));
+      record.readBytes(model.vertices.data(),
+                       sizeof(HtModel::Vertex) * model.vertices.size());
+      model.indices.resize(record.readCount(sizeof(uint32_t)));
+      record.readBytes(model.indices.data(),
+                       sizeof(uint32_t) * model.indices.size());
+      break;
+    }
+    case Record::Frame: {
+      HtTrace::Frame frame;
+      frame.extent.width = record.read<uint32_t>();
+      frame.extent.height = record.read<uint32_t>();
+      frame.clearColor = record.read<VkClearColorValue>();
+      uint32_t commandCount =
+          record.readCount(sizeof(HtTrace::Op) + sizeof(uint32_t));
+      frame.commands.resize(commandCount);
+      for (HtTrace::Command &command : frame.commands) {
+        command.op = record.read<HtTrace::Op>();
+        switch (command.op) {
+        case HtTrace::Op::PushConstants:
+          command.pushStages = record.read<VkShaderStageFlags>();
+          command.pushOffset = record.read<uint32_t>();
+          command.pushSize = record.readCount(1);
+          command.pushData = static_cast<uint32_t>(frame.pushData.size());
+          frame.pushData.resize(frame.pushData.size() + command.pushSize);
+          record.readBytes(frame.pushData.data() + command.pushData,
+                           command.pushSize);
+          break;
+        case HtTrace::Op::BindPipeline:
+        case HtTrace::Op::BindModel:
+        case HtTrace::Op::Draw:
+          command.value = record.read<uint32_t>();
+          break;
+        default:
+          throw std::runtime_error("failed to read trace: unknown command!");
+        }
+      }
+      trace.frames.push_back(std::move(frame));
+      break;
+    }
+    default:
+      // unknown record types are skipped
+      break;
+    }
+  }
+  if (trace.frames.empty()) {
+    throw std::runtime_error("failed to load trace, no frames: " + filePath);
+  }
+  return trace;
+}
+
+} // namespace ht
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "ht_device.hpp"
+#include "ht_model.hpp"
+#include "ht_pipeline.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ht {
+
+// A captured command stream, as loaded by HtCommandTrace::load(). Pipelines
+// and models are referenced by id and stored once, with their shader paths
+// and vertex / index contents, frames only hold the commands.
+struct HtTrace {
+  struct Pipeline {
+    std::string vertFilePath;
+    std::string fragFilePath;
+  };
+
+  struct Model {
+    std::vector<HtModel::Vertex> vertices;
+    std::vector<uint32_t> indices;
+  };
+
+  enum class Op : uint8_t { BindPipeline = 1, BindModel, PushConstants, Draw };
+
+  struct Command {
+    Op op;
+    // pipeline or model id, instance count for Draw
+    uint32_t value = 0;
+    VkShaderStageFlags pushStages = 0;
+    uint32_t pushOffset = 0;
+    uint32_t pushSize = 0;
+    uint32_t pushData = 0; // offset into Frame::pushData
+  };
+
+  struct Frame {
+    VkExtent2D extent;
+    VkClearColorValue clearColor;
+    std::vector<Command> commands;
+    std::vector<uint8_t> pushData;
+  };
+
+  std::vector<Pipeline> pipelines;
+  std::vector<Model> models;
+  std::vector<Frame> frames;
+};
+
+// Writes what the app records between beginFrame() and endFrame() into a
+// compact binary trace, for replaying without the window, scene or
+// simulation (see HtReplayer).
+//
+// A model's buffers are read back from the GPU the first time it is bound,
+// which stalls the graphics queue once per model while capturing.
+class HtCommandTrace {
+public:
+  HtCommandTrace(HtDevice &device, const std::string &filePath,
+                 uint64_t firstFrame, uint32_t frameCount);
+
+  HtCommandTrace(const HtCommandTrace &) = delete;
+  HtCommandTrace &operator=(const HtCommandTrace &) = delete;
+
+  // whether the frame with this number is captured
+  bool captures(uint64_t frameNumber) const {
+    return frameNumber >= firstFrame && framesWritten < frameCount;
+  }
+  bool finished() const { return framesWritten == frameCount; }
+
+  void beginFrame(VkExtent2D extent, const VkClearColorValue &clearColor);
+  void bindPipeline(const HtPipeline &pipeline);
+  void bindModel(HtModel &model);
+  void pushConstants(VkShaderStageFlags stages, uint32_t offset,
+                     uint32_t size, const void *data);
+  void draw(uint32_t instanceCount);
+  void endFrame();
+
+  static HtTrace load(const std::string &filePath);
+
+private:
+  enum class Record : uint8_t { Pipeline = 1, Model, Frame };
+
+  uint32_t idOf(std::unordered_map<const void *, uint32_t> &ids,
+                const void *object, bool &added);
+  void writeModel(uint32_t id, HtModel &model);
+  void readBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+                  void *data);
+  void writeRecord(Record type, const std::vector<uint8_t> &payload);
+
+  HtDevice &htDevice;
+  std::string filePath;
+  std::ofstream file;
+  uint64_t firstFrame;
+  uint32_t frameCount;
+  uint32_t framesWritten = 0;
+  uint64_t bytesWritten = 0;
+
+  std::unordered_map<const void *, uint32_t> pipelineIds;
+  std::unordered_map<const void *, uint32_t> modelIds;
+  std::vector<uint8_t> frame;
+  uint32_t frameCommands = 0;
+};
+
+} // namespace ht
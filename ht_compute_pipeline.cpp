@@ -0,0 +1,61 @@
+#include "ht_compute_pipeline.hpp"
+
+#include "ht_pipeline.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ht {
+HtComputePipeline::HtComputePipeline(HtDevice &device,
+                                     const std::string &compFilePath,
+                                     VkPipelineLayout pipelineLayout)
+    : htDevice{device} {
+  createComputePipeline(compFilePath, pipelineLayout);
+}
+
+HtComputePipeline::~HtComputePipeline() {
+  vkDestroyShaderModule(htDevice.device(), compShaderModule,
+                        htDevice.allocator());
+  vkDestroyPipeline(htDevice.device(), computePipeline, htDevice.allocator());
+}
+
+void HtComputePipeline::createComputePipeline(
+    const std::string &compFilePath, VkPipelineLayout pipelineLayout) {
+  assert(pipelineLayout != VK_NULL_HANDLE &&
+         "Cannot Create compute pipeline [no pipelineLayout provided]");
+
+  auto compCode = HtPipeline::readFile(compFilePath);
+
+  VkShaderModuleCreateInfo moduleInfo{};
+  moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  moduleInfo.codeSize = compCode.size();
+  moduleInfo.pCode = reinterpret_cast<const uint32_t *>(compCode.data());
+
+  if (vkCreateShaderModule(htDevice.device(), &moduleInfo, htDevice.allocator(),
+                           &compShaderModule) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module!");
+  }
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType =
+      VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = compShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+  pipelineInfo.basePipelineIndex = -1;
+
+  if (vkCreateComputePipelines(htDevice.device(), VK_NULL_HANDLE, 1,
+                               &pipelineInfo, htDevice.allocator(),
+                               &computePipeline) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create compute pipeline!");
+  }
+}
+
+void HtComputePipeline::bind(VkCommandBuffer commandBuffer) {
+  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                    computePipeline);
+}
+} // namespace ht
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+#include <string>
+
+namespace ht {
+class HtComputePipeline {
+public:
+  HtComputePipeline(HtDevice &device, const std::string &compFilePath,
+                    VkPipelineLayout pipelineLayout);
+  ~HtComputePipeline();
+
+  HtComputePipeline(const HtComputePipeline &) = delete;
+  HtComputePipeline &operator=(const HtComputePipeline &) = delete;
+
+  void bind(VkCommandBuffer commandBuffer);
+
+private:
+  void createComputePipeline(const std::string &compFilePath,
+                             VkPipelineLayout pipelineLayout);
+
+  HtDevice &htDevice;
+  VkPipeline computePipeline;
+  VkShaderModule compShaderModule;
+};
+} // namespace ht
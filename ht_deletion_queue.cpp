@@ -0,0 +1,29 @@
+#include "ht_deletion_queue.hpp"
+
+// std
+#include <utility>
+
+namespace ht {
+
+void HtDeletionQueue::push(Deleter deleter) {
+  entries.push_back({submittedFrame + 1, std::move(deleter)});
+}
+
+void HtDeletionQueue::collect(uint64_t completedFrame) {
+  while (!entries.empty() && entries.front().frame <= completedFrame) {
+    // pop first, a deleter may push follow-up work
+    Deleter deleter = std::move(entries.front().deleter);
+    entries.pop_front();
+    deleter();
+  }
+}
+
+void HtDeletionQueue::flush() {
+  while (!entries.empty()) {
+    Deleter deleter = std::move(entries.front().deleter);
+    entries.pop_front();
+    deleter();
+  }
+}
+
+} // namespace ht
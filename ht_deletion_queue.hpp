@@ -0,0 +1,47 @@
+#pragma once
+
+// std lib headers
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+namespace ht {
+
+// Defers the destruction of GPU objects until every frame that could still
+// use them has finished, so nothing needs vkDeviceWaitIdle at runtime.
+//
+// Frames are numbered from 1 in submission order. The swap chain reports
+// submissions and completions, so the counters carry over swap chain
+// recreation.
+class HtDeletionQueue {
+public:
+  using Deleter = std::function<void()>;
+
+  HtDeletionQueue() = default;
+
+  HtDeletionQueue(const HtDeletionQueue &) = delete;
+  HtDeletionQueue &operator=(const HtDeletionQueue &) = delete;
+
+  // runs deleter once all submitted frames and the one being recorded are done
+  void push(Deleter deleter);
+  void frameSubmitted() { submittedFrame++; }
+  // every frame up to and including completedFrame has finished on the GPU
+  void collect(uint64_t completedFrame);
+  // runs every pending deleter, the device must be idle
+  void flush();
+
+  uint64_t submittedFrames() const { return submittedFrame; }
+  size_t pending() const { return entries.size(); }
+
+private:
+  struct Entry {
+    uint64_t frame;
+    Deleter deleter;
+  };
+
+  // frame numbers never decrease, so the oldest entry is always in front
+  std::deque<Entry> entries;
+  uint64_t submittedFrame = 0;
+};
+
+} // namespace ht
@@ -1,6 +1,11 @@
 #include "ht_device.hpp"
 
+#include "ht_env.hpp"
+
 // std headers
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -44,6 +49,12 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance,
 
 // class member functions
 HtDevice::HtDevice(HtWindow &window) : window{window} {
+  // HT_HOST_ALLOC_POOL=1 also serves small command and object scope
+  // allocations from free lists
+  if (envFlag("HT_HOST_ALLOC") || envFlag("HT_HOST_ALLOC_POOL")) {
+    hostAllocator =
+        std::make_unique<HtHostAllocator>(envFlag("HT_HOST_ALLOC_POOL"));
+  }
   createInstance();
   setupDebugMessenger();
   createSurface();
@@ -53,15 +64,22 @@ HtDevice::HtDevice(HtWindow &window) : window{window} {
 }
 
 HtDevice::~HtDevice() {
-  vkDestroyCommandPool(device_, commandPool, nullptr);
-  vkDestroyDevice(device_, nullptr);
+  // the application waits for the device before tearing down
+  deletionQueue_.flush();
+  vkDestroyCommandPool(device_, commandPool, allocator());
+  vkDestroyDevice(device_, allocator());
 
   if (enableValidationLayers) {
-    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
+    DestroyDebugUtilsMessengerEXT(instance, debugMessenger, allocator());
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
-  vkDestroyInstance(instance, nullptr);
+  vkDestroySurfaceKHR(instance, surface_, allocator());
+  vkDestroyInstance(instance, allocator());
+
+  if (hostAllocator) {
+    hostAllocator->printStats();
+    hostAllocator->reportLeaks();
+  }
 }
 
 void HtDevice::createInstance() {
@@ -75,7 +93,7 @@ void HtDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -98,7 +116,7 @@ void HtDevice::createInstance() {
     createInfo.pNext = nullptr;
   }
 
-  if (vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS) {
+  if (vkCreateInstance(&createInfo, allocator(), &instance) != VK_SUCCESS) {
     throw std::runtime_error("failed to create instance!");
   }
 
@@ -115,15 +133,68 @@ void HtDevice::pickPhysicalDevice() {
   std::vector<VkPhysicalDevice> devices(deviceCount);
   vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-  for (const auto &device : devices) {
+  // HT_DEVICE=<index> or HT_DEVICE=<name substring> overrides the scoring
+  std::string deviceOverride = envString("HT_DEVICE");
+  bool deviceOverrideIsIndex =
+      !deviceOverride.empty() &&
+      deviceOverride.find_first_not_of("0123456789") == std::string::npos;
+  unsigned long deviceOverrideIndex = 0;
+  if (deviceOverrideIsIndex) {
+    errno = 0;
+    deviceOverrideIndex = std::strtoul(deviceOverride.c_str(), nullptr, 10);
+    // too large for any device, so it matches none
+    if (errno == ERANGE) {
+      deviceOverrideIndex = deviceCount;
+    }
+  }
 
-    if (isDeviceSuitable(device)) {
-      physicalDevice = device;
-      break;
+  int64_t bestScore = -1;
+  VkPhysicalDevice overrideDevice = VK_NULL_HANDLE;
+  for (uint32_t i = 0; i < deviceCount; i++) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(devices[i], &deviceProperties);
+
+    int64_t score = rateDeviceSuitability(devices[i]);
+    std::cout << "\t[" << i << "] " << deviceProperties.deviceName
+              << " score: ";
+    if (score < 0) {
+      std::cout << "unsuitable" << std::endl;
+    } else {
+      std::cout << score << std::endl;
     }
+
+    std::string deviceName{deviceProperties.deviceName};
+    bool matchesOverride =
+        deviceOverrideIsIndex
+            ? deviceOverrideIndex == i
+            : !deviceOverride.empty() &&
+                  deviceName.find(deviceOverride) != std::string::npos;
+    if (matchesOverride && overrideDevice == VK_NULL_HANDLE) {
+      if (score < 0) {
+        std::cerr << "HT_DEVICE=" << deviceOverride
+                  << " matches unsuitable device " << deviceName
+                  << ", ignoring" << std::endl;
+      } else {
+        overrideDevice = devices[i];
+      }
+    }
+
+    if (score > bestScore) {
+      bestScore = score;
+      physicalDevice = devices[i];
+    }
+  }
+
+  if (overrideDevice != VK_NULL_HANDLE) {
+    physicalDevice = overrideDevice;
+  } else if (!deviceOverride.empty()) {
+    std::cerr << "HT_DEVICE=" << deviceOverride
+              << " did not match a suitable device, using highest score"
+              << std::endl;
   }
 
-  if (physicalDevice == VK_NULL_HANDLE) {
+  if (bestScore < 0) {
+    physicalDevice = VK_NULL_HANDLE;
     throw std::runtime_error("failed to find a suitable GPU!");
   }
 
@@ -137,6 +208,9 @@ void HtDevice::createLogicalDevice() {
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily,
                                             indices.presentFamily};
+  if (indices.transferFamilyHasValue) {
+    uniqueQueueFamilies.insert(indices.transferFamily);
+  }
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -148,8 +222,76 @@ void HtDevice::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
+  // indirect draws with many records, each addressing its object through
+  // firstInstance
+  if (supportedFeatures.multiDrawIndirect &&
+      supportedFeatures.drawIndirectFirstInstance) {
+    deviceFeatures.multiDrawIndirect = VK_TRUE;
+    deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    multiDrawIndirectEnabled_ = true;
+  }
+  // per-batch pipeline statistics and exact sample counts for
+  // HtQueryProfiler, only requested when profiling
+  if (envFlag("HT_QUERY_STATS")) {
+    deviceFeatures.pipelineStatisticsQuery =
+        supportedFeatures.pipelineStatisticsQuery;
+    deviceFeatures.occlusionQueryPrecise =
+        supportedFeatures.occlusionQueryPrecise;
+    pipelineStatisticsEnabled_ = supportedFeatures.pipelineStatisticsQuery;
+    preciseOcclusionEnabled_ = supportedFeatures.occlusionQueryPrecise;
+    std::cout << "pipeline statistics queries: "
+              << (pipelineStatisticsEnabled_ ? "enabled" : "not supported")
+              << std::endl;
+  }
+
+  std::vector<const char *> enabledExtensions = deviceExtensions;
+  void *featureChain = nullptr;
+
+  // the extension works on 1.1 and 1.2 devices alike without an extra feature
+  // struct in the chain
+  bool drawIndirectCountSupported = isDeviceExtensionSupported(
+      physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  if (drawIndirectCountSupported) {
+    enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+  }
+
+  // heap usage and budgets for HtMemoryBudget, a query-only extension
+  memoryBudgetEnabled_ = isDeviceExtensionSupported(
+      physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  if (memoryBudgetEnabled_) {
+    enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+  indexingFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  if (envFlag("HT_BINDLESS")) {
+    if (enableDescriptorIndexing(indexingFeatures, enabledExtensions)) {
+      indexingFeatures.pNext = featureChain;
+      featureChain = &indexingFeatures;
+      bindlessEnabled_ = true;
+    }
+    std::cout << "bindless descriptors: "
+              << (bindlessEnabled_ ? "enabled" : "not supported") << std::endl;
+  }
+
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+  dynamicRenderingFeatures.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  bool dynamicRendering = false;
+  if (envFlag("HT_DYNAMIC_RENDERING")) {
+    dynamicRendering =
+        enableDynamicRendering(dynamicRenderingFeatures, enabledExtensions);
+    if (dynamicRendering) {
+      dynamicRenderingFeatures.pNext = featureChain;
+      featureChain = &dynamicRenderingFeatures;
+    }
+  }
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -158,10 +300,11 @@ void HtDevice::createLogicalDevice() {
       static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+  createInfo.pNext = featureChain;
   createInfo.pEnabledFeatures = &deviceFeatures;
   createInfo.enabledExtensionCount =
-      static_cast<uint32_t>(deviceExtensions.size());
-  createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+      static_cast<uint32_t>(enabledExtensions.size());
+  createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
   // might not really be necessary anymore because device specific validation
   // layers have been deprecated
@@ -173,13 +316,118 @@ void HtDevice::createLogicalDevice() {
     createInfo.enabledLayerCount = 0;
   }
 
-  if (vkCreateDevice(physicalDevice, &createInfo, nullptr, &device_) !=
+  if (vkCreateDevice(physicalDevice, &createInfo, allocator(), &device_) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create logical device!");
   }
 
+  if (drawIndirectCountSupported) {
+    drawIndirectCount_ = reinterpret_cast<PFN_vkCmdDrawIndirectCountKHR>(
+        vkGetDeviceProcAddr(device_, "vkCmdDrawIndirectCountKHR"));
+    drawIndexedIndirectCount_ =
+        reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdDrawIndexedIndirectCountKHR"));
+  }
+  if (dynamicRendering) {
+    beginRendering_ = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+        vkGetDeviceProcAddr(device_, "vkCmdBeginRenderingKHR"));
+    endRendering_ = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+        vkGetDeviceProcAddr(device_, "vkCmdEndRenderingKHR"));
+  }
+  if (envFlag("HT_DYNAMIC_RENDERING")) {
+    std::cout << "dynamic rendering: "
+              << (dynamicRenderingEnabled() ? "enabled" : "not supported")
+              << std::endl;
+  }
+  std::cout << "multi draw indirect: "
+            << (multiDrawIndirectEnabled_ ? "yes" : "no")
+            << ", draw indirect count: "
+            << (drawIndirectCountEnabled() ? "yes" : "no")
+            << ", memory budget: " << (memoryBudgetEnabled_ ? "yes" : "no")
+            << std::endl;
+
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  if (indices.transferFamilyHasValue) {
+    vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+    std::cout << "dedicated transfer queue family: " << indices.transferFamily
+              << std::endl;
+  } else {
+    transferQueue_ = graphicsQueue_;
+  }
+}
+
+// descriptor indexing is core in 1.2, older devices need the extension. Only
+// the subset used by HtBindlessTable is requested
+bool HtDevice::enableDescriptorIndexing(
+    VkPhysicalDeviceDescriptorIndexingFeatures &features,
+    std::vector<const char *> &extensions) {
+  bool core = properties.apiVersion >= VK_API_VERSION_1_2;
+  bool hasExtension = isDeviceExtensionSupported(
+      physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+  if (properties.apiVersion < VK_API_VERSION_1_1 || (!core && !hasExtension)) {
+    return false;
+  }
+
+  VkPhysicalDeviceDescriptorIndexingFeatures supported{};
+  supported.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &supported;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+  if (!supported.runtimeDescriptorArray ||
+      !supported.descriptorBindingPartiallyBound ||
+      !supported.descriptorBindingUpdateUnusedWhilePending ||
+      !supported.descriptorBindingStorageBufferUpdateAfterBind ||
+      !supported.descriptorBindingSampledImageUpdateAfterBind ||
+      !supported.shaderStorageBufferArrayNonUniformIndexing ||
+      !supported.shaderSampledImageArrayNonUniformIndexing) {
+    return false;
+  }
+
+  features.runtimeDescriptorArray = VK_TRUE;
+  features.descriptorBindingPartiallyBound = VK_TRUE;
+  features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+  if (!core) {
+    extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+    extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+  }
+  return true;
+}
+
+// the extension depends on create_renderpass2 and depth_stencil_resolve,
+// which are core in 1.2. The instance targets 1.2, so the 1.3 core entry
+// points are not used even on newer devices
+bool HtDevice::enableDynamicRendering(
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR &features,
+    std::vector<const char *> &extensions) {
+  if (properties.apiVersion < VK_API_VERSION_1_2 ||
+      !isDeviceExtensionSupported(physicalDevice,
+                                  VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+    return false;
+  }
+
+  VkPhysicalDeviceDynamicRenderingFeaturesKHR supported{};
+  supported.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+  VkPhysicalDeviceFeatures2 features2{};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &supported;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+  if (!supported.dynamicRendering) {
+    return false;
+  }
+
+  features.dynamicRendering = VK_TRUE;
+  extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+  return true;
 }
 
 void HtDevice::createCommandPool() {
@@ -191,17 +439,16 @@ void HtDevice::createCommandPool() {
   poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
                    VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) !=
+  if (vkCreateCommandPool(device_, &poolInfo, allocator(), &commandPool) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create command pool!");
   }
 }
 
 void HtDevice::createSurface() {
-  window.createWindowSurface(instance, &surface_);
+  window.createWindowSurface(instance, &surface_, allocator());
 }
 
-// currently we require that a suitable GPU be discrete
 bool HtDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
@@ -217,12 +464,79 @@ bool HtDevice::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
+         supportedFeatures.samplerAnisotropy;
+}
+
+// returns -1 for unsuitable devices. The device type dominates the score, the
+// remaining terms are capped so they only order devices of the same type
+int64_t HtDevice::rateDeviceSuitability(VkPhysicalDevice device) {
+  if (!isDeviceSuitable(device)) {
+    return -1;
+  }
+
   VkPhysicalDeviceProperties deviceProperties;
   vkGetPhysicalDeviceProperties(device, &deviceProperties);
 
-  return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy &&
-         deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+  int64_t score = 0;
+  switch (deviceProperties.deviceType) {
+  case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+    score += 100000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+    score += 50000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+    score += 20000;
+    break;
+  case VK_PHYSICAL_DEVICE_TYPE_CPU:
+    score += 1000;
+    break;
+  default:
+    break;
+  }
+
+  // device-local memory, 1 point per 16 MiB up to 64 GiB
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(device, &memProperties);
+  VkDeviceSize deviceLocalBytes = 0;
+  for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++) {
+    if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+      deviceLocalBytes += memProperties.memoryHeaps[i].size;
+    }
+  }
+  score += static_cast<int64_t>(
+      std::min<VkDeviceSize>(deviceLocalBytes / (16ull << 20), 4096));
+
+  // dedicated transfer / async compute families let copies and compute
+  // overlap graphics work
+  uint32_t queueFamilyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount,
+                                           queueFamilies.data());
+  bool hasTransferOnly = false;
+  bool hasAsyncCompute = false;
+  for (const auto &queueFamily : queueFamilies) {
+    VkQueueFlags flags = queueFamily.queueFlags;
+    if ((flags & VK_QUEUE_TRANSFER_BIT) &&
+        !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+      hasTransferOnly = true;
+    }
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT)) {
+      hasAsyncCompute = true;
+    }
+  }
+  score += hasTransferOnly ? 500 : 0;
+  score += hasAsyncCompute ? 500 : 0;
+
+  // key limits
+  const VkPhysicalDeviceLimits &limits = deviceProperties.limits;
+  score += limits.maxImageDimension2D / 1024;
+  score += limits.maxPushConstantsSize / 32;
+  score += std::min<uint32_t>(limits.maxBoundDescriptorSets, 32);
+
+  return score;
 }
 
 void HtDevice::populateDebugMessengerCreateInfo(
@@ -243,7 +557,7 @@ void HtDevice::setupDebugMessenger() {
     return;
   VkDebugUtilsMessengerCreateInfoEXT createInfo;
   populateDebugMessengerCreateInfo(createInfo);
-  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, nullptr,
+  if (CreateDebugUtilsMessengerEXT(instance, &createInfo, allocator(),
                                    &debugMessenger) != VK_SUCCESS) {
     throw std::runtime_error("failed to set up debug messenger!");
   }
@@ -332,6 +646,24 @@ bool HtDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
   return requiredExtensions.empty();
 }
 
+bool HtDevice::isDeviceExtensionSupported(VkPhysicalDevice device,
+                                          const char *extension) {
+  uint32_t extensionCount;
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       nullptr);
+
+  std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+  vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount,
+                                       availableExtensions.data());
+
+  for (const auto &available : availableExtensions) {
+    if (strcmp(available.extensionName, extension) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
 QueueFamilyIndices HtDevice::findQueueFamilies(VkPhysicalDevice device) {
   QueueFamilyIndices indices;
 
@@ -345,18 +677,30 @@ QueueFamilyIndices HtDevice::findQueueFamilies(VkPhysicalDevice device) {
   int i = 0;
   for (const auto &queueFamily : queueFamilies) {
     if (queueFamily.queueCount > 0 &&
-        queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT &&
+        !indices.graphicsFamilyHasValue) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
     vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
-    if (queueFamily.queueCount > 0 && presentSupport) {
+    if (queueFamily.queueCount > 0 && presentSupport &&
+        !indices.presentFamilyHasValue) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
     }
-    if (indices.isComplete()) {
-      break;
+
+    // prefer a transfer-only family (usually the copy engine), otherwise any
+    // non-graphics family that can transfer
+    bool canTransfer = queueFamily.queueFlags &
+                       (VK_QUEUE_TRANSFER_BIT | VK_QUEUE_COMPUTE_BIT);
+    bool isGraphics = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    bool isCompute = queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT;
+    if (queueFamily.queueCount > 0 && canTransfer && !isGraphics) {
+      if (!indices.transferFamilyHasValue || !isCompute) {
+        indices.transferFamily = i;
+        indices.transferFamilyHasValue = true;
+      }
     }
 
     i++;
@@ -424,6 +768,19 @@ uint32_t HtDevice::findMemoryType(uint32_t typeFilter,
   throw std::runtime_error("failed to find suitable memory type!");
 }
 
+bool HtDevice::hasMemoryType(uint32_t typeFilter,
+                             VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties memProperties;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+  for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags &
+                                    properties) == properties) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void HtDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                             VkMemoryPropertyFlags properties, VkBuffer &buffer,
                             VkDeviceMemory &bufferMemory) {
@@ -433,7 +790,8 @@ void HtDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   bufferInfo.usage = usage;
   bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-  if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+  if (vkCreateBuffer(device_, &bufferInfo, allocator(), &buffer) !=
+      VK_SUCCESS) {
     throw std::runtime_error("failed to create vertex buffer!");
   }
 
@@ -446,7 +804,7 @@ void HtDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   allocInfo.memoryTypeIndex =
       findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) !=
+  if (vkAllocateMemory(device_, &allocInfo, allocator(), &bufferMemory) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate vertex buffer memory!");
   }
@@ -454,6 +812,16 @@ void HtDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
   vkBindBufferMemory(device_, buffer, bufferMemory, 0);
 }
 
+std::mutex &HtDevice::queueMutex(VkQueue queue) {
+  if (queue == graphicsQueue_) {
+    return graphicsQueueMutex;
+  }
+  if (queue == presentQueue_) {
+    return presentQueueMutex;
+  }
+  return transferQueueMutex;
+}
+
 VkCommandBuffer HtDevice::beginSingleTimeCommands() {
   VkCommandBufferAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -480,18 +848,21 @@ void HtDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+  {
+    std::lock_guard<std::mutex> lock{queueMutex(graphicsQueue_)};
+    vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
+    vkQueueWaitIdle(graphicsQueue_);
+  }
 
   vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
 }
 
 void HtDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer,
-                          VkDeviceSize size) {
+                          VkDeviceSize size, VkDeviceSize srcOffset) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
   VkBufferCopy copyRegion{};
-  copyRegion.srcOffset = 0; // Optional
+  copyRegion.srcOffset = srcOffset;
   copyRegion.dstOffset = 0; // Optional
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
@@ -525,7 +896,7 @@ void HtDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
                                    VkMemoryPropertyFlags properties,
                                    VkImage &image,
                                    VkDeviceMemory &imageMemory) {
-  if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+  if (vkCreateImage(device_, &imageInfo, allocator(), &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
 
@@ -538,7 +909,7 @@ void HtDevice::createImageWithInfo(const VkImageCreateInfo &imageInfo,
   allocInfo.memoryTypeIndex =
       findMemoryType(memRequirements.memoryTypeBits, properties);
 
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) !=
+  if (vkAllocateMemory(device_, &allocInfo, allocator(), &imageMemory) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to allocate image memory!");
   }
@@ -1,8 +1,12 @@
 #pragma once
 
+#include "ht_deletion_queue.hpp"
+#include "ht_host_allocator.hpp"
 #include "ht_window.hpp"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,8 +21,10 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  uint32_t transferFamily; // only set for a family without graphics support
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
@@ -39,17 +45,36 @@ public:
   HtDevice(HtDevice &&) = delete;
   HtDevice &operator=(HtDevice &&) = delete;
 
+  // host allocation callbacks for every Vulkan create and destroy call, null
+  // (the driver's allocator) unless HT_HOST_ALLOC=1
+  const VkAllocationCallbacks *allocator() {
+    return hostAllocator ? hostAllocator->callbacks() : nullptr;
+  }
+  HtHostAllocator *getHostAllocator() { return hostAllocator.get(); }
+
   VkCommandPool getCommandPool() { return commandPool; }
+  VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // falls back to the graphics queue when there is no dedicated transfer family
+  VkQueue transferQueue() { return transferQueue_; }
+  bool hasDedicatedTransferQueue() { return transferQueue_ != graphicsQueue_; }
+  // Vulkan requires external synchronization of a queue; hold this around
+  // every submit, present and wait idle on it. Queues that share a handle
+  // share the mutex
+  std::mutex &queueMutex(VkQueue queue);
+  // objects that frames in flight may still use are destroyed through here
+  HtDeletionQueue &deletionQueue() { return deletionQueue_; }
 
   SwapChainSupportDetails getSwapChainSupport() {
     return querySwapChainSupport(physicalDevice);
   }
   uint32_t findMemoryType(uint32_t typeFilter,
                           VkMemoryPropertyFlags properties);
+  // like findMemoryType but reports a missing type instead of throwing
+  bool hasMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
   QueueFamilyIndices findPhysicalQueueFamilies() {
     return findQueueFamilies(physicalDevice);
   }
@@ -63,7 +88,8 @@ public:
                     VkDeviceMemory &bufferMemory);
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size,
+                  VkDeviceSize srcOffset = 0);
   void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width,
                          uint32_t height, uint32_t layerCount);
 
@@ -71,6 +97,50 @@ public:
                            VkMemoryPropertyFlags properties, VkImage &image,
                            VkDeviceMemory &imageMemory);
 
+  // optional features, enabled in createLogicalDevice when requested and
+  // supported
+  bool bindlessEnabled() { return bindlessEnabled_; }
+  // VK_EXT_memory_budget, enabled whenever the device has it
+  bool memoryBudgetEnabled() { return memoryBudgetEnabled_; }
+  bool multiDrawIndirectEnabled() { return multiDrawIndirectEnabled_; }
+  // pipelineStatisticsQuery and occlusionQueryPrecise, requested with
+  // HT_QUERY_STATS=1
+  bool pipelineStatisticsEnabled() { return pipelineStatisticsEnabled_; }
+  bool preciseOcclusionEnabled() { return preciseOcclusionEnabled_; }
+  bool drawIndirectCountEnabled() {
+    return drawIndirectCount_ != nullptr &&
+           drawIndexedIndirectCount_ != nullptr;
+  }
+  // VK_KHR_draw_indirect_count entry points, only valid when
+  // drawIndirectCountEnabled()
+  void cmdDrawIndirectCount(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                            VkDeviceSize offset, VkBuffer countBuffer,
+                            VkDeviceSize countBufferOffset,
+                            uint32_t maxDrawCount, uint32_t stride) {
+    drawIndirectCount_(commandBuffer, buffer, offset, countBuffer,
+                       countBufferOffset, maxDrawCount, stride);
+  }
+  void cmdDrawIndexedIndirectCount(VkCommandBuffer commandBuffer,
+                                   VkBuffer buffer, VkDeviceSize offset,
+                                   VkBuffer countBuffer,
+                                   VkDeviceSize countBufferOffset,
+                                   uint32_t maxDrawCount, uint32_t stride) {
+    drawIndexedIndirectCount_(commandBuffer, buffer, offset, countBuffer,
+                              countBufferOffset, maxDrawCount, stride);
+  }
+
+  // VK_KHR_dynamic_rendering, requested with HT_DYNAMIC_RENDERING=1
+  bool dynamicRenderingEnabled() {
+    return beginRendering_ != nullptr && endRendering_ != nullptr;
+  }
+  void cmdBeginRendering(VkCommandBuffer commandBuffer,
+                         const VkRenderingInfoKHR *renderingInfo) {
+    beginRendering_(commandBuffer, renderingInfo);
+  }
+  void cmdEndRendering(VkCommandBuffer commandBuffer) {
+    endRendering_(commandBuffer);
+  }
+
   VkPhysicalDeviceProperties properties;
 
 private:
@@ -83,6 +153,7 @@ private:
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
+  int64_t rateDeviceSuitability(VkPhysicalDevice device);
   std::vector<const char *> getRequiredExtensions();
   bool checkValidationLayerSupport();
   QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
@@ -90,8 +161,18 @@ private:
       VkDebugUtilsMessengerCreateInfoEXT &createInfo);
   void hasGflwRequiredInstanceExtensions();
   bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+  bool isDeviceExtensionSupported(VkPhysicalDevice device,
+                                  const char *extension);
+  bool enableDescriptorIndexing(
+      VkPhysicalDeviceDescriptorIndexingFeatures &features,
+      std::vector<const char *> &extensions);
+  bool enableDynamicRendering(
+      VkPhysicalDeviceDynamicRenderingFeaturesKHR &features,
+      std::vector<const char *> &extensions);
   SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
+  // declared first so it outlives every object created through it
+  std::unique_ptr<HtHostAllocator> hostAllocator;
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
@@ -102,6 +183,21 @@ private:
   VkSurfaceKHR surface_;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  std::mutex graphicsQueueMutex;
+  std::mutex presentQueueMutex;
+  std::mutex transferQueueMutex;
+  HtDeletionQueue deletionQueue_;
+
+  bool bindlessEnabled_ = false;
+  bool memoryBudgetEnabled_ = false;
+  bool multiDrawIndirectEnabled_ = false;
+  bool pipelineStatisticsEnabled_ = false;
+  bool preciseOcclusionEnabled_ = false;
+  PFN_vkCmdDrawIndirectCountKHR drawIndirectCount_ = nullptr;
+  PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount_ = nullptr;
+  PFN_vkCmdBeginRenderingKHR beginRendering_ = nullptr;
+  PFN_vkCmdEndRenderingKHR endRendering_ = nullptr;
 
   const std::vector<const char *> validationLayers = {
       "VK_LAYER_KHRONOS_validation"};
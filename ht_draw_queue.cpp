@@ -0,0 +1,147 @@
+#include "ht_draw_queue.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace ht {
+
+static constexpr uint32_t PIPELINE_BITS = 16;
+static constexpr uint32_t MODEL_BITS = 24;
+static constexpr uint32_t DEPTH_BITS = 24;
+
+void HtDrawQueue::clear() {
+  draws.clear();
+  keys.clear();
+}
+
+void HtDrawQueue::submit(HtPipeline &pipeline, HtModel &model, float depth,
+                         const void *pushData, uint32_t pushSize,
+                         uint32_t instanceCount) {
+  assert(pushSize <= MAX_PUSH_CONSTANT_SIZE && "push constants too large");
+
+  uint64_t pipelineId = pipeline.getSortId();
+  uint64_t modelId = model.getSortId();
+  // a wrapped id would silently mix up the sort order
+  if (pipelineId >= (1ull << PIPELINE_BITS)) {
+    throw std::runtime_error("too many pipelines for the draw queue!");
+  }
+  if (modelId >= (1ull << MODEL_BITS)) {
+    throw std::runtime_error("too many models for the draw queue!");
+  }
+
+  constexpr uint32_t depthMax = (1u << DEPTH_BITS) - 1;
+  uint64_t depthKey = static_cast<uint64_t>(
+      std::min(std::max(depth, 0.0f), 1.0f) * depthMax);
+
+  keys.push_back(pipelineId << (MODEL_BITS + DEPTH_BITS) |
+                 modelId << DEPTH_BITS | depthKey);
+
+  Draw draw;
+  draw.pipeline = &pipeline;
+  draw.model = &model;
+  draw.instanceCount = instanceCount;
+  draw.pushSize = pushSize;
+  memcpy(draw.pushData.data(), pushData, pushSize);
+  draws.push_back(draw);
+}
+
+// LSD radix sort over 8-bit digits. Digits every key shares (typically the
+// high pipeline/model bytes) are detected from the histogram and skipped
+void HtDrawQueue::sortKeys() {
+  uint32_t count = static_cast<uint32_t>(keys.size());
+  order.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    order[i] = i;
+  }
+  scratchKeys.resize(count);
+  scratchOrder.resize(count);
+
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    std::array<uint32_t, 256> histogram{};
+    for (uint32_t i = 0; i < count; i++) {
+      histogram[(keys[i] >> shift) & 0xff]++;
+    }
+    if (histogram[(keys[0] >> shift) & 0xff] == count) {
+      continue;
+    }
+
+    uint32_t offset = 0;
+    for (auto &bucket : histogram) {
+      uint32_t bucketCount = bucket;
+      bucket = offset;
+      offset += bucketCount;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      uint32_t slot = histogram[(keys[i] >> shift) & 0xff]++;
+      scratchKeys[slot] = keys[i];
+      scratchOrder[slot] = order[i];
+    }
+    keys.swap(scratchKeys);
+    order.swap(scratchOrder);
+  }
+}
+
+void HtDrawQueue::record(VkCommandBuffer commandBuffer,
+                         VkPipelineLayout pipelineLayout,
+                         VkShaderStageFlags pushStages) {
+  stats = Stats{};
+  stats.draws = static_cast<uint32_t>(draws.size());
+  if (draws.empty()) {
+    return;
+  }
+  sortKeys();
+
+  HtPipeline *boundPipeline = nullptr;
+  HtModel *boundModel = nullptr;
+  uint32_t scope = HtQueryProfiler::NO_SCOPE;
+  for (uint32_t index : order) {
+    const Draw &draw = draws[index];
+    if (draw.pipeline != boundPipeline) {
+      draw.pipeline->bind(commandBuffer);
+      if (trace) {
+        trace->bindPipeline(*draw.pipeline);
+      }
+      boundPipeline = draw.pipeline;
+      stats.pipelineBinds++;
+    }
+    if (draw.model != boundModel) {
+      if (profiler) {
+        profiler->endScope(commandBuffer, scope);
+        scope = profiler->beginScope(
+            commandBuffer, "model " + std::to_string(draw.model->getSortId()));
+      }
+      // models from one geometry pool block share their buffers
+      if (boundModel == nullptr || !draw.model->sharesBuffers(*boundModel)) {
+        draw.model->bind(commandBuffer);
+        stats.modelBinds++;
+      }
+      if (trace) {
+        trace->bindModel(*draw.model);
+      }
+      boundModel = draw.model;
+    }
+    if (draw.pushSize > 0) {
+      vkCmdPushConstants(commandBuffer, pipelineLayout, pushStages, 0,
+                         draw.pushSize, draw.pushData.data());
+      if (trace) {
+        trace->pushConstants(pushStages, 0, draw.pushSize,
+                             draw.pushData.data());
+      }
+    }
+    draw.model->draw(commandBuffer, draw.instanceCount);
+    if (trace) {
+      trace->draw(draw.instanceCount);
+    }
+  }
+  if (profiler) {
+    profiler->endScope(commandBuffer, scope);
+  }
+  stats.bindsAvoided =
+      2 * stats.draws - stats.pipelineBinds - stats.modelBinds;
+}
+
+} // namespace ht
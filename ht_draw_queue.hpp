@@ -0,0 +1,86 @@
+#pragma once
+
+#include "ht_command_trace.hpp"
+#include "ht_model.hpp"
+#include "ht_pipeline.hpp"
+#include "ht_query_profiler.hpp"
+
+// std lib headers
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace ht {
+
+// Collects a frame's draws, orders them by a 64-bit key and records them with
+// only the pipeline / vertex buffer binds that actually change state.
+//
+// Key layout (most significant first):
+//   16 bits pipeline id | 24 bits model id | 24 bits quantized depth
+// Ids are the pipeline's and model's sort ids, stable for their lifetime and
+// reused once they are destroyed.
+class HtDrawQueue {
+public:
+  static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 64;
+
+  struct Stats {
+    uint32_t draws = 0;
+    uint32_t pipelineBinds = 0;
+    uint32_t modelBinds = 0;
+    // binds saved compared to binding pipeline and model for every draw
+    uint32_t bindsAvoided = 0;
+  };
+
+  HtDrawQueue() = default;
+
+  HtDrawQueue(const HtDrawQueue &) = delete;
+  HtDrawQueue &operator=(const HtDrawQueue &) = delete;
+
+  void clear();
+  // depth in [0, 1], smaller is drawn first within the same pipeline and model
+  void submit(HtPipeline &pipeline, HtModel &model, float depth,
+              const void *pushData, uint32_t pushSize,
+              uint32_t instanceCount = 1);
+  template <typename T>
+  void submit(HtPipeline &pipeline, HtModel &model, float depth,
+              const T &push) {
+    static_assert(sizeof(T) <= MAX_PUSH_CONSTANT_SIZE,
+                  "push constants too large for the draw queue");
+    submit(pipeline, model, depth, &push, sizeof(T));
+  }
+
+  // sorts and records every submitted draw, push constants go to pushStages
+  // of pipelineLayout at offset 0
+  void record(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+              VkShaderStageFlags pushStages);
+
+  const Stats &lastStats() const { return stats; }
+  // record() also writes every bind, push and draw into trace, null stops
+  void setTrace(HtCommandTrace *trace) { this->trace = trace; }
+  // record() wraps the draws of each model in a profiler scope, null stops
+  void setProfiler(HtQueryProfiler *profiler) { this->profiler = profiler; }
+
+private:
+  struct Draw {
+    HtPipeline *pipeline;
+    HtModel *model;
+    uint32_t instanceCount;
+    uint32_t pushSize;
+    std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> pushData;
+  };
+
+  void sortKeys();
+
+  std::vector<Draw> draws;
+  std::vector<uint64_t> keys;
+  std::vector<uint32_t> order;
+  // radix sort scratch, kept between frames
+  std::vector<uint64_t> scratchKeys;
+  std::vector<uint32_t> scratchOrder;
+
+  Stats stats;
+  HtCommandTrace *trace = nullptr;
+  HtQueryProfiler *profiler = nullptr;
+};
+
+} // namespace ht
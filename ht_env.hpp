@@ -0,0 +1,34 @@
+#pragma once
+
+// std lib headers
+#include <cstdlib>
+#include <string>
+
+namespace ht {
+
+// optional behaviour is switched on from the environment, e.g. HT_BINDLESS=1
+
+inline std::string envString(const char *name,
+                             const std::string &fallback = "") {
+  const char *value = std::getenv(name);
+  return value != nullptr ? std::string{value} : fallback;
+}
+
+inline bool envFlag(const char *name) {
+  std::string value = envString(name);
+  return !value.empty() && value != "0" && value != "false";
+}
+
+inline double envNumber(const char *name, double fallback) {
+  std::string value = envString(name);
+  if (value.empty()) {
+    return fallback;
+  }
+  try {
+    return std::stod(value);
+  } catch (const std::exception &) {
+    return fallback;
+  }
+}
+
+} // namespace ht
@@ -0,0 +1,235 @@
+#include "ht_frame_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace ht {
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+HtFrameAllocator::HtFrameAllocator(HtDevice &device, uint32_t frameCount,
+                                   VkDeviceSize bytesPerFrame)
+    : htDevice{device}, frameCount{frameCount} {
+  const VkPhysicalDeviceLimits &limits = htDevice.properties.limits;
+  uniformAlignment = std::max<VkDeviceSize>(
+      limits.minUniformBufferOffsetAlignment, 16);
+  storageAlignment = std::max<VkDeviceSize>(
+      limits.minStorageBufferOffsetAlignment, 16);
+
+  // every frame base has to be a valid dynamic offset for both bindings
+  frameSize = alignUp(bytesPerFrame,
+                      std::max(uniformAlignment, storageAlignment));
+  uniformRange = std::min<VkDeviceSize>(
+      {MAX_UNIFORM_RANGE, frameSize, limits.maxUniformBufferRange});
+  storageRange =
+      std::min<VkDeviceSize>(frameSize, limits.maxStorageBufferRange);
+
+  createBuffer();
+  createDescriptorSetLayout();
+  createDescriptorPools();
+}
+
+HtFrameAllocator::~HtFrameAllocator() {
+  for (auto pool : descriptorPools) {
+    vkDestroyDescriptorPool(htDevice.device(), pool, htDevice.allocator());
+  }
+  vkDestroyDescriptorPool(htDevice.device(), frameSetPool,
+                          htDevice.allocator());
+  vkDestroyDescriptorSetLayout(htDevice.device(), descriptorSetLayout,
+                               htDevice.allocator());
+  vkUnmapMemory(htDevice.device(), bufferMemory);
+  vkDestroyBuffer(htDevice.device(), buffer, htDevice.allocator());
+  vkFreeMemory(htDevice.device(), bufferMemory, htDevice.allocator());
+}
+
+void HtFrameAllocator::createBuffer() {
+  // dynamic offset + descriptor range must stay inside the buffer, so pad the
+  // end by the largest range
+  VkDeviceSize padding = std::max(uniformRange, storageRange);
+  VkDeviceSize bufferSize = frameSize * frameCount + padding;
+  htDevice.createBuffer(bufferSize,
+                        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        buffer, bufferMemory);
+
+  void *data;
+  vkMapMemory(htDevice.device(), bufferMemory, 0, bufferSize, 0, &data);
+  mapped = static_cast<uint8_t *>(data);
+}
+
+void HtFrameAllocator::createDescriptorSetLayout() {
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags =
+      VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags =
+      VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(htDevice.device(), &layoutInfo,
+                                  htDevice.allocator(),
+                                  &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create frame descriptor set layout!");
+  }
+}
+
+void HtFrameAllocator::createDescriptorPools() {
+  uint32_t maxSets = EXTRA_SETS_PER_FRAME;
+  std::array<VkDescriptorPoolSize, 4> poolSizes{};
+  poolSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, maxSets};
+  poolSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, maxSets};
+  poolSizes[2] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, maxSets};
+  poolSizes[3] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxSets};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = maxSets;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+
+  descriptorPools.resize(frameCount);
+  for (uint32_t i = 0; i < frameCount; i++) {
+    if (vkCreateDescriptorPool(htDevice.device(), &poolInfo,
+                               htDevice.allocator(),
+                               &descriptorPools[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create frame descriptor pool!");
+    }
+  }
+
+  std::array<VkDescriptorPoolSize, 2> frameSetSizes{};
+  frameSetSizes[0] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, frameCount};
+  frameSetSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, frameCount};
+
+  VkDescriptorPoolCreateInfo frameSetPoolInfo{};
+  frameSetPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  frameSetPoolInfo.maxSets = frameCount;
+  frameSetPoolInfo.poolSizeCount = static_cast<uint32_t>(frameSetSizes.size());
+  frameSetPoolInfo.pPoolSizes = frameSetSizes.data();
+  if (vkCreateDescriptorPool(htDevice.device(), &frameSetPoolInfo,
+                             htDevice.allocator(),
+                             &frameSetPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create frame descriptor pool!");
+  }
+
+  std::vector<VkDescriptorSetLayout> layouts(frameCount, descriptorSetLayout);
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = frameSetPool;
+  allocInfo.descriptorSetCount = frameCount;
+  allocInfo.pSetLayouts = layouts.data();
+  frameSets.resize(frameCount);
+  if (vkAllocateDescriptorSets(htDevice.device(), &allocInfo,
+                               frameSets.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate frame descriptor set!");
+  }
+
+  // descriptors point at the start of the buffer, allocations are addressed
+  // entirely through the dynamic offsets, so the sets never change
+  VkDescriptorBufferInfo uniformInfo{buffer, 0, uniformRange};
+  VkDescriptorBufferInfo storageInfo{buffer, 0, storageRange};
+
+  std::vector<VkWriteDescriptorSet> writes;
+  for (VkDescriptorSet frameSet : frameSets) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = frameSet;
+    write.dstBinding = 0;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &uniformInfo;
+    writes.push_back(write);
+
+    write.dstBinding = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    write.pBufferInfo = &storageInfo;
+    writes.push_back(write);
+  }
+  vkUpdateDescriptorSets(htDevice.device(),
+                         static_cast<uint32_t>(writes.size()), writes.data(), 0,
+                         nullptr);
+}
+
+void HtFrameAllocator::beginFrame(uint32_t frameIndex) {
+  assert(frameIndex < frameCount && "frame index out of range");
+  currentFrame = frameIndex;
+  head = 0;
+
+  // frees the transient sets only, frameSets live in their own pool
+  vkResetDescriptorPool(htDevice.device(), descriptorPools[currentFrame], 0);
+}
+
+HtFrameAllocator::Allocation
+HtFrameAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+  VkDeviceSize offset = alignUp(head, alignment);
+  if (offset + size > frameSize) {
+    throw std::runtime_error("frame allocator out of memory!");
+  }
+  head = offset + size;
+
+  VkDeviceSize absolute = frameSize * currentFrame + offset;
+  Allocation allocation{};
+  allocation.data = mapped + absolute;
+  allocation.dynamicOffset = static_cast<uint32_t>(absolute);
+  allocation.size = size;
+  return allocation;
+}
+
+HtFrameAllocator::Allocation
+HtFrameAllocator::allocateUniform(VkDeviceSize size) {
+  assert(size <= uniformRange && "uniform allocation larger than range");
+  return allocate(size, uniformAlignment);
+}
+
+HtFrameAllocator::Allocation
+HtFrameAllocator::allocateStorage(VkDeviceSize size,
+                                  VkDeviceSize alignment) {
+  assert(size <= storageRange && "storage allocation larger than range");
+  assert((alignment & (alignment - 1)) == 0 && "alignment not a power of 2");
+  return allocate(size, std::max(storageAlignment, alignment));
+}
+
+VkDescriptorSet
+HtFrameAllocator::allocateDescriptorSet(VkDescriptorSetLayout layout) {
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPools[currentFrame];
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+
+  VkDescriptorSet descriptorSet;
+  if (vkAllocateDescriptorSets(htDevice.device(), &allocInfo,
+                               &descriptorSet) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate frame descriptor set!");
+  }
+  return descriptorSet;
+}
+
+void HtFrameAllocator::bind(VkCommandBuffer commandBuffer,
+                            VkPipelineLayout pipelineLayout, uint32_t firstSet,
+                            const Allocation &uniform,
+                            const Allocation &storage,
+                            VkPipelineBindPoint bindPoint) {
+  // dynamic offsets are consumed in binding order
+  uint32_t dynamicOffsets[] = {uniform.dynamicOffset, storage.dynamicOffset};
+  vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, firstSet,
+                          1, &frameSets[currentFrame], 2, dynamicOffsets);
+}
+
+} // namespace ht
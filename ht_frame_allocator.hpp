@@ -0,0 +1,101 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstring>
+#include <vector>
+
+namespace ht {
+
+// Linear allocator for transient uniform/storage data over one persistently
+// mapped buffer split into a region per frame in flight. Everything allocated
+// during a frame is addressed through a single descriptor set using dynamic
+// offsets, so per-draw data never needs its own descriptor. Those sets are
+// written once and never change, so recorded command buffers can keep them.
+//
+// Set layout:
+//   binding 0: VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC (uniformRange bytes)
+//   binding 1: VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC (storageRange bytes)
+class HtFrameAllocator {
+public:
+  static constexpr VkDeviceSize DEFAULT_BYTES_PER_FRAME = 8 * 1024 * 1024;
+  // clamped to maxUniformBufferRange, which may be as low as 16 KiB
+  static constexpr VkDeviceSize MAX_UNIFORM_RANGE = 64 * 1024;
+  // spare sets in each frame's pool for allocateDescriptorSet()
+  static constexpr uint32_t EXTRA_SETS_PER_FRAME = 16;
+
+  struct Allocation {
+    void *data = nullptr;
+    uint32_t dynamicOffset = 0;
+    VkDeviceSize size = 0;
+  };
+
+  HtFrameAllocator(HtDevice &device, uint32_t frameCount,
+                   VkDeviceSize bytesPerFrame = DEFAULT_BYTES_PER_FRAME);
+  ~HtFrameAllocator();
+
+  HtFrameAllocator(const HtFrameAllocator &) = delete;
+  HtFrameAllocator &operator=(const HtFrameAllocator &) = delete;
+
+  // must only be called once the GPU is done with frameIndex's previous use
+  // (i.e. after HtSwapChain::acquireNextImage)
+  void beginFrame(uint32_t frameIndex);
+
+  Allocation allocateUniform(VkDeviceSize size);
+  // alignment (power of two) on top of minStorageBufferOffsetAlignment, e.g.
+  // the element size when the data is indexed from the buffer start
+  Allocation allocateStorage(VkDeviceSize size, VkDeviceSize alignment = 1);
+  template <typename T> Allocation pushUniform(const T &value) {
+    Allocation allocation = allocateUniform(sizeof(T));
+    memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+
+  // transient set from the current frame's pool, freed by the next
+  // beginFrame() for the same frame index
+  VkDescriptorSet allocateDescriptorSet(VkDescriptorSetLayout layout);
+
+  void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+            uint32_t firstSet, const Allocation &uniform,
+            const Allocation &storage,
+            VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+  VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+  VkDescriptorSet getDescriptorSet() { return frameSets[currentFrame]; }
+  VkBuffer getBuffer() { return buffer; }
+  VkDeviceSize bytesPerFrame() { return frameSize; }
+  VkDeviceSize bytesUsed() { return head; }
+  VkDeviceSize getUniformRange() { return uniformRange; }
+  VkDeviceSize getStorageRange() { return storageRange; }
+
+private:
+  void createBuffer();
+  void createDescriptorSetLayout();
+  void createDescriptorPools();
+  Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+
+  HtDevice &htDevice;
+  uint32_t frameCount;
+  VkDeviceSize frameSize;
+  VkDeviceSize uniformRange;
+  VkDeviceSize storageRange;
+  VkDeviceSize uniformAlignment;
+  VkDeviceSize storageAlignment;
+
+  VkBuffer buffer;
+  VkDeviceMemory bufferMemory;
+  uint8_t *mapped;
+
+  VkDescriptorSetLayout descriptorSetLayout;
+  // holds frameSets, never reset
+  VkDescriptorPool frameSetPool;
+  // allocateDescriptorSet(), reset every frame
+  std::vector<VkDescriptorPool> descriptorPools;
+  std::vector<VkDescriptorSet> frameSets;
+
+  uint32_t currentFrame = 0;
+  VkDeviceSize head = 0;
+};
+
+} // namespace ht
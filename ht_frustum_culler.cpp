@@ -0,0 +1,267 @@
+#include "ht_frustum_culler.hpp"
+
+#include "ht_env.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HT_CULL_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace ht {
+
+namespace {
+
+struct BoundsView {
+  const float *minX;
+  const float *minY;
+  const float *maxX;
+  const float *maxY;
+};
+
+// An object is visible unless it lies entirely beyond one edge of the view.
+// Every kernel writes the indices of visible objects in [begin, end) to out
+// and returns how many it wrote; out must have room for end - begin entries.
+uint32_t cullScalar(const BoundsView &bounds, glm::vec2 viewMin,
+                    glm::vec2 viewMax, uint32_t begin, uint32_t end,
+                    uint32_t *out) {
+  uint32_t count = 0;
+  for (uint32_t i = begin; i < end; i++) {
+    bool inside = bounds.minX[i] <= viewMax.x && bounds.maxX[i] >= viewMin.x &&
+                  bounds.minY[i] <= viewMax.y && bounds.maxY[i] >= viewMin.y;
+    // branchless append, the slot is simply overwritten when culled
+    out[count] = i;
+    count += inside ? 1 : 0;
+  }
+  return count;
+}
+
+#ifdef HT_CULL_SIMD
+__attribute__((target("sse2"))) uint32_t
+cullSse(const BoundsView &bounds, glm::vec2 viewMin, glm::vec2 viewMax,
+        uint32_t begin, uint32_t end, uint32_t *out) {
+  const __m128 viewMinX = _mm_set1_ps(viewMin.x);
+  const __m128 viewMinY = _mm_set1_ps(viewMin.y);
+  const __m128 viewMaxX = _mm_set1_ps(viewMax.x);
+  const __m128 viewMaxY = _mm_set1_ps(viewMax.y);
+
+  uint32_t count = 0;
+  uint32_t i = begin;
+  for (; i + 4 <= end; i += 4) {
+    __m128 insideX =
+        _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(bounds.minX + i), viewMaxX),
+                   _mm_cmpge_ps(_mm_loadu_ps(bounds.maxX + i), viewMinX));
+    __m128 insideY =
+        _mm_and_ps(_mm_cmple_ps(_mm_loadu_ps(bounds.minY + i), viewMaxY),
+                   _mm_cmpge_ps(_mm_loadu_ps(bounds.maxY + i), viewMinY));
+    unsigned mask = _mm_movemask_ps(_mm_and_ps(insideX, insideY));
+    while (mask != 0) {
+      out[count++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + cullScalar(bounds, viewMin, viewMax, i, end, out + count);
+}
+
+__attribute__((target("avx"))) uint32_t
+cullAvx(const BoundsView &bounds, glm::vec2 viewMin, glm::vec2 viewMax,
+        uint32_t begin, uint32_t end, uint32_t *out) {
+  const __m256 viewMinX = _mm256_set1_ps(viewMin.x);
+  const __m256 viewMinY = _mm256_set1_ps(viewMin.y);
+  const __m256 viewMaxX = _mm256_set1_ps(viewMax.x);
+  const __m256 viewMaxY = _mm256_set1_ps(viewMax.y);
+
+  uint32_t count = 0;
+  uint32_t i = begin;
+  for (; i + 8 <= end; i += 8) {
+    __m256 insideX = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(bounds.minX + i), viewMaxX, _CMP_LE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(bounds.maxX + i), viewMinX,
+                      _CMP_GE_OQ));
+    __m256 insideY = _mm256_and_ps(
+        _mm256_cmp_ps(_mm256_loadu_ps(bounds.minY + i), viewMaxY, _CMP_LE_OQ),
+        _mm256_cmp_ps(_mm256_loadu_ps(bounds.maxY + i), viewMinY,
+                      _CMP_GE_OQ));
+    unsigned mask = _mm256_movemask_ps(_mm256_and_ps(insideX, insideY));
+    while (mask != 0) {
+      out[count++] = i + __builtin_ctz(mask);
+      mask &= mask - 1;
+    }
+  }
+  return count + cullScalar(bounds, viewMin, viewMax, i, end, out + count);
+}
+#endif
+
+} // namespace
+
+HtFrustumCuller::HtFrustumCuller() {
+  kernel_ = Kernel::Scalar;
+  for (Kernel candidate : {Kernel::Sse, Kernel::Avx}) {
+    if (isKernelSupported(candidate)) {
+      kernel_ = candidate;
+    }
+  }
+
+  std::string forced = envString("HT_CULL_KERNEL");
+  for (Kernel candidate : {Kernel::Scalar, Kernel::Sse, Kernel::Avx}) {
+    if (forced == kernelName(candidate) && isKernelSupported(candidate)) {
+      kernel_ = candidate;
+    }
+  }
+}
+
+const char *HtFrustumCuller::kernelName(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::Sse:
+    return "sse";
+  case Kernel::Avx:
+    return "avx";
+  default:
+    return "scalar";
+  }
+}
+
+bool HtFrustumCuller::isKernelSupported(Kernel kernel) {
+  switch (kernel) {
+#ifdef HT_CULL_SIMD
+  case Kernel::Sse:
+    return __builtin_cpu_supports("sse2");
+  case Kernel::Avx:
+    return __builtin_cpu_supports("avx");
+#endif
+  case Kernel::Scalar:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void HtFrustumCuller::setKernel(Kernel kernel) {
+  if (isKernelSupported(kernel)) {
+    kernel_ = kernel;
+  }
+}
+
+void HtFrustumCuller::clear() {
+  minX.clear();
+  minY.clear();
+  maxX.clear();
+  maxY.clear();
+}
+
+void HtFrustumCuller::reserve(uint32_t objectCount) {
+  minX.reserve(objectCount);
+  minY.reserve(objectCount);
+  maxX.reserve(objectCount);
+  maxY.reserve(objectCount);
+}
+
+uint32_t HtFrustumCuller::add(glm::vec2 boundsMin, glm::vec2 boundsMax) {
+  uint32_t index = objectCount();
+  minX.push_back(boundsMin.x);
+  minY.push_back(boundsMin.y);
+  maxX.push_back(boundsMax.x);
+  maxY.push_back(boundsMax.y);
+  return index;
+}
+
+void HtFrustumCuller::setView(glm::vec2 viewMin, glm::vec2 viewMax) {
+  this->viewMin = viewMin;
+  this->viewMax = viewMax;
+}
+
+uint32_t HtFrustumCuller::cullRange(uint32_t begin, uint32_t end,
+                                    uint32_t *out) {
+  BoundsView bounds{minX.data(), minY.data(), maxX.data(), maxY.data()};
+  switch (kernel_) {
+#ifdef HT_CULL_SIMD
+  case Kernel::Avx:
+    return cullAvx(bounds, viewMin, viewMax, begin, end, out);
+  case Kernel::Sse:
+    return cullSse(bounds, viewMin, viewMax, begin, end, out);
+#endif
+  default:
+    return cullScalar(bounds, viewMin, viewMax, begin, end, out);
+  }
+}
+
+const std::vector<uint32_t> &HtFrustumCuller::cull(HtThreadPool *pool) {
+  auto start = std::chrono::steady_clock::now();
+
+  uint32_t count = objectCount();
+  visible.resize(count);
+
+  uint32_t visibleCount;
+  if (pool == nullptr || count < PARALLEL_THRESHOLD) {
+    visibleCount = cullRange(0, count, visible.data());
+  } else {
+    // every chunk writes into its own slice of the output, the slices are
+    // packed together once all chunks are done
+    uint32_t chunkCount = (count + CULL_CHUNK - 1) / CULL_CHUNK;
+    chunkVisible.assign(chunkCount, 0);
+    pool->parallelFor(
+        chunkCount, 1, [this, count](uint32_t firstChunk, uint32_t endChunk) {
+          for (uint32_t chunk = firstChunk; chunk < endChunk; chunk++) {
+            uint32_t begin = chunk * CULL_CHUNK;
+            uint32_t end = std::min(count, begin + CULL_CHUNK);
+            chunkVisible[chunk] =
+                cullRange(begin, end, visible.data() + begin);
+          }
+        });
+
+    visibleCount = chunkVisible[0];
+    for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+      memmove(visible.data() + visibleCount,
+              visible.data() + chunk * CULL_CHUNK,
+              chunkVisible[chunk] * sizeof(uint32_t));
+      visibleCount += chunkVisible[chunk];
+    }
+  }
+  visible.resize(visibleCount);
+
+  std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+  lastObjectsPerMs = count / std::max(elapsed.count(), 1e-6);
+  return visible;
+}
+
+void HtFrustumCuller::benchmark(uint32_t objectCount, HtThreadPool *pool) {
+  std::mt19937 rng{1234};
+  std::uniform_real_distribution<float> position{-4.0f, 4.0f};
+  std::uniform_real_distribution<float> extent{0.01f, 0.2f};
+
+  HtFrustumCuller culler;
+  culler.reserve(objectCount);
+  for (uint32_t i = 0; i < objectCount; i++) {
+    glm::vec2 center{position(rng), position(rng)};
+    glm::vec2 halfExtent{extent(rng), extent(rng)};
+    culler.add(center - halfExtent, center + halfExtent);
+  }
+
+  constexpr int iterations = 20;
+  for (Kernel kernel : {Kernel::Scalar, Kernel::Sse, Kernel::Avx}) {
+    if (!isKernelSupported(kernel)) {
+      continue;
+    }
+    culler.setKernel(kernel);
+    culler.cull(pool); // warm up caches and page in the output
+
+    double best = 0.0;
+    size_t visibleCount = 0;
+    for (int i = 0; i < iterations; i++) {
+      visibleCount = culler.cull(pool).size();
+      best = std::max(best, culler.objectsPerMillisecond());
+    }
+    std::cout << "cull benchmark [" << kernelName(kernel) << "]: "
+              << objectCount << " objects, " << visibleCount << " visible, "
+              << static_cast<uint64_t>(best) << " objects/ms" << std::endl;
+  }
+}
+
+} // namespace ht
@@ -0,0 +1,76 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // glm assumes openGl standard, depth [-1,1]
+                                    // instead of [0,1]
+#include <glm/glm.hpp>
+
+#include "ht_thread_pool.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace ht {
+
+// CPU visibility test of axis aligned bounds against the view rectangle.
+// Bounds are kept as a structure of arrays so the kernels can test 4 (SSE) or
+// 8 (AVX) objects per instruction; the widest kernel the CPU supports is
+// picked at startup (HT_CULL_KERNEL=scalar|sse|avx forces one). Large tables
+// are split into chunks across a thread pool.
+class HtFrustumCuller {
+public:
+  enum class Kernel { Scalar, Sse, Avx };
+
+  // below this many objects a single thread is faster than waking the pool
+  static constexpr uint32_t PARALLEL_THRESHOLD = 64 * 1024;
+  // objects per parallel chunk, a multiple of 8 so the SIMD loops stay
+  // aligned
+  static constexpr uint32_t CULL_CHUNK = 16 * 1024;
+
+  HtFrustumCuller();
+
+  HtFrustumCuller(const HtFrustumCuller &) = delete;
+  HtFrustumCuller &operator=(const HtFrustumCuller &) = delete;
+
+  void clear();
+  void reserve(uint32_t objectCount);
+  // world space bounds, returns the object index reported by cull()
+  uint32_t add(glm::vec2 boundsMin, glm::vec2 boundsMax);
+  // defaults to clip space, [-1, 1] on both axes
+  void setView(glm::vec2 viewMin, glm::vec2 viewMax);
+
+  // indices of all objects overlapping the view, in ascending order. Large
+  // tables are split across the threads of pool, when given
+  const std::vector<uint32_t> &cull(HtThreadPool *pool = nullptr);
+
+  uint32_t objectCount() const { return static_cast<uint32_t>(minX.size()); }
+  Kernel kernel() const { return kernel_; }
+  void setKernel(Kernel kernel);
+  // throughput of the last cull() call
+  double objectsPerMillisecond() const { return lastObjectsPerMs; }
+
+  static const char *kernelName(Kernel kernel);
+  static bool isKernelSupported(Kernel kernel);
+  // culls objectCount random boxes with every supported kernel and prints
+  // the throughput, see HT_CULL_BENCH
+  static void benchmark(uint32_t objectCount, HtThreadPool *pool = nullptr);
+
+private:
+  uint32_t cullRange(uint32_t begin, uint32_t end, uint32_t *out);
+
+  std::vector<float> minX;
+  std::vector<float> minY;
+  std::vector<float> maxX;
+  std::vector<float> maxY;
+  glm::vec2 viewMin{-1.0f};
+  glm::vec2 viewMax{1.0f};
+
+  Kernel kernel_;
+  std::vector<uint32_t> visible;
+  // visible count per chunk of a parallel cull, reused every frame
+  std::vector<uint32_t> chunkVisible;
+  double lastObjectsPerMs = 0.0;
+};
+
+} // namespace ht
@@ -0,0 +1,509 @@
+#include "ht_geometry_pool.hpp"
+
+// std lib headers
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace ht {
+
+HtGeometryPool::HtGeometryPool(HtDevice &device, uint32_t frameCount,
+                               uint32_t vertexStride, uint32_t blockVertices,
+                               uint32_t blockIndices)
+    : htDevice{device}, vertexStride{vertexStride},
+      blockVertices{blockVertices}, blockIndices{blockIndices},
+      retired(frameCount) {}
+
+HtGeometryPool::~HtGeometryPool() {
+  for (auto &block : blocks) {
+    destroyBlockBuffers(block);
+  }
+}
+
+void HtGeometryPool::createBlockBuffers(Block &block) {
+  // transfer source for compaction and command traces
+  htDevice.createBuffer(
+      static_cast<VkDeviceSize>(block.vertexCapacity) * vertexStride,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, block.vertexBuffer,
+      block.vertexMemory);
+  htDevice.createBuffer(
+      static_cast<VkDeviceSize>(block.indexCapacity) * sizeof(uint32_t),
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, block.indexBuffer,
+      block.indexMemory);
+}
+
+void HtGeometryPool::destroyBlockBuffers(Block &block) {
+  // frames in flight may still read the buffers
+  VkDevice device = htDevice.device();
+  const VkAllocationCallbacks *allocator = htDevice.allocator();
+  VkBuffer vertexBuffer = block.vertexBuffer;
+  VkDeviceMemory vertexMemory = block.vertexMemory;
+  VkBuffer indexBuffer = block.indexBuffer;
+  VkDeviceMemory indexMemory = block.indexMemory;
+  htDevice.deletionQueue().push([device, allocator, vertexBuffer,
+                                 vertexMemory, indexBuffer, indexMemory]() {
+    vkDestroyBuffer(device, vertexBuffer, allocator);
+    vkFreeMemory(device, vertexMemory, allocator);
+    vkDestroyBuffer(device, indexBuffer, allocator);
+    vkFreeMemory(device, indexMemory, allocator);
+  });
+  block.vertexBuffer = VK_NULL_HANDLE;
+  block.indexBuffer = VK_NULL_HANDLE;
+}
+
+uint32_t HtGeometryPool::addBlock(uint32_t vertexCount, uint32_t indexCount) {
+  Block block{};
+  // oversized meshes get a block of their own
+  block.vertexCapacity = std::max(blockVertices, vertexCount);
+  block.indexCapacity = std::max(blockIndices, std::max(indexCount, 1u));
+  createBlockBuffers(block);
+  block.freeVertices.push_back({0, block.vertexCapacity});
+  block.freeIndices.push_back({0, block.indexCapacity});
+  blocks.push_back(std::move(block));
+  return static_cast<uint32_t>(blocks.size() - 1);
+}
+
+bool HtGeometryPool::takeRange(std::vector<Range> &freeRanges, uint32_t count,
+                               uint32_t &first) {
+  if (count == 0) {
+    first = 0;
+    return true;
+  }
+  for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+    if (it->count < count) {
+      continue;
+    }
+    first = it->first;
+    it->first += count;
+    it->count -= count;
+    if (it->count == 0) {
+      freeRanges.erase(it);
+    }
+    return true;
+  }
+  return false;
+}
+
+void HtGeometryPool::releaseRange(std::vector<Range> &freeRanges,
+                                  Range range) {
+  if (range.count == 0) {
+    return;
+  }
+  auto next = std::lower_bound(
+      freeRanges.begin(), freeRanges.end(), range,
+      [](const Range &a, const Range &b) { return a.first < b.first; });
+  auto it = freeRanges.insert(next, range);
+  // merge with the following range, then with the preceding one
+  auto following = it + 1;
+  if (following != freeRanges.end() &&
+      it->first + it->count == following->first) {
+    it->count += following->count;
+    it = freeRanges.erase(following) - 1;
+  }
+  if (it != freeRanges.begin()) {
+    auto preceding = it - 1;
+    if (preceding->first + preceding->count == it->first) {
+      preceding->count += it->count;
+      freeRanges.erase(it);
+    }
+  }
+}
+
+uint32_t HtGeometryPool::freeCount(const std::vector<Range> &freeRanges) {
+  uint32_t count = 0;
+  for (const auto &range : freeRanges) {
+    count += range.count;
+  }
+  return count;
+}
+
+// whether compacting the block would make room, retired ranges included
+bool HtGeometryPool::fits(uint32_t blockIndex, uint32_t vertexCount,
+                          uint32_t indexCount) const {
+  const Block &block = blocks[blockIndex];
+  uint32_t vertices = freeCount(block.freeVertices);
+  uint32_t indices = freeCount(block.freeIndices);
+  for (const auto &frame : retired) {
+    for (const auto &range : frame) {
+      if (range.block == blockIndex) {
+        vertices += range.vertices.count;
+        indices += range.indices.count;
+      }
+    }
+  }
+  return vertices >= vertexCount && indices >= indexCount;
+}
+
+HtGeometryPool::Handle
+HtGeometryPool::allocate(HtUploadScheduler &uploadScheduler,
+                         const void *vertices, uint32_t vertexCount,
+                         const std::vector<uint32_t> &indices,
+                         HtUploadScheduler::UploadCallback onComplete) {
+  assert(vertexCount > 0 && "geometry pool allocation without vertices");
+  uint32_t indexCount = static_cast<uint32_t>(indices.size());
+
+  Allocation allocation{};
+  allocation.live = true;
+  allocation.vertices.count = vertexCount;
+  allocation.indices.count = indexCount;
+
+  auto take = [&](Block &block) {
+    std::vector<Range> freeVertices = block.freeVertices;
+    std::vector<Range> freeIndices = block.freeIndices;
+    if (!takeRange(freeVertices, vertexCount, allocation.vertices.first) ||
+        !takeRange(freeIndices, indexCount, allocation.indices.first)) {
+      return false;
+    }
+    block.freeVertices = std::move(freeVertices);
+    block.freeIndices = std::move(freeIndices);
+    return true;
+  };
+
+  bool placed = false;
+  uint32_t blockCount = static_cast<uint32_t>(blocks.size());
+  uint32_t compactCandidate = blockCount;
+  for (uint32_t i = 0; i < blockCount && !placed; i++) {
+    if (take(blocks[i])) {
+      allocation.block = i;
+      placed = true;
+    } else if (compactCandidate == blockCount &&
+               fits(i, vertexCount, indexCount)) {
+      compactCandidate = i;
+    }
+  }
+  if (!placed && compactCandidate != blockCount) {
+    compactBlock(compactCandidate, uploadScheduler);
+    placed = take(blocks[compactCandidate]);
+    assert(placed && "compaction did not make room");
+    allocation.block = compactCandidate;
+  }
+  if (!placed) {
+    allocation.block = addBlock(vertexCount, indexCount);
+    take(blocks[allocation.block]);
+  }
+
+  Handle handle;
+  if (freeHandles.empty()) {
+    handle = static_cast<Handle>(allocations.size());
+    allocations.push_back(allocation);
+  } else {
+    handle = freeHandles.back();
+    freeHandles.pop_back();
+    allocations[handle] = allocation;
+  }
+
+  // onComplete runs once, after the last of the uploads
+  Block &block = blocks[allocation.block];
+  uint32_t uploadCount = indexCount > 0 ? 2 : 1;
+  *block.pendingUploads += uploadCount;
+  auto remaining = std::make_shared<uint32_t>(uploadCount);
+  auto uploaded = [pending = block.pendingUploads, remaining, onComplete]() {
+    (*pending)--;
+    if (--*remaining == 0 && onComplete) {
+      onComplete();
+    }
+  };
+  uploadScheduler.uploadBuffer(
+      block.vertexBuffer,
+      static_cast<VkDeviceSize>(allocation.vertices.first) * vertexStride,
+      vertices, static_cast<VkDeviceSize>(vertexCount) * vertexStride,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+      uploaded);
+  if (indexCount > 0) {
+    uploadScheduler.uploadBuffer(
+        block.indexBuffer,
+        static_cast<VkDeviceSize>(allocation.indices.first) * sizeof(uint32_t),
+        indices.data(), sizeof(uint32_t) * indices.size(),
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+        uploaded);
+  }
+  return handle;
+}
+
+void HtGeometryPool::free(Handle handle) {
+  assert(handle < allocations.size() && allocations[handle].live &&
+         "invalid geometry pool handle");
+  Allocation &allocation = allocations[handle];
+  allocation.live = false;
+  retired[currentFrame].push_back(
+      {allocation.block, allocation.vertices, allocation.indices});
+  freeHandles.push_back(handle);
+}
+
+void HtGeometryPool::beginFrame(uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  for (const auto &range : retired[frameIndex]) {
+    Block &block = blocks[range.block];
+    releaseRange(block.freeVertices, range.vertices);
+    releaseRange(block.freeIndices, range.indices);
+  }
+  retired[frameIndex].clear();
+}
+
+void HtGeometryPool::compact(HtUploadScheduler &uploadScheduler) {
+  for (uint32_t i = 0; i < blocks.size(); i++) {
+    if (blocks[i].freeVertices.size() > 1 || blocks[i].freeIndices.size() > 1) {
+      compactBlock(i, uploadScheduler);
+    }
+  }
+}
+
+// the live ranges are copied into a new block, frames in flight keep reading
+// the old one until the deletion queue destroys it. Rare enough to wait for
+// the copy on the graphics queue
+void HtGeometryPool::compactBlock(uint32_t blockIndex,
+                                  HtUploadScheduler &uploadScheduler) {
+  auto start = std::chrono::steady_clock::now();
+  Block &block = blocks[blockIndex];
+  // uploads still queued would land in the old buffers
+  if (*block.pendingUploads > 0) {
+    uploadScheduler.waitIdle();
+  }
+
+  Block compacted{};
+  compacted.vertexCapacity = block.vertexCapacity;
+  compacted.indexCapacity = block.indexCapacity;
+  compacted.pendingUploads = block.pendingUploads;
+  createBlockBuffers(compacted);
+
+  // packed in their current order, which keeps meshes allocated together
+  // next to each other
+  std::vector<Handle> moved;
+  for (Handle handle = 0; handle < allocations.size(); handle++) {
+    if (allocations[handle].live && allocations[handle].block == blockIndex) {
+      moved.push_back(handle);
+    }
+  }
+  std::sort(moved.begin(), moved.end(), [this](Handle a, Handle b) {
+    return allocations[a].vertices.first < allocations[b].vertices.first;
+  });
+
+  std::vector<VkBufferCopy> vertexCopies;
+  std::vector<VkBufferCopy> indexCopies;
+  uint32_t vertexHead = 0;
+  uint32_t indexHead = 0;
+  for (Handle handle : moved) {
+    Allocation &allocation = allocations[handle];
+    vertexCopies.push_back(
+        {static_cast<VkDeviceSize>(allocation.vertices.first) * vertexStride,
+         static_cast<VkDeviceSize>(vertexHead) * vertexStride,
+         static_cast<VkDeviceSize>(allocation.vertices.count) * vertexStride});
+    allocation.vertices.first = vertexHead;
+    vertexHead += allocation.vertices.count;
+    if (allocation.indices.count > 0) {
+      indexCopies.push_back(
+          {sizeof(uint32_t) * allocation.indices.first,
+           sizeof(uint32_t) * indexHead,
+           sizeof(uint32_t) * allocation.indices.count});
+      allocation.indices.first = indexHead;
+      indexHead += allocation.indices.count;
+    }
+  }
+  compacted.freeVertices.push_back(
+      {vertexHead, compacted.vertexCapacity - vertexHead});
+  compacted.freeIndices.push_back(
+      {indexHead, compacted.indexCapacity - indexHead});
+  if (compacted.freeVertices.back().count == 0) {
+    compacted.freeVertices.clear();
+  }
+  if (compacted.freeIndices.back().count == 0) {
+    compacted.freeIndices.clear();
+  }
+
+  VkCommandBuffer commandBuffer = htDevice.beginSingleTimeCommands();
+  // earlier uploads come first in submission order: graphics queue copies,
+  // or ownership acquires ending at vertex input for the transfer queue
+  VkMemoryBarrier before{};
+  before.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  before.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  before.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &before, 0, nullptr, 0, nullptr);
+  if (!vertexCopies.empty()) {
+    vkCmdCopyBuffer(commandBuffer, block.vertexBuffer, compacted.vertexBuffer,
+                    static_cast<uint32_t>(vertexCopies.size()),
+                    vertexCopies.data());
+  }
+  if (!indexCopies.empty()) {
+    vkCmdCopyBuffer(commandBuffer, block.indexBuffer, compacted.indexBuffer,
+                    static_cast<uint32_t>(indexCopies.size()),
+                    indexCopies.data());
+  }
+  VkMemoryBarrier after{};
+  after.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  after.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  after.dstAccessMask =
+      VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &after, 0,
+                       nullptr, 0, nullptr);
+  htDevice.endSingleTimeCommands(commandBuffer);
+
+  // ranges retired from the old block vanish with it
+  for (auto &frame : retired) {
+    frame.erase(std::remove_if(frame.begin(), frame.end(),
+                               [blockIndex](const Retired &range) {
+                                 return range.block == blockIndex;
+                               }),
+                frame.end());
+  }
+  destroyBlockBuffers(block);
+  block = std::move(compacted);
+  generation_++;
+  compactions++;
+  lastCompactionMs = std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+}
+
+HtGeometryPool::Stats HtGeometryPool::stats() const {
+  Stats stats{};
+  stats.blocks = static_cast<uint32_t>(blocks.size());
+  stats.compactions = compactions;
+  stats.lastCompactionMs = lastCompactionMs;
+  for (const auto &block : blocks) {
+    stats.vertexCapacity += block.vertexCapacity;
+    stats.indexCapacity += block.indexCapacity;
+    stats.verticesUsed += block.vertexCapacity - freeCount(block.freeVertices);
+    stats.indicesUsed += block.indexCapacity - freeCount(block.freeIndices);
+  }
+  return stats;
+}
+
+void HtGeometryPool::selfTest(HtDevice &device,
+                              HtUploadScheduler &uploadScheduler) {
+  constexpr uint32_t meshCount = 8;
+  constexpr uint32_t meshVertices = 8;
+  constexpr uint32_t meshIndices = 12;
+  // one block exactly holds the meshes, vertices are plain uint32 values
+  HtGeometryPool pool{device, 2, sizeof(uint32_t), meshCount * meshVertices,
+                      meshCount * meshIndices};
+
+  // every value encodes its mesh and position, so moved data is recognized
+  auto makeMesh = [](uint32_t mesh, uint32_t vertexCount,
+                     uint32_t indexCount, std::vector<uint32_t> &vertices,
+                     std::vector<uint32_t> &indices) {
+    vertices.resize(vertexCount);
+    indices.resize(indexCount);
+    for (uint32_t i = 0; i < vertexCount; i++) {
+      vertices[i] = mesh << 16 | i;
+    }
+    for (uint32_t i = 0; i < indexCount; i++) {
+      indices[i] = mesh << 16 | (i % vertexCount);
+    }
+  };
+
+  struct Mesh {
+    uint32_t id;
+    Handle handle;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> indices;
+  };
+  std::vector<Mesh> meshes(meshCount);
+  for (uint32_t i = 0; i < meshCount; i++) {
+    meshes[i].id = i;
+    makeMesh(i, meshVertices, meshIndices, meshes[i].vertices,
+             meshes[i].indices);
+    meshes[i].handle =
+        pool.allocate(uploadScheduler, meshes[i].vertices.data(),
+                      meshVertices, meshes[i].indices);
+  }
+  uploadScheduler.waitIdle();
+
+  // the free ranges are interleaved with live ones, none is large enough
+  // for a mesh three times the size
+  std::vector<Mesh> live;
+  for (Mesh &mesh : meshes) {
+    if (mesh.id % 2 == 1) {
+      pool.free(mesh.handle);
+    } else {
+      live.push_back(std::move(mesh));
+    }
+  }
+  pool.beginFrame(1);
+  pool.beginFrame(0);
+
+  uint64_t generation = pool.generation();
+  Mesh large{};
+  large.id = meshCount;
+  makeMesh(large.id, meshVertices * 3, meshIndices * 3, large.vertices,
+           large.indices);
+  large.handle =
+      pool.allocate(uploadScheduler, large.vertices.data(),
+                    static_cast<uint32_t>(large.vertices.size()),
+                    large.indices);
+  uploadScheduler.waitIdle();
+  live.push_back(std::move(large));
+
+  Stats stats = pool.stats();
+  if (pool.generation() == generation || stats.compactions != 1 ||
+      stats.blocks != 1) {
+    throw std::runtime_error("geometry pool self test: allocation did not "
+                             "compact the block!");
+  }
+
+  auto readBack = [&device](VkBuffer buffer, uint32_t count) {
+    VkDeviceSize size = sizeof(uint32_t) * count;
+    VkBuffer staging;
+    VkDeviceMemory stagingMemory;
+    device.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        staging, stagingMemory);
+    VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
+    VkBufferCopy region{0, 0, size};
+    vkCmdCopyBuffer(commandBuffer, buffer, staging, 1, &region);
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0,
+                         nullptr, 0, nullptr);
+    device.endSingleTimeCommands(commandBuffer);
+
+    std::vector<uint32_t> values(count);
+    void *data;
+    vkMapMemory(device.device(), stagingMemory, 0, size, 0, &data);
+    memcpy(values.data(), data, size);
+    vkUnmapMemory(device.device(), stagingMemory);
+    vkDestroyBuffer(device.device(), staging, device.allocator());
+    vkFreeMemory(device.device(), stagingMemory, device.allocator());
+    return values;
+  };
+  Handle first = live.front().handle;
+  std::vector<uint32_t> vertices =
+      readBack(pool.vertexBuffer(first), stats.vertexCapacity);
+  std::vector<uint32_t> indices =
+      readBack(pool.indexBuffer(first), stats.indexCapacity);
+
+  for (const Mesh &mesh : live) {
+    if (pool.vertexBuffer(mesh.handle) != pool.vertexBuffer(first) ||
+        !std::equal(mesh.vertices.begin(), mesh.vertices.end(),
+                    vertices.begin() + pool.firstVertex(mesh.handle)) ||
+        !std::equal(mesh.indices.begin(), mesh.indices.end(),
+                    indices.begin() + pool.firstIndex(mesh.handle))) {
+      throw std::runtime_error("geometry pool self test: mesh " +
+                               std::to_string(mesh.id) +
+                               " does not match after compaction!");
+    }
+  }
+  for (const Mesh &mesh : live) {
+    pool.free(mesh.handle);
+  }
+  std::cout << "geometry pool self test: " << live.size()
+            << " meshes intact after compaction in " << stats.lastCompactionMs
+            << " ms" << std::endl;
+}
+
+} // namespace ht
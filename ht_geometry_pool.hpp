@@ -0,0 +1,152 @@
+#pragma once
+
+#include "ht_device.hpp"
+#include "ht_upload_scheduler.hpp"
+
+// std lib headers
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace ht {
+
+// Sub-allocates vertex and index data of many meshes from a few large device
+// local blocks, so draws of different meshes only differ in firstIndex /
+// vertexOffset and a frame binds vertex and index buffers once per block.
+//
+// Freed ranges stay readable by frames in flight and are only reused once the
+// same frame index comes around again in beginFrame(). A block that has
+// enough free space in total but no range large enough is compacted: its
+// live ranges are copied to the front of a new block and every offset
+// handed out before is stale, see generation().
+class HtGeometryPool {
+public:
+  using Handle = uint32_t;
+  static constexpr Handle INVALID_HANDLE = std::numeric_limits<Handle>::max();
+  static constexpr uint32_t DEFAULT_BLOCK_VERTICES = 256 * 1024;
+  static constexpr uint32_t DEFAULT_BLOCK_INDICES = 768 * 1024;
+
+  struct Stats {
+    uint32_t blocks = 0;
+    uint64_t verticesUsed = 0;
+    uint64_t vertexCapacity = 0;
+    uint64_t indicesUsed = 0;
+    uint64_t indexCapacity = 0;
+    uint32_t compactions = 0;
+    double lastCompactionMs = 0.0;
+  };
+
+  HtGeometryPool(HtDevice &device, uint32_t frameCount, uint32_t vertexStride,
+                 uint32_t blockVertices = DEFAULT_BLOCK_VERTICES,
+                 uint32_t blockIndices = DEFAULT_BLOCK_INDICES);
+  ~HtGeometryPool();
+
+  HtGeometryPool(const HtGeometryPool &) = delete;
+  HtGeometryPool &operator=(const HtGeometryPool &) = delete;
+
+  // places the mesh and streams it in through uploadScheduler, onComplete
+  // runs once both uploads have finished. No indices draws unindexed.
+  // Compacting may wait for uploadScheduler and the graphics queue, so this
+  // must not be called while a frame is being recorded
+  Handle allocate(HtUploadScheduler &uploadScheduler, const void *vertices,
+                  uint32_t vertexCount, const std::vector<uint32_t> &indices,
+                  HtUploadScheduler::UploadCallback onComplete = nullptr);
+  void free(Handle handle);
+
+  // releases the ranges freed during the previous use of frameIndex; must
+  // only be called once the GPU is done with it
+  void beginFrame(uint32_t frameIndex);
+  // compacts every block with free space in more than one range
+  void compact(HtUploadScheduler &uploadScheduler);
+
+  VkBuffer vertexBuffer(Handle handle) const {
+    return blocks[allocations[handle].block].vertexBuffer;
+  }
+  VkBuffer indexBuffer(Handle handle) const {
+    return blocks[allocations[handle].block].indexBuffer;
+  }
+  uint32_t firstVertex(Handle handle) const {
+    return allocations[handle].vertices.first;
+  }
+  uint32_t firstIndex(Handle handle) const {
+    return allocations[handle].indices.first;
+  }
+  uint32_t getVertexStride() const { return vertexStride; }
+
+  // changes whenever compaction moved ranges, so anything recorded with
+  // their buffers or offsets must be recorded again
+  uint64_t generation() const { return generation_; }
+  Stats stats() const;
+
+  // frees every other mesh of a small pool, forces allocate() to compact and
+  // checks the moved data through a readback; throws on a mismatch. See
+  // HT_GEOMETRY_POOL_TEST
+  static void selfTest(HtDevice &device, HtUploadScheduler &uploadScheduler);
+
+private:
+  struct Range {
+    uint32_t first = 0;
+    uint32_t count = 0;
+  };
+
+  struct Block {
+    VkBuffer vertexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+    VkBuffer indexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+    uint32_t vertexCapacity = 0;
+    uint32_t indexCapacity = 0;
+    // sorted by first, adjacent ranges merged
+    std::vector<Range> freeVertices;
+    std::vector<Range> freeIndices;
+    // shared with the upload callbacks so the block can be compacted or the
+    // pool destroyed while uploads are in flight
+    std::shared_ptr<std::atomic<uint32_t>> pendingUploads =
+        std::make_shared<std::atomic<uint32_t>>(0);
+  };
+
+  struct Allocation {
+    uint32_t block = 0;
+    Range vertices;
+    Range indices;
+    bool live = false;
+  };
+
+  struct Retired {
+    uint32_t block;
+    Range vertices;
+    Range indices;
+  };
+
+  static bool takeRange(std::vector<Range> &freeRanges, uint32_t count,
+                        uint32_t &first);
+  static void releaseRange(std::vector<Range> &freeRanges, Range range);
+  static uint32_t freeCount(const std::vector<Range> &freeRanges);
+
+  void createBlockBuffers(Block &block);
+  void destroyBlockBuffers(Block &block);
+  uint32_t addBlock(uint32_t vertexCount, uint32_t indexCount);
+  bool fits(uint32_t blockIndex, uint32_t vertexCount,
+            uint32_t indexCount) const;
+  void compactBlock(uint32_t blockIndex, HtUploadScheduler &uploadScheduler);
+
+  HtDevice &htDevice;
+  uint32_t vertexStride;
+  uint32_t blockVertices;
+  uint32_t blockIndices;
+
+  std::vector<Block> blocks;
+  std::vector<Allocation> allocations;
+  std::vector<Handle> freeHandles;
+  // per frame index, see beginFrame()
+  std::vector<std::vector<Retired>> retired;
+  uint32_t currentFrame = 0;
+
+  uint64_t generation_ = 0;
+  uint32_t compactions = 0;
+  double lastCompactionMs = 0.0;
+};
+
+} // namespace ht
@@ -0,0 +1,246 @@
+#include "ht_host_allocator.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace ht {
+
+HtHostAllocator::HtHostAllocator(bool pooled) : pooled{pooled} {
+  callbacks_.pUserData = this;
+  callbacks_.pfnAllocation = allocate;
+  callbacks_.pfnReallocation = reallocate;
+  callbacks_.pfnFree = free;
+  callbacks_.pfnInternalAllocation = internalAllocation;
+  callbacks_.pfnInternalFree = internalFree;
+}
+
+HtHostAllocator::~HtHostAllocator() {
+  for (void *chunk : chunks) {
+    ::operator delete(chunk, std::align_val_t{POOL_ALIGNMENT});
+  }
+}
+
+VKAPI_ATTR void *VKAPI_CALL HtHostAllocator::allocate(
+    void *userData, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  return static_cast<HtHostAllocator *>(userData)->allocateBlock(
+      size, alignment, scope);
+}
+
+VKAPI_ATTR void *VKAPI_CALL HtHostAllocator::reallocate(
+    void *userData, void *original, size_t size, size_t alignment,
+    VkSystemAllocationScope scope) {
+  auto allocator = static_cast<HtHostAllocator *>(userData);
+  if (original == nullptr) {
+    return allocator->allocateBlock(size, alignment, scope);
+  }
+  if (size == 0) {
+    allocator->freeBlock(original);
+    return nullptr;
+  }
+
+  // the original must stay valid when the new allocation fails
+  void *memory = allocator->allocateBlock(size, alignment, scope);
+  if (memory == nullptr) {
+    return nullptr;
+  }
+  memcpy(memory, original, std::min(size, headerOf(original)->size));
+  allocator->freeBlock(original);
+  allocator->counters[scope].reallocations++;
+  return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HtHostAllocator::free(void *userData,
+                                                 void *memory) {
+  static_cast<HtHostAllocator *>(userData)->freeBlock(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HtHostAllocator::internalAllocation(
+    void *userData, size_t size, [[maybe_unused]] VkInternalAllocationType type,
+    VkSystemAllocationScope scope) {
+  auto allocator = static_cast<HtHostAllocator *>(userData);
+  allocator->counters[scope].internalBytes += static_cast<int64_t>(size);
+}
+
+VKAPI_ATTR void VKAPI_CALL HtHostAllocator::internalFree(
+    void *userData, size_t size, [[maybe_unused]] VkInternalAllocationType type,
+    VkSystemAllocationScope scope) {
+  auto allocator = static_cast<HtHostAllocator *>(userData);
+  allocator->counters[scope].internalBytes -= static_cast<int64_t>(size);
+}
+
+HtHostAllocator::Header *HtHostAllocator::headerOf(void *memory) {
+  return reinterpret_cast<Header *>(static_cast<char *>(memory) -
+                                    sizeof(Header));
+}
+
+uint8_t HtHostAllocator::sizeClassFor(size_t size, size_t alignment,
+                                      VkSystemAllocationScope scope) const {
+  if (!pooled || alignment > POOL_ALIGNMENT ||
+      (scope != VK_SYSTEM_ALLOCATION_SCOPE_COMMAND &&
+       scope != VK_SYSTEM_ALLOCATION_SCOPE_OBJECT)) {
+    return NO_SIZE_CLASS;
+  }
+  for (uint8_t i = 0; i < SIZE_CLASSES.size(); i++) {
+    if (size <= SIZE_CLASSES[i]) {
+      return i;
+    }
+  }
+  return NO_SIZE_CLASS;
+}
+
+void *HtHostAllocator::allocateBlock(size_t size, size_t alignment,
+                                     VkSystemAllocationScope scope) {
+  if (size == 0) {
+    return nullptr;
+  }
+  alignment = std::max(alignment, alignof(Header));
+  // the header sits right in front of the returned pointer
+  size_t headerSpace = (sizeof(Header) + alignment - 1) & ~(alignment - 1);
+  size_t total = headerSpace + size;
+
+  uint8_t sizeClass = sizeClassFor(total, alignment, scope);
+  void *block = sizeClass != NO_SIZE_CLASS
+                    ? poolAllocate(sizeClass)
+                    : ::operator new(total, std::align_val_t{alignment},
+                                     std::nothrow);
+  if (block == nullptr) {
+    return nullptr;
+  }
+
+  void *memory = static_cast<char *>(block) + headerSpace;
+  Header *header = headerOf(memory);
+  header->size = size;
+  header->offset = static_cast<uint32_t>(headerSpace);
+  header->alignment = static_cast<uint32_t>(alignment);
+  header->scope = static_cast<uint8_t>(scope);
+  header->sizeClass = sizeClass;
+
+  Counters &counter = counters[scope];
+  counter.allocations++;
+  int64_t live = counter.liveBytes += static_cast<int64_t>(size);
+  int64_t peak = counter.peakBytes.load();
+  while (live > peak && !counter.peakBytes.compare_exchange_weak(peak, live)) {
+  }
+  return memory;
+}
+
+void HtHostAllocator::freeBlock(void *memory) {
+  if (memory == nullptr) {
+    return;
+  }
+  Header header = *headerOf(memory);
+  Counters &counter = counters[header.scope];
+  counter.frees++;
+  counter.liveBytes -= static_cast<int64_t>(header.size);
+
+  void *block = static_cast<char *>(memory) - header.offset;
+  if (header.sizeClass != NO_SIZE_CLASS) {
+    poolFree(header.sizeClass, block);
+  } else {
+    ::operator delete(block, std::align_val_t{header.alignment});
+  }
+}
+
+void *HtHostAllocator::poolAllocate(uint8_t sizeClass) {
+  std::lock_guard<std::mutex> lock{poolMutex};
+  std::vector<void *> &blocks = freeBlocks[sizeClass];
+  if (blocks.empty()) {
+    void *chunk = ::operator new(
+        POOL_CHUNK_SIZE, std::align_val_t{POOL_ALIGNMENT}, std::nothrow);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunks.push_back(chunk);
+    size_t blockSize = SIZE_CLASSES[sizeClass];
+    for (size_t offset = 0; offset + blockSize <= POOL_CHUNK_SIZE;
+         offset += blockSize) {
+      blocks.push_back(static_cast<char *>(chunk) + offset);
+    }
+  }
+  void *block = blocks.back();
+  blocks.pop_back();
+  return block;
+}
+
+void HtHostAllocator::poolFree(uint8_t sizeClass, void *block) {
+  std::lock_guard<std::mutex> lock{poolMutex};
+  freeBlocks[sizeClass].push_back(block);
+}
+
+HtHostAllocator::ScopeStats
+HtHostAllocator::stats(VkSystemAllocationScope scope) const {
+  const Counters &counter = counters[scope];
+  ScopeStats stats;
+  stats.allocations = counter.allocations;
+  stats.frees = counter.frees;
+  stats.reallocations = counter.reallocations;
+  stats.liveBytes = counter.liveBytes;
+  stats.peakBytes = counter.peakBytes;
+  stats.internalBytes = counter.internalBytes;
+  return stats;
+}
+
+int64_t HtHostAllocator::liveBytes() const {
+  int64_t bytes = 0;
+  for (const Counters &counter : counters) {
+    bytes += counter.liveBytes;
+  }
+  return bytes;
+}
+
+const char *HtHostAllocator::scopeName(uint32_t scope) {
+  switch (scope) {
+  case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND:
+    return "command";
+  case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT:
+    return "object";
+  case VK_SYSTEM_ALLOCATION_SCOPE_CACHE:
+    return "cache";
+  case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE:
+    return "device";
+  case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE:
+    return "instance";
+  }
+  return "unknown";
+}
+
+void HtHostAllocator::printStats() const {
+  for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+    ScopeStats stats = this->stats(static_cast<VkSystemAllocationScope>(scope));
+    std::cout << "host allocations (" << scopeName(scope)
+              << "): " << stats.allocations << " allocs, " << stats.frees
+              << " frees, " << stats.reallocations << " reallocs, "
+              << stats.liveBytes / 1024 << " KiB live, "
+              << stats.peakBytes / 1024 << " KiB peak, "
+              << stats.internalBytes / 1024 << " KiB internal" << std::endl;
+  }
+  if (pooled) {
+    std::lock_guard<std::mutex> lock{poolMutex};
+    std::cout << "host allocation pool: " << chunks.size() << " chunks, "
+              << chunks.size() * POOL_CHUNK_SIZE / 1024 << " KiB" << std::endl;
+  }
+}
+
+uint64_t HtHostAllocator::reportLeaks() const {
+  uint64_t leaked = 0;
+  for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++) {
+    ScopeStats stats = this->stats(static_cast<VkSystemAllocationScope>(scope));
+    uint64_t live = stats.allocations - stats.frees;
+    if (live == 0) {
+      continue;
+    }
+    leaked += live;
+    std::cerr << "host allocator: " << live << " " << scopeName(scope)
+              << " scope allocations (" << stats.liveBytes
+              << " bytes) outlived the instance, a Vulkan object was not "
+                 "destroyed"
+              << std::endl;
+  }
+  return leaked;
+}
+
+} // namespace ht
@@ -0,0 +1,113 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ht {
+
+// VkAllocationCallbacks that count every host allocation the driver makes,
+// per VkSystemAllocationScope, with live and peak bytes. Optionally, small
+// command and object scope allocations are served from size class free lists
+// instead of the system heap.
+//
+// Allocations still live once the instance is gone point at Vulkan objects
+// that were never destroyed, see reportLeaks().
+class HtHostAllocator {
+public:
+  static constexpr uint32_t SCOPE_COUNT = 5; // VkSystemAllocationScope values
+
+  struct ScopeStats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t reallocations = 0;
+    int64_t liveBytes = 0;
+    int64_t peakBytes = 0;
+    // allocations the driver made itself and only reported
+    int64_t internalBytes = 0;
+  };
+
+  explicit HtHostAllocator(bool pooled);
+  ~HtHostAllocator();
+
+  HtHostAllocator(const HtHostAllocator &) = delete;
+  HtHostAllocator &operator=(const HtHostAllocator &) = delete;
+
+  const VkAllocationCallbacks *callbacks() const { return &callbacks_; }
+
+  ScopeStats stats(VkSystemAllocationScope scope) const;
+  int64_t liveBytes() const;
+  void printStats() const;
+  // prints and returns the number of allocations still live, call after the
+  // instance has been destroyed
+  uint64_t reportLeaks() const;
+
+  static const char *scopeName(uint32_t scope);
+
+private:
+  struct Counters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> reallocations{0};
+    std::atomic<int64_t> liveBytes{0};
+    std::atomic<int64_t> peakBytes{0};
+    std::atomic<int64_t> internalBytes{0};
+  };
+
+  // stored in front of every block handed to the driver
+  struct Header {
+    size_t size;
+    uint32_t offset; // from the start of the underlying block
+    uint32_t alignment;
+    uint8_t scope;
+    uint8_t sizeClass; // NO_SIZE_CLASS unless served by the pool
+  };
+
+  static constexpr uint8_t NO_SIZE_CLASS = 0xff;
+  // the pool only takes small, modestly aligned blocks
+  static constexpr std::array<size_t, 5> SIZE_CLASSES = {64, 128, 256, 512,
+                                                         1024};
+  static constexpr size_t POOL_ALIGNMENT = 64;
+  static constexpr size_t POOL_CHUNK_SIZE = 64 * 1024;
+
+  static VKAPI_ATTR void *VKAPI_CALL allocate(void *userData, size_t size,
+                                              size_t alignment,
+                                              VkSystemAllocationScope scope);
+  static VKAPI_ATTR void *VKAPI_CALL
+  reallocate(void *userData, void *original, size_t size, size_t alignment,
+             VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL free(void *userData, void *memory);
+  static VKAPI_ATTR void VKAPI_CALL
+  internalAllocation(void *userData, size_t size,
+                     VkInternalAllocationType type,
+                     VkSystemAllocationScope scope);
+  static VKAPI_ATTR void VKAPI_CALL
+  internalFree(void *userData, size_t size, VkInternalAllocationType type,
+               VkSystemAllocationScope scope);
+
+  void *allocateBlock(size_t size, size_t alignment,
+                      VkSystemAllocationScope scope);
+  void freeBlock(void *memory);
+  static Header *headerOf(void *memory);
+  uint8_t sizeClassFor(size_t size, size_t alignment,
+                       VkSystemAllocationScope scope) const;
+  void *poolAllocate(uint8_t sizeClass);
+  void poolFree(uint8_t sizeClass, void *block);
+
+  VkAllocationCallbacks callbacks_{};
+  bool pooled;
+  std::array<Counters, SCOPE_COUNT> counters;
+
+  mutable std::mutex poolMutex;
+  std::array<std::vector<void *>, SIZE_CLASSES.size()> freeBlocks;
+  std::vector<void *> chunks;
+};
+
+} // namespace ht
@@ -0,0 +1,385 @@
+#include "ht_indirect_renderer.hpp"
+
+#include "ht_env.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+namespace ht {
+
+// mirrors the push constant block of shaders/cull.comp
+struct CullPushConstantData {
+  uint32_t objectCount;
+  uint32_t compact;
+};
+
+static constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+HtIndirectRenderer::HtIndirectRenderer(HtDevice &device, uint32_t frameCount,
+                                       uint32_t maxDraws)
+    : htDevice{device}, frameCount{frameCount} {
+  assert(htDevice.multiDrawIndirectEnabled() &&
+         "indirect renderer needs multiDrawIndirect and "
+         "drawIndirectFirstInstance");
+
+  this->maxDraws =
+      std::min(maxDraws, htDevice.properties.limits.maxDrawIndirectCount);
+  gpuCulling = envNumber("HT_GPU_CULL", 1) != 0;
+  compaction = gpuCulling && htDevice.drawIndirectCountEnabled();
+
+  createDescriptorSetLayout();
+  createFrameResources();
+  createDescriptorSets();
+  if (gpuCulling) {
+    createCullPipeline();
+  }
+
+  const char *culling = !gpuCulling  ? "off"
+                        : compaction ? "on, compacted"
+                                     : "on, not compacted";
+  std::cout << "indirect renderer: " << this->maxDraws
+            << " draws, gpu culling " << culling << std::endl;
+}
+
+HtIndirectRenderer::~HtIndirectRenderer() {
+  if (gpuCulling) {
+    cullPipeline.reset();
+    vkDestroyPipelineLayout(htDevice.device(), cullPipelineLayout,
+                            htDevice.allocator());
+  }
+  vkDestroyDescriptorPool(htDevice.device(), descriptorPool,
+                          htDevice.allocator());
+  vkDestroyDescriptorSetLayout(htDevice.device(), descriptorSetLayout,
+                               htDevice.allocator());
+
+  for (auto &frame : frames) {
+    std::array<std::pair<VkBuffer, VkDeviceMemory>, 4> buffers = {
+        {{frame.objectBuffer, frame.objectMemory},
+         {frame.batchBuffer, frame.batchMemory},
+         {frame.commandBuffer, frame.commandMemory},
+         {frame.countBuffer, frame.countMemory}}};
+    for (auto &buffer : buffers) {
+      vkUnmapMemory(htDevice.device(), buffer.second);
+      vkDestroyBuffer(htDevice.device(), buffer.first, htDevice.allocator());
+      vkFreeMemory(htDevice.device(), buffer.second, htDevice.allocator());
+    }
+  }
+}
+
+void HtIndirectRenderer::createFrameResources() {
+  // everything stays host visible so the CPU path can write commands directly,
+  // the culling pass only touches each record once per frame
+  VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VkDeviceSize objectSize = sizeof(ObjectData) * maxDraws;
+  VkDeviceSize batchSize = sizeof(GpuBatch) * MAX_BATCHES;
+  VkDeviceSize commandSize = static_cast<VkDeviceSize>(COMMAND_STRIDE) *
+                             maxDraws;
+  VkDeviceSize countSize = sizeof(uint32_t) * MAX_BATCHES;
+
+  frames.resize(frameCount);
+  for (auto &frame : frames) {
+    htDevice.createBuffer(objectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                          hostVisible, frame.objectBuffer, frame.objectMemory);
+    htDevice.createBuffer(batchSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                          hostVisible, frame.batchBuffer, frame.batchMemory);
+    htDevice.createBuffer(commandSize,
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                              VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                          hostVisible, frame.commandBuffer,
+                          frame.commandMemory);
+    htDevice.createBuffer(countSize,
+                          VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                              VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                              VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                          hostVisible, frame.countBuffer, frame.countMemory);
+
+    void *data;
+    vkMapMemory(htDevice.device(), frame.objectMemory, 0, objectSize, 0,
+                &data);
+    frame.objects = static_cast<ObjectData *>(data);
+    vkMapMemory(htDevice.device(), frame.batchMemory, 0, batchSize, 0, &data);
+    frame.batches = static_cast<GpuBatch *>(data);
+    vkMapMemory(htDevice.device(), frame.commandMemory, 0, commandSize, 0,
+                &data);
+    frame.commands = static_cast<uint32_t *>(data);
+    // only mapped so teardown is uniform, the counts are GPU written
+    vkMapMemory(htDevice.device(), frame.countMemory, 0, countSize, 0, &data);
+  }
+}
+
+void HtIndirectRenderer::createDescriptorSetLayout() {
+  std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+  for (uint32_t i = 0; i < bindings.size(); i++) {
+    bindings[i].binding = i;
+    bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[i].descriptorCount = 1;
+    bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  }
+  // objects are also read by the vertex shader
+  bindings[0].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(htDevice.device(), &layoutInfo,
+                                  htDevice.allocator(),
+                                  &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create indirect set layout!");
+  }
+}
+
+void HtIndirectRenderer::createDescriptorSets() {
+  VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                4 * frameCount};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = frameCount;
+  poolInfo.poolSizeCount = 1;
+  poolInfo.pPoolSizes = &poolSize;
+
+  if (vkCreateDescriptorPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                             &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create indirect descriptor pool!");
+  }
+
+  for (auto &frame : frames) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(htDevice.device(), &allocInfo,
+                                 &frame.descriptorSet) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate indirect descriptor set!");
+    }
+
+    std::array<VkDescriptorBufferInfo, 4> bufferInfos = {
+        {{frame.objectBuffer, 0, VK_WHOLE_SIZE},
+         {frame.batchBuffer, 0, VK_WHOLE_SIZE},
+         {frame.commandBuffer, 0, VK_WHOLE_SIZE},
+         {frame.countBuffer, 0, VK_WHOLE_SIZE}}};
+    std::array<VkWriteDescriptorSet, 4> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = frame.descriptorSet;
+      writes[i].dstBinding = i;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(htDevice.device(),
+                           static_cast<uint32_t>(writes.size()), writes.data(),
+                           0, nullptr);
+  }
+}
+
+void HtIndirectRenderer::createCullPipeline() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(CullPushConstantData);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo,
+                             htDevice.allocator(),
+                             &cullPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create cull pipeline layout!");
+  }
+
+  cullPipeline = std::make_unique<HtComputePipeline>(
+      htDevice, "shaders/cull.comp.spv", cullPipelineLayout);
+}
+
+void HtIndirectRenderer::beginFrame(uint32_t frameIndex) {
+  assert(frameIndex < frameCount && "frame index out of range");
+  currentFrame = frameIndex;
+  pendingDraws.clear();
+}
+
+void HtIndirectRenderer::addDraw(HtModel &model, const ObjectData &object) {
+  if (pendingDraws.size() >= maxDraws) {
+    throw std::runtime_error("indirect renderer out of draw records!");
+  }
+  pendingDraws.push_back({&model, object});
+}
+
+void HtIndirectRenderer::writeCommand(uint32_t *command, const Batch &batch,
+                                      uint32_t objectIndex) {
+  if (batch.model->hasIndexBuffer()) {
+    // indexCount, instanceCount, firstIndex, vertexOffset, firstInstance
+    command[0] = batch.model->getIndexCount();
+    command[1] = 1;
+    command[2] = batch.model->getFirstIndex();
+    command[3] = batch.model->getFirstVertex();
+    command[4] = objectIndex;
+  } else {
+    // vertexCount, instanceCount, firstVertex, firstInstance
+    command[0] = batch.model->getVertexCount();
+    command[1] = 1;
+    command[2] = batch.model->getFirstVertex();
+    command[3] = objectIndex;
+    command[4] = 0;
+  }
+}
+
+void HtIndirectRenderer::buildBatches() {
+  batches.clear();
+  batchLookup.clear();
+  for (auto &draw : pendingDraws) {
+    auto result = batchLookup.emplace(
+        draw.model, static_cast<uint32_t>(batches.size()));
+    if (result.second) {
+      if (batches.size() == MAX_BATCHES) {
+        throw std::runtime_error("indirect renderer out of batches!");
+      }
+      batches.push_back({draw.model, 0, 0});
+    }
+    batches[result.first->second].objectCount++;
+  }
+
+  // objects are laid out contiguously per batch, so a batch's commands are a
+  // single range whether or not they get compacted
+  FrameResources &frame = frames[currentFrame];
+  uint32_t firstObject = 0;
+  for (uint32_t i = 0; i < batches.size(); i++) {
+    Batch &batch = batches[i];
+    batch.firstObject = firstObject;
+    firstObject += batch.objectCount;
+
+    GpuBatch &gpuBatch = frame.batches[i];
+    gpuBatch.indexed = batch.model->hasIndexBuffer() ? 1 : 0;
+    gpuBatch.elementCount = batch.model->hasIndexBuffer()
+                                ? batch.model->getIndexCount()
+                                : batch.model->getVertexCount();
+    gpuBatch.firstCommand = batch.firstObject;
+    gpuBatch.objectCount = batch.objectCount;
+    gpuBatch.firstElement = batch.model->hasIndexBuffer()
+                                ? batch.model->getFirstIndex()
+                                : batch.model->getFirstVertex();
+    gpuBatch.vertexOffset =
+        static_cast<int32_t>(batch.model->getFirstVertex());
+    batch.objectCount = 0; // reused as the fill cursor below
+  }
+
+  for (auto &draw : pendingDraws) {
+    uint32_t batchIndex = batchLookup[draw.model];
+    Batch &batch = batches[batchIndex];
+    uint32_t objectIndex = batch.firstObject + batch.objectCount++;
+
+    ObjectData &object = frame.objects[objectIndex];
+    object = draw.object;
+    object.boundingRadius = draw.model->getBoundingRadius();
+    object.drawBatch = batchIndex;
+
+    if (!gpuCulling) {
+      writeCommand(frame.commands + objectIndex * (COMMAND_STRIDE / 4), batch,
+                   objectIndex);
+    }
+  }
+}
+
+void HtIndirectRenderer::recordCull(VkCommandBuffer commandBuffer) {
+  buildBatches();
+  if (!gpuCulling || pendingDraws.empty()) {
+    return;
+  }
+
+  FrameResources &frame = frames[currentFrame];
+  if (compaction) {
+    vkCmdFillBuffer(commandBuffer, frame.countBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask =
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1,
+                         &clearBarrier, 0, nullptr, 0, nullptr);
+  }
+
+  CullPushConstantData push{};
+  push.objectCount = static_cast<uint32_t>(pendingDraws.size());
+  push.compact = compaction ? 1 : 0;
+
+  cullPipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          cullPipelineLayout, 0, 1, &frame.descriptorSet, 0,
+                          nullptr);
+  vkCmdPushConstants(commandBuffer, cullPipelineLayout,
+                     VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                     sizeof(CullPushConstantData), &push);
+  vkCmdDispatch(commandBuffer,
+                (push.objectCount + CULL_WORKGROUP_SIZE - 1) /
+                    CULL_WORKGROUP_SIZE,
+                1, 1);
+
+  VkMemoryBarrier cullBarrier{};
+  cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &cullBarrier,
+                       0, nullptr, 0, nullptr);
+}
+
+void HtIndirectRenderer::recordDraws(VkCommandBuffer commandBuffer,
+                                     VkPipelineLayout pipelineLayout,
+                                     uint32_t set) {
+  if (pendingDraws.empty()) {
+    return;
+  }
+
+  FrameResources &frame = frames[currentFrame];
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          pipelineLayout, set, 1, &frame.descriptorSet, 0,
+                          nullptr);
+
+  HtModel *boundModel = nullptr;
+  for (uint32_t i = 0; i < batches.size(); i++) {
+    const Batch &batch = batches[i];
+    VkDeviceSize offset =
+        static_cast<VkDeviceSize>(batch.firstObject) * COMMAND_STRIDE;
+    bool indexed = batch.model->hasIndexBuffer();
+    // the commands carry the model offsets, so pooled models share a bind
+    if (boundModel == nullptr || !batch.model->sharesBuffers(*boundModel)) {
+      batch.model->bind(commandBuffer);
+      boundModel = batch.model;
+    }
+
+    if (compaction) {
+      VkDeviceSize countOffset = sizeof(uint32_t) * i;
+      if (indexed) {
+        htDevice.cmdDrawIndexedIndirectCount(
+            commandBuffer, frame.commandBuffer, offset, frame.countBuffer,
+            countOffset, batch.objectCount, COMMAND_STRIDE);
+      } else {
+        htDevice.cmdDrawIndirectCount(commandBuffer, frame.commandBuffer,
+                                      offset, frame.countBuffer, countOffset,
+                                      batch.objectCount, COMMAND_STRIDE);
+      }
+    } else if (indexed) {
+      vkCmdDrawIndexedIndirect(commandBuffer, frame.commandBuffer, offset,
+                               batch.objectCount, COMMAND_STRIDE);
+    } else {
+      vkCmdDrawIndirect(commandBuffer, frame.commandBuffer, offset,
+                        batch.objectCount, COMMAND_STRIDE);
+    }
+  }
+}
+
+} // namespace ht
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ht_compute_pipeline.hpp"
+#include "ht_device.hpp"
+#include "ht_model.hpp"
+#include "ht_object_data.hpp"
+
+// std lib headers
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace ht {
+
+// Draws every object of a frame through indirect commands instead of one
+// vkCmdDraw per object. Objects are grouped by model into batches; each
+// object becomes one VkDrawIndirectCommand / VkDrawIndexedIndirectCommand
+// whose firstInstance is the object index, so the vertex shader reads
+// ObjectData from set `set` binding 0 with gl_InstanceIndex.
+//
+// With GPU culling (default, HT_GPU_CULL=0 disables it) a compute pre-pass
+// writes the commands. When VK_KHR_draw_indirect_count is available it also
+// compacts them and the draw count comes from the GPU; otherwise culled
+// objects keep their record with instanceCount = 0. Either way the CPU
+// records one indirect draw per batch regardless of the object count.
+class HtIndirectRenderer {
+public:
+  static constexpr uint32_t DEFAULT_MAX_DRAWS = 16 * 1024;
+  static constexpr uint32_t MAX_BATCHES = 256;
+  // one record fits both command layouts, non-indexed ones leave the last
+  // word unused
+  static constexpr uint32_t COMMAND_STRIDE =
+      sizeof(VkDrawIndexedIndirectCommand);
+
+  HtIndirectRenderer(HtDevice &device, uint32_t frameCount,
+                     uint32_t maxDraws = DEFAULT_MAX_DRAWS);
+  ~HtIndirectRenderer();
+
+  HtIndirectRenderer(const HtIndirectRenderer &) = delete;
+  HtIndirectRenderer &operator=(const HtIndirectRenderer &) = delete;
+
+  // must only be called once the GPU is done with frameIndex's previous use
+  void beginFrame(uint32_t frameIndex);
+  void addDraw(HtModel &model, const ObjectData &object);
+
+  // writes this frame's object and batch data and, with GPU culling, records
+  // the culling dispatch. Must be recorded outside of a render pass
+  void recordCull(VkCommandBuffer commandBuffer);
+  // expects a graphics pipeline whose layout has getDescriptorSetLayout() at
+  // `set`
+  void recordDraws(VkCommandBuffer commandBuffer,
+                   VkPipelineLayout pipelineLayout, uint32_t set);
+
+  VkDescriptorSetLayout getDescriptorSetLayout() { return descriptorSetLayout; }
+  bool gpuCullingEnabled() { return gpuCulling; }
+  bool compactionEnabled() { return compaction; }
+  uint32_t drawCount() { return static_cast<uint32_t>(pendingDraws.size()); }
+
+private:
+  struct PendingDraw {
+    HtModel *model;
+    ObjectData object;
+  };
+
+  struct Batch {
+    HtModel *model;
+    uint32_t firstObject;
+    uint32_t objectCount;
+  };
+
+  // std430 mirror of shaders/cull.comp DrawBatch
+  struct GpuBatch {
+    uint32_t elementCount; // index count for indexed models, else vertices
+    uint32_t indexed;
+    uint32_t firstCommand;
+    uint32_t objectCount;
+    // where the model lives in its buffers: firstIndex for indexed models,
+    // else firstVertex, and the vertexOffset of indexed draws
+    uint32_t firstElement;
+    int32_t vertexOffset;
+  };
+
+  struct FrameResources {
+    VkBuffer objectBuffer;
+    VkDeviceMemory objectMemory;
+    VkBuffer batchBuffer;
+    VkDeviceMemory batchMemory;
+    VkBuffer commandBuffer;
+    VkDeviceMemory commandMemory;
+    VkBuffer countBuffer;
+    VkDeviceMemory countMemory;
+    ObjectData *objects;
+    GpuBatch *batches;
+    uint32_t *commands;
+    VkDescriptorSet descriptorSet;
+  };
+
+  void createFrameResources();
+  void createDescriptorSetLayout();
+  void createDescriptorSets();
+  void createCullPipeline();
+  void buildBatches();
+  void writeCommand(uint32_t *command, const Batch &batch,
+                    uint32_t objectIndex);
+
+  HtDevice &htDevice;
+  uint32_t frameCount;
+  uint32_t maxDraws;
+  bool gpuCulling;
+  bool compaction;
+
+  std::vector<FrameResources> frames;
+  uint32_t currentFrame = 0;
+
+  std::vector<PendingDraw> pendingDraws;
+  std::vector<Batch> batches;
+  std::unordered_map<HtModel *, uint32_t> batchLookup;
+
+  VkDescriptorSetLayout descriptorSetLayout;
+  VkDescriptorPool descriptorPool;
+  VkPipelineLayout cullPipelineLayout;
+  std::unique_ptr<HtComputePipeline> cullPipeline;
+};
+
+} // namespace ht
@@ -0,0 +1,49 @@
+#include "ht_lod_chain.hpp"
+
+// std
+#include <algorithm>
+#include <limits>
+
+namespace ht {
+
+void HtLodChain::addLevel(std::unique_ptr<HtModel> model,
+                          const std::vector<HtModel::Vertex> &vertices,
+                          const std::vector<uint32_t> &indices) {
+  levels.push_back({std::move(model), smallestEdge(vertices, indices)});
+}
+
+HtModel *HtLodChain::select(VkExtent2D extent, float scale) {
+  // clip space spans two units across the shorter side of the target
+  float pixelsPerUnit =
+      scale * 0.5f * static_cast<float>(std::min(extent.width, extent.height));
+
+  selected = levelCount();
+  for (uint32_t i = 0; i < levelCount(); i++) {
+    if (levels[i].smallestEdge * pixelsPerUnit < targetPixels) {
+      break;
+    }
+    if (levels[i].model->isReady()) {
+      selected = i;
+    }
+  }
+  return selected < levelCount() ? levels[selected].model.get() : nullptr;
+}
+
+float HtLodChain::smallestEdge(const std::vector<HtModel::Vertex> &vertices,
+                               const std::vector<uint32_t> &indices) {
+  auto corner = [&](size_t i) {
+    return vertices[indices.empty() ? i : indices[i]].position;
+  };
+  size_t cornerCount = indices.empty() ? vertices.size() : indices.size();
+  float smallest = std::numeric_limits<float>::max();
+  for (size_t i = 0; i + 2 < cornerCount; i += 3) {
+    glm::vec2 a = corner(i);
+    glm::vec2 b = corner(i + 1);
+    glm::vec2 c = corner(i + 2);
+    smallest = std::min({smallest, glm::length(b - a), glm::length(c - b),
+                         glm::length(a - c)});
+  }
+  return smallest;
+}
+
+} // namespace ht
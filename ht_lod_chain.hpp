@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ht_model.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ht {
+
+// Versions of one model at increasing detail, all covering the same bounds.
+// select() picks the finest level whose smallest triangle still covers about
+// a pixel, so sub-pixel triangles never reach the rasterizer.
+class HtLodChain {
+public:
+  static constexpr float DEFAULT_TARGET_PIXELS = 1.0f;
+
+  HtLodChain() = default;
+
+  HtLodChain(const HtLodChain &) = delete;
+  HtLodChain &operator=(const HtLodChain &) = delete;
+
+  // levels are added from coarsest to finest, without indices every three
+  // vertices form a triangle
+  void addLevel(std::unique_ptr<HtModel> model,
+                const std::vector<HtModel::Vertex> &vertices,
+                const std::vector<uint32_t> &indices = {});
+
+  // extent of the target in pixels, scale of the model to clip space.
+  // Levels still uploading are skipped in favour of coarser ones; null when
+  // even the coarsest level's triangles fall below the target size
+  HtModel *select(VkExtent2D extent, float scale = 1.0f);
+
+  uint32_t levelCount() const { return static_cast<uint32_t>(levels.size()); }
+  HtModel &level(uint32_t index) { return *levels[index].model; }
+  // level picked by the last select() call, levelCount() when none
+  uint32_t selectedLevel() const { return selected; }
+  void setTargetPixels(float pixels) { targetPixels = pixels; }
+
+  // shortest edge of a triangle list, in model space
+  static float smallestEdge(const std::vector<HtModel::Vertex> &vertices,
+                            const std::vector<uint32_t> &indices = {});
+
+private:
+  struct Level {
+    std::unique_ptr<HtModel> model;
+    float smallestEdge;
+  };
+
+  std::vector<Level> levels;
+  float targetPixels = DEFAULT_TARGET_PIXELS;
+  uint32_t selected = 0;
+};
+
+} // namespace ht
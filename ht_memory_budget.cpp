@@ -0,0 +1,108 @@
+#include "ht_memory_budget.hpp"
+
+#include "ht_env.hpp"
+
+// std
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace ht {
+
+HtMemoryBudget::HtMemoryBudget(HtDevice &device) : htDevice{device} {
+  vkGetPhysicalDeviceMemoryProperties(htDevice.getPhysicalDevice(),
+                                      &memoryProperties);
+  heaps_.resize(memoryProperties.memoryHeapCount);
+  pressured.resize(memoryProperties.memoryHeapCount, false);
+  for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+    const VkMemoryHeap &heap = memoryProperties.memoryHeaps[i];
+    heaps_[i].size = heap.size;
+    heaps_[i].budget = heap.size;
+    heaps_[i].deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+  }
+
+  logStats = envFlag("HT_MEMORY_STATS");
+  pressureFraction =
+      envNumber("HT_MEMORY_PRESSURE", DEFAULT_PRESSURE_FRACTION);
+  std::string csvPath = envString("HT_MEMORY_CSV");
+  if (!csvPath.empty()) {
+    csv.open(csvPath);
+    if (!csv.is_open()) {
+      throw std::runtime_error("failed to open memory csv: " + csvPath);
+    }
+    csv << "frame,heap,device_local,size,budget,usage" << std::endl;
+  }
+  if (!htDevice.memoryBudgetEnabled()) {
+    std::cout << "memory budget: not supported, reporting heap sizes only"
+              << std::endl;
+  }
+}
+
+void HtMemoryBudget::update(uint64_t frameNumber) {
+  if (htDevice.memoryBudgetEnabled()) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+    budget.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties2.pNext = &budget;
+    vkGetPhysicalDeviceMemoryProperties2(htDevice.getPhysicalDevice(),
+                                         &properties2);
+    for (uint32_t i = 0; i < heaps_.size(); i++) {
+      heaps_[i].budget = budget.heapBudget[i];
+      heaps_[i].usage = budget.heapUsage[i];
+    }
+  }
+
+  // edge triggered, so a throttling streamer is told once per crossing
+  for (uint32_t i = 0; i < heaps_.size(); i++) {
+    bool over = heaps_[i].load() >= pressureFraction;
+    if (over == pressured[i]) {
+      continue;
+    }
+    pressured[i] = over;
+    if (pressureCallback) {
+      pressureCallback(i, heaps_[i], over);
+    }
+  }
+
+  if (csv.is_open() || (logStats && frameNumber % LOG_INTERVAL == 0)) {
+    log(frameNumber);
+  }
+}
+
+VkDeviceSize HtMemoryBudget::headroom(VkMemoryPropertyFlags properties) const {
+  VkDeviceSize best = 0;
+  for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+    const VkMemoryType &type = memoryProperties.memoryTypes[i];
+    if ((type.propertyFlags & properties) != properties) {
+      continue;
+    }
+    const Heap &heap = heaps_[type.heapIndex];
+    if (heap.budget > heap.usage) {
+      best = std::max(best, heap.budget - heap.usage);
+    }
+  }
+  return best;
+}
+
+void HtMemoryBudget::log(uint64_t frameNumber) {
+  constexpr double MiB = 1024.0 * 1024.0;
+  for (uint32_t i = 0; i < heaps_.size(); i++) {
+    const Heap &heap = heaps_[i];
+    if (csv.is_open()) {
+      csv << frameNumber << ',' << i << ',' << heap.deviceLocal << ','
+          << heap.size << ',' << heap.budget << ',' << heap.usage << '\n';
+    }
+    if (logStats && frameNumber % LOG_INTERVAL == 0) {
+      std::cout << "memory heap " << i
+                << (heap.deviceLocal ? " (device local): " : ": ")
+                << heap.usage / MiB << " / " << heap.budget / MiB
+                << " MiB budget, " << heap.size / MiB << " MiB heap"
+                << std::endl;
+    }
+  }
+}
+
+} // namespace ht
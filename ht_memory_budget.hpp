@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace ht {
+
+// Per-heap GPU memory usage and budget, refreshed by update() once per frame.
+// With VK_EXT_memory_budget the numbers come from the driver and include
+// other processes' pressure; without it the budget is the heap size and
+// usage is unknown (0).
+//
+// HT_MEMORY_STATS=1 prints the heaps every LOG_INTERVAL frames,
+// HT_MEMORY_CSV=<file> writes one row per heap and frame and
+// HT_MEMORY_PRESSURE=<fraction> sets the default pressure threshold.
+class HtMemoryBudget {
+public:
+  static constexpr uint32_t LOG_INTERVAL = 120;
+  static constexpr double DEFAULT_PRESSURE_FRACTION = 0.9;
+
+  struct Heap {
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    bool deviceLocal = false;
+    // usage / budget
+    double load() const {
+      return budget > 0 ? static_cast<double>(usage) / budget : 0.0;
+    }
+  };
+
+  // called once when a heap's load rises above the pressure fraction, and
+  // again with underPressure false once it falls back below
+  using PressureCallback =
+      std::function<void(uint32_t heapIndex, const Heap &heap,
+                         bool underPressure)>;
+
+  HtMemoryBudget(HtDevice &device);
+
+  HtMemoryBudget(const HtMemoryBudget &) = delete;
+  HtMemoryBudget &operator=(const HtMemoryBudget &) = delete;
+
+  void update(uint64_t frameNumber);
+
+  const std::vector<Heap> &heaps() const { return heaps_; }
+  bool underPressure(uint32_t heapIndex) const {
+    return pressured[heapIndex];
+  }
+  // free bytes before the budget of the heap backing memory types with these
+  // properties is reached
+  VkDeviceSize headroom(VkMemoryPropertyFlags properties) const;
+
+  // fraction of the budget that counts as pressure, HT_MEMORY_PRESSURE or
+  // DEFAULT_PRESSURE_FRACTION unless set
+  void setPressureFraction(double fraction) { pressureFraction = fraction; }
+  void setPressureCallback(PressureCallback callback) {
+    pressureCallback = std::move(callback);
+  }
+
+private:
+  void log(uint64_t frameNumber);
+
+  HtDevice &htDevice;
+  bool logStats = false;
+  std::ofstream csv;
+
+  std::vector<Heap> heaps_;
+  std::vector<bool> pressured;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+
+  double pressureFraction = DEFAULT_PRESSURE_FRACTION;
+  PressureCallback pressureCallback;
+};
+
+} // namespace ht
@@ -0,0 +1,329 @@
+#include "ht_mesh_optimizer.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace ht {
+
+static constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+HtMeshOptimizer::Report HtMeshOptimizer::optimize(HtMesh &mesh) const {
+  Report report;
+  uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+  report.verticesBefore = vertexCount;
+  if (mesh.indices.empty()) {
+    std::vector<uint32_t> sequential(vertexCount);
+    std::iota(sequential.begin(), sequential.end(), 0);
+    report.before = analyzeCache(sequential, vertexCount, options.cacheSize);
+  } else {
+    report.before =
+        analyzeCache(mesh.indices, vertexCount, options.cacheSize);
+  }
+
+  weldVertices(mesh);
+  // a trailing partial triangle is never drawn, and tipsify() only tracks
+  // whole ones
+  mesh.indices.resize(mesh.indices.size() - mesh.indices.size() % 3);
+  report.triangleCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+  vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+  if (report.triangleCount > 0) {
+    std::vector<uint32_t> clusterStarts;
+    mesh.indices = tipsify(mesh.indices, vertexCount, options.cacheSize,
+                           clusterStarts);
+    if (options.optimizeOverdraw) {
+      sortClusters(mesh, mesh.indices, clusterStarts);
+    }
+    reorderVertices(mesh);
+  }
+
+  report.verticesAfter = static_cast<uint32_t>(mesh.vertices.size());
+  report.after =
+      analyzeCache(mesh.indices, report.verticesAfter, options.cacheSize);
+  return report;
+}
+
+std::vector<HtMeshOptimizer::Report>
+HtMeshOptimizer::optimize(std::vector<HtMesh> &meshes,
+                          HtThreadPool &pool) const {
+  std::vector<Report> reports(meshes.size());
+  pool.parallelFor(static_cast<uint32_t>(meshes.size()), 1,
+                   [&](uint32_t begin, uint32_t end) {
+                     for (uint32_t i = begin; i < end; i++) {
+                       reports[i] = optimize(meshes[i]);
+                     }
+                   });
+  return reports;
+}
+
+HtMeshOptimizer::CacheStats
+HtMeshOptimizer::analyzeCache(const std::vector<uint32_t> &indices,
+                              uint32_t vertexCount, uint32_t cacheSize) {
+  CacheStats stats;
+  if (indices.empty() || vertexCount == 0) {
+    return stats;
+  }
+  // a vertex is cached while fewer than cacheSize misses followed its own
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> used(vertexCount, false);
+  uint32_t time = cacheSize + 1;
+  uint32_t misses = 0;
+  uint32_t uniqueVertices = 0;
+  for (uint32_t index : indices) {
+    if (time - cacheTime[index] > cacheSize) {
+      cacheTime[index] = time++;
+      misses++;
+    }
+    if (!used[index]) {
+      used[index] = true;
+      uniqueVertices++;
+    }
+  }
+  stats.acmr = static_cast<double>(misses) / (indices.size() / 3);
+  stats.atvr = static_cast<double>(misses) / uniqueVertices;
+  return stats;
+}
+
+// bitwise comparison, so only exact duplicates are merged
+void HtMeshOptimizer::weldVertices(HtMesh &mesh) {
+  using Vertex = HtModel::Vertex;
+  const std::vector<Vertex> &vertices = mesh.vertices;
+  auto hash = [&vertices](uint32_t index) {
+    // FNV-1a over the vertex bytes
+    const auto *bytes = reinterpret_cast<const uint8_t *>(&vertices[index]);
+    size_t value = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(Vertex); i++) {
+      value = (value ^ bytes[i]) * 1099511628211ull;
+    }
+    return value;
+  };
+  auto equal = [&vertices](uint32_t a, uint32_t b) {
+    return memcmp(&vertices[a], &vertices[b], sizeof(Vertex)) == 0;
+  };
+  std::unordered_map<uint32_t, uint32_t, decltype(hash), decltype(equal)>
+      lookup(vertices.size(), hash, equal);
+
+  std::vector<uint32_t> remap(vertices.size());
+  std::vector<Vertex> welded;
+  welded.reserve(vertices.size());
+  for (uint32_t i = 0; i < vertices.size(); i++) {
+    auto result =
+        lookup.emplace(i, static_cast<uint32_t>(welded.size()));
+    if (result.second) {
+      welded.push_back(vertices[i]);
+    }
+    remap[i] = result.first->second;
+  }
+
+  if (mesh.indices.empty()) {
+    mesh.indices = std::move(remap);
+  } else {
+    for (uint32_t &index : mesh.indices) {
+      index = remap[index];
+    }
+  }
+  mesh.vertices = std::move(welded);
+}
+
+// fans around one vertex at a time and picks the next fanning vertex among
+// the ones just emitted, preferring those that will still be in the cache
+// once their remaining triangles are emitted
+std::vector<uint32_t>
+HtMeshOptimizer::tipsify(const std::vector<uint32_t> &indices,
+                         uint32_t vertexCount, uint32_t cacheSize,
+                         std::vector<uint32_t> &clusterStarts) {
+  uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+  // triangles around each vertex
+  std::vector<uint32_t> liveTriangles(vertexCount, 0);
+  for (uint32_t index : indices) {
+    liveTriangles[index]++;
+  }
+  std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+  }
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyOffsets.begin(),
+                             adjacencyOffsets.end() - 1);
+  for (uint32_t i = 0; i < indices.size(); i++) {
+    adjacency[fill[indices[i]]++] = i / 3;
+  }
+
+  std::vector<uint32_t> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnds;
+  deadEnds.reserve(indices.size());
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+
+  uint32_t time = cacheSize + 1;
+  uint32_t cursor = 0;
+  uint32_t fanning = indices[0];
+  clusterStarts.assign(1, 0);
+  while (fanning != NO_VERTEX) {
+    candidates.clear();
+    for (uint32_t a = adjacencyOffsets[fanning];
+         a < adjacencyOffsets[fanning + 1]; a++) {
+      uint32_t triangle = adjacency[a];
+      if (emitted[triangle]) {
+        continue;
+      }
+      emitted[triangle] = true;
+      for (uint32_t corner = 0; corner < 3; corner++) {
+        uint32_t v = indices[triangle * 3 + corner];
+        result.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        liveTriangles[v]--;
+        if (time - cacheTime[v] > cacheSize) {
+          cacheTime[v] = time++;
+        }
+      }
+    }
+
+    // candidates that would drop out of the cache before their triangles
+    // are done rank lowest
+    uint32_t next = NO_VERTEX;
+    int64_t bestPriority = -1;
+    for (uint32_t v : candidates) {
+      if (liveTriangles[v] == 0) {
+        continue;
+      }
+      int64_t priority = 0;
+      if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+        priority = time - cacheTime[v];
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = v;
+      }
+    }
+
+    if (next == NO_VERTEX) {
+      // dead end: the most recent vertex with work left, else input order
+      while (!deadEnds.empty() && next == NO_VERTEX) {
+        uint32_t v = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[v] > 0) {
+          next = v;
+        }
+      }
+      while (cursor < vertexCount && next == NO_VERTEX) {
+        if (liveTriangles[cursor] > 0) {
+          next = cursor;
+        }
+        cursor++;
+      }
+      if (next != NO_VERTEX) {
+        clusterStarts.push_back(static_cast<uint32_t>(result.size() / 3));
+      }
+    }
+    fanning = next;
+  }
+  return result;
+}
+
+// Sander et al.'s view independent sort: clusters facing away from the
+// mesh center are likely occluders and go first. Positions are taken as
+// z = 0, so flat meshes have no preferred order and keep the cache order
+void HtMeshOptimizer::sortClusters(
+    const HtMesh &mesh, std::vector<uint32_t> &indices,
+    const std::vector<uint32_t> &clusterStarts) const {
+  uint32_t clusterCount = static_cast<uint32_t>(clusterStarts.size());
+  if (clusterCount < 2) {
+    return;
+  }
+  uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+  auto position = [&](uint32_t index) {
+    glm::vec2 p = mesh.vertices[index].position;
+    return glm::vec3{p.x, p.y, 0.0f};
+  };
+
+  struct Cluster {
+    uint32_t firstTriangle;
+    uint32_t triangleCount;
+    glm::vec3 centroid{0.0f};
+    glm::vec3 normal{0.0f};
+    float area = 0.0f;
+    float sortKey = 0.0f;
+  };
+  std::vector<Cluster> clusters(clusterCount);
+  glm::vec3 meshCentroid{0.0f};
+  float meshArea = 0.0f;
+  for (uint32_t i = 0; i < clusterCount; i++) {
+    Cluster &cluster = clusters[i];
+    cluster.firstTriangle = clusterStarts[i];
+    uint32_t end = i + 1 < clusterCount ? clusterStarts[i + 1] : triangleCount;
+    cluster.triangleCount = end - cluster.firstTriangle;
+    for (uint32_t t = cluster.firstTriangle; t < end; t++) {
+      glm::vec3 a = position(indices[t * 3]);
+      glm::vec3 b = position(indices[t * 3 + 1]);
+      glm::vec3 c = position(indices[t * 3 + 2]);
+      glm::vec3 normal = glm::cross(b - a, c - a);
+      float area = 0.5f * glm::length(normal);
+      cluster.normal += normal;
+      cluster.centroid += (a + b + c) * (area / 3.0f);
+      cluster.area += area;
+    }
+    meshCentroid += cluster.centroid;
+    meshArea += cluster.area;
+  }
+  if (meshArea > 0.0f) {
+    meshCentroid = meshCentroid / meshArea;
+  }
+  for (Cluster &cluster : clusters) {
+    float normalLength = glm::length(cluster.normal);
+    if (cluster.area > 0.0f && normalLength > 0.0f) {
+      glm::vec3 centroid = cluster.centroid / cluster.area;
+      cluster.sortKey = glm::dot(centroid - meshCentroid,
+                                 cluster.normal / normalLength);
+    }
+  }
+
+  std::vector<uint32_t> order(clusterCount);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    return clusters[a].sortKey > clusters[b].sortKey;
+  });
+
+  std::vector<uint32_t> sorted;
+  sorted.reserve(indices.size());
+  for (uint32_t c : order) {
+    auto first = indices.begin() + clusters[c].firstTriangle * 3;
+    sorted.insert(sorted.end(), first,
+                  first + clusters[c].triangleCount * 3);
+  }
+
+  // the sort breaks up the cache order at every cluster boundary
+  uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+  double cacheAcmr =
+      analyzeCache(indices, vertexCount, options.cacheSize).acmr;
+  double sortedAcmr =
+      analyzeCache(sorted, vertexCount, options.cacheSize).acmr;
+  if (sortedAcmr <= cacheAcmr * options.overdrawThreshold) {
+    indices = std::move(sorted);
+  }
+}
+
+// renumbers vertices in the order the index buffer first uses them, which
+// also drops unreferenced ones
+void HtMeshOptimizer::reorderVertices(HtMesh &mesh) {
+  std::vector<uint32_t> remap(mesh.vertices.size(), NO_VERTEX);
+  std::vector<HtModel::Vertex> ordered;
+  ordered.reserve(mesh.vertices.size());
+  for (uint32_t &index : mesh.indices) {
+    if (remap[index] == NO_VERTEX) {
+      remap[index] = static_cast<uint32_t>(ordered.size());
+      ordered.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  mesh.vertices = std::move(ordered);
+}
+
+} // namespace ht
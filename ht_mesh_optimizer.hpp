@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ht_model.hpp"
+#include "ht_thread_pool.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace ht {
+
+// Triangle list as it goes into HtModel; no indices means every three
+// vertices form a triangle.
+struct HtMesh {
+  std::vector<HtModel::Vertex> vertices;
+  std::vector<uint32_t> indices;
+};
+
+// Reorders meshes before upload for the post-transform cache and for vertex
+// fetch locality:
+//   1. identical vertices are welded, which makes the mesh indexed
+//   2. triangles are reordered with Tipsify (Sander et al. 2007)
+//   3. optionally, Tipsify's clusters are sorted so outward facing ones draw
+//      first, as long as the cache efficiency stays within a threshold
+//   4. vertices are renumbered in first-use order of the new index buffer
+class HtMeshOptimizer {
+public:
+  static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+
+  struct Options {
+    // FIFO entries Tipsify and the statistics assume
+    uint32_t cacheSize = DEFAULT_CACHE_SIZE;
+    bool optimizeOverdraw = false;
+    // largest ACMR increase over the cache order the overdraw sort may cost
+    float overdrawThreshold = 1.05f;
+  };
+
+  // simulated with a FIFO of cacheSize entries
+  struct CacheStats {
+    // transformed vertices per triangle, 0.5 at best and 3 at worst
+    double acmr = 0.0;
+    // transformed vertices per unique vertex, 1 at best
+    double atvr = 0.0;
+  };
+
+  struct Report {
+    CacheStats before;
+    CacheStats after;
+    uint32_t triangleCount = 0;
+    uint32_t verticesBefore = 0;
+    uint32_t verticesAfter = 0;
+  };
+
+  explicit HtMeshOptimizer(const Options &options) : options{options} {}
+  HtMeshOptimizer() : HtMeshOptimizer(Options{}) {}
+
+  Report optimize(HtMesh &mesh) const;
+  // one mesh per task, the caller's thread included
+  std::vector<Report> optimize(std::vector<HtMesh> &meshes,
+                               HtThreadPool &pool) const;
+
+  static CacheStats analyzeCache(const std::vector<uint32_t> &indices,
+                                 uint32_t vertexCount, uint32_t cacheSize);
+
+private:
+  static void weldVertices(HtMesh &mesh);
+  // fills clusterStarts with the first triangle of every cluster Tipsify
+  // started after a dead end
+  static std::vector<uint32_t>
+  tipsify(const std::vector<uint32_t> &indices, uint32_t vertexCount,
+          uint32_t cacheSize, std::vector<uint32_t> &clusterStarts);
+  void sortClusters(const HtMesh &mesh, std::vector<uint32_t> &indices,
+                    const std::vector<uint32_t> &clusterStarts) const;
+  static void reorderVertices(HtMesh &mesh);
+
+  Options options;
+};
+
+} // namespace ht
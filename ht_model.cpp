@@ -1,16 +1,85 @@
 #include "ht_model.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
 namespace ht {
 HtModel::HtModel(HtDevice &device, const std::vector<Vertex> &vertices)
     : htDevice{device} {
+  computeBounds(vertices);
   createVertexBuffers(vertices);
 }
+HtModel::HtModel(HtDevice &device, const std::vector<Vertex> &vertices,
+                 const std::vector<uint32_t> &indices)
+    : htDevice{device} {
+  computeBounds(vertices);
+  createVertexBuffers(vertices);
+  createIndexBuffer(indices);
+}
+HtModel::HtModel(HtDevice &device, HtUploadScheduler &uploadScheduler,
+                 const std::vector<Vertex> &vertices)
+    : htDevice{device} {
+  computeBounds(vertices);
+  createVertexBuffers(uploadScheduler, vertices);
+}
+HtModel::HtModel(HtDevice &device, HtUploadScheduler &uploadScheduler,
+                 const std::vector<Vertex> &vertices,
+                 const std::vector<uint32_t> &indices)
+    : htDevice{device} {
+  computeBounds(vertices);
+  createVertexBuffers(uploadScheduler, vertices);
+  createIndexBuffer(uploadScheduler, indices);
+}
+HtModel::HtModel(HtDevice &device, HtGeometryPool &geometryPool,
+                 HtUploadScheduler &uploadScheduler,
+                 const std::vector<Vertex> &vertices,
+                 const std::vector<uint32_t> &indices)
+    : htDevice{device}, geometryPool{&geometryPool} {
+  computeBounds(vertices);
+  vertexCount = static_cast<uint32_t>(vertices.size());
+  indexCount = static_cast<uint32_t>(indices.size());
+  assert(vertexCount >= 3 &&
+         "Failed to have at least a triangle in vertices (3 vertices)!");
+  assert(sizeof(Vertex) == geometryPool.getVertexStride() &&
+         "geometry pool holds another vertex format");
+  (*pendingUploads)++;
+  geometryHandle = geometryPool.allocate(
+      uploadScheduler, vertices.data(), vertexCount, indices,
+      [pending = pendingUploads]() { (*pending)--; });
+}
 HtModel::~HtModel() {
-  vkDestroyBuffer(htDevice.device(), vertexBuffer, nullptr);
-  vkFreeMemory(htDevice.device(), vertexBufferMemory, nullptr);
+  if (geometryPool) {
+    // the pool keeps the ranges until frames in flight are done
+    geometryPool->free(geometryHandle);
+    return;
+  }
+  // frames in flight may still read the buffers
+  VkDevice device = htDevice.device();
+  const VkAllocationCallbacks *allocator = htDevice.allocator();
+  VkBuffer vertices = vertexBuffer;
+  VkDeviceMemory vertexMemory = vertexBufferMemory;
+  VkBuffer indices = indexBuffer;
+  VkDeviceMemory indexMemory = indexBufferMemory;
+  htDevice.deletionQueue().push(
+      [device, allocator, vertices, vertexMemory, indices, indexMemory]() {
+        vkDestroyBuffer(device, vertices, allocator);
+        vkFreeMemory(device, vertexMemory, allocator);
+        vkDestroyBuffer(device, indices, allocator);
+        vkFreeMemory(device, indexMemory, allocator);
+      });
+}
+
+void HtModel::computeBounds(const std::vector<Vertex> &vertices) {
+  if (vertices.empty()) {
+    return;
+  }
+  boundsMin = boundsMax = vertices[0].position;
+  for (const auto &vertex : vertices) {
+    boundsMin = glm::min(boundsMin, vertex.position);
+    boundsMax = glm::max(boundsMax, vertex.position);
+    boundingRadius = std::max(boundingRadius, glm::length(vertex.position));
+  }
 }
 
 void HtModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
@@ -18,7 +87,10 @@ void HtModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   assert(vertexCount >= 3 &&
          "Failed to have at least a triangle in vertices (3 vertices)!");
   VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-  htDevice.createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+  // transfer source so command traces can read the contents back
+  htDevice.createBuffer(bufferSize,
+                        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
                         vertexBuffer, vertexBufferMemory);
@@ -30,13 +102,78 @@ void HtModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   vkUnmapMemory(htDevice.device(), vertexBufferMemory);
 }
 
+void HtModel::createIndexBuffer(const std::vector<uint32_t> &indices) {
+  indexCount = static_cast<uint32_t>(indices.size());
+  assert(indexCount >= 3 && "Failed to have at least a triangle in indices!");
+  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+  htDevice.createBuffer(bufferSize,
+                        VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        indexBuffer, indexBufferMemory);
+
+  void *data;
+  vkMapMemory(htDevice.device(), indexBufferMemory, 0, bufferSize, 0, &data);
+  memcpy(data, indices.data(), static_cast<size_t>(bufferSize));
+  vkUnmapMemory(htDevice.device(), indexBufferMemory);
+}
+
+void HtModel::createVertexBuffers(HtUploadScheduler &uploadScheduler,
+                                  const std::vector<Vertex> &vertices) {
+  vertexCount = static_cast<uint32_t>(vertices.size());
+  assert(vertexCount >= 3 &&
+         "Failed to have at least a triangle in vertices (3 vertices)!");
+  VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
+  htDevice.createBuffer(
+      bufferSize,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+
+  (*pendingUploads)++;
+  uploadScheduler.uploadBuffer(
+      vertexBuffer, 0, vertices.data(), bufferSize,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+      [pending = pendingUploads]() { (*pending)--; });
+}
+
+void HtModel::createIndexBuffer(HtUploadScheduler &uploadScheduler,
+                                const std::vector<uint32_t> &indices) {
+  indexCount = static_cast<uint32_t>(indices.size());
+  assert(indexCount >= 3 && "Failed to have at least a triangle in indices!");
+  VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+  htDevice.createBuffer(
+      bufferSize,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+          VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
+
+  (*pendingUploads)++;
+  uploadScheduler.uploadBuffer(
+      indexBuffer, 0, indices.data(), bufferSize,
+      VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT,
+      [pending = pendingUploads]() { (*pending)--; });
+}
+
+// pooled models bind the whole block, so models sharing it can skip the
+// bind and still draw at their own offsets
 void HtModel::bind(VkCommandBuffer commandBuffer) {
-  VkBuffer buffers[] = {vertexBuffer};
+  VkBuffer buffers[] = {getVertexBuffer()};
   VkDeviceSize offsets[] = {0};
   vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+  if (hasIndexBuffer()) {
+    vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(), 0,
+                         VK_INDEX_TYPE_UINT32);
+  }
 }
-void HtModel::draw(VkCommandBuffer commandBuffer) {
-  vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+void HtModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount) {
+  if (hasIndexBuffer()) {
+    vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, getFirstIndex(),
+                     static_cast<int32_t>(getFirstVertex()), 0);
+  } else {
+    vkCmdDraw(commandBuffer, vertexCount, instanceCount, getFirstVertex(), 0);
+  }
 }
 
 std::vector<VkVertexInputBindingDescription>
@@ -1,7 +1,12 @@
 #pragma once
 
 #include "ht_device.hpp"
+#include "ht_geometry_pool.hpp"
+#include "ht_sort_id.hpp"
+#include "ht_upload_scheduler.hpp"
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #define GLM_FORCE_RADIANS
@@ -23,20 +28,89 @@ public:
   };
 
   HtModel(HtDevice &device, const std::vector<Vertex> &vertices);
+  HtModel(HtDevice &device, const std::vector<Vertex> &vertices,
+          const std::vector<uint32_t> &indices);
+  // streams the vertices into device local memory through the scheduler, the
+  // model must not be drawn until isReady() returns true
+  HtModel(HtDevice &device, HtUploadScheduler &uploadScheduler,
+          const std::vector<Vertex> &vertices);
+  HtModel(HtDevice &device, HtUploadScheduler &uploadScheduler,
+          const std::vector<Vertex> &vertices,
+          const std::vector<uint32_t> &indices);
+  // streamed into ranges of the pool's shared buffers instead of buffers of
+  // its own, the pool must outlive the model
+  HtModel(HtDevice &device, HtGeometryPool &geometryPool,
+          HtUploadScheduler &uploadScheduler,
+          const std::vector<Vertex> &vertices,
+          const std::vector<uint32_t> &indices = {});
   ~HtModel();
 
   HtModel(const HtModel &) = delete;
   HtModel &operator=(const HtModel &) = delete;
 
   void bind(VkCommandBuffer commandBuffer);
-  void draw(VkCommandBuffer commandBuffer);
+  void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1);
+  bool isReady() const { return *pendingUploads == 0; }
+  // bind() of other would bind the same buffers, e.g. both live in one
+  // geometry pool block
+  bool sharesBuffers(const HtModel &other) const {
+    return getVertexBuffer() == other.getVertexBuffer() &&
+           getIndexBuffer() == other.getIndexBuffer();
+  }
+
+  bool hasIndexBuffer() const { return indexCount > 0; }
+  uint32_t getVertexCount() const { return vertexCount; }
+  uint32_t getIndexCount() const { return indexCount; }
+  VkBuffer getVertexBuffer() const {
+    return geometryPool ? geometryPool->vertexBuffer(geometryHandle)
+                        : vertexBuffer;
+  }
+  VkBuffer getIndexBuffer() const {
+    if (!hasIndexBuffer()) {
+      return VK_NULL_HANDLE;
+    }
+    return geometryPool ? geometryPool->indexBuffer(geometryHandle)
+                        : indexBuffer;
+  }
+  // where the model starts in its buffers, in vertices and indices; draws
+  // pass them as firstVertex / vertexOffset and firstIndex
+  uint32_t getFirstVertex() const {
+    return geometryPool ? geometryPool->firstVertex(geometryHandle) : 0;
+  }
+  uint32_t getFirstIndex() const {
+    return geometryPool ? geometryPool->firstIndex(geometryHandle) : 0;
+  }
+  // draw queue sort key id, unique among live models
+  uint32_t getSortId() const { return sortId.value(); }
+  // bounds in model space, computed once from the vertices
+  float getBoundingRadius() const { return boundingRadius; }
+  glm::vec2 getBoundsMin() const { return boundsMin; }
+  glm::vec2 getBoundsMax() const { return boundsMax; }
 
 private:
   HtDevice &htDevice;
-  VkBuffer vertexBuffer;
-  VkDeviceMemory vertexBufferMemory;
+  HtGeometryPool *geometryPool = nullptr;
+  HtGeometryPool::Handle geometryHandle = HtGeometryPool::INVALID_HANDLE;
+  VkBuffer vertexBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
   uint32_t vertexCount;
+  VkBuffer indexBuffer = VK_NULL_HANDLE;
+  VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+  uint32_t indexCount = 0;
+  float boundingRadius = 0.0f;
+  glm::vec2 boundsMin{0.0f};
+  glm::vec2 boundsMax{0.0f};
+  // shared with the upload callbacks so a model destroyed mid-upload is safe
+  std::shared_ptr<std::atomic<uint32_t>> pendingUploads =
+      std::make_shared<std::atomic<uint32_t>>(0);
+  HtSortId<HtModel> sortId;
 
+  void computeBounds(const std::vector<Vertex> &vertices);
   void createVertexBuffers(const std::vector<Vertex> &vertices);
+  void createIndexBuffer(const std::vector<uint32_t> &indices);
+  void createVertexBuffers(HtUploadScheduler &uploadScheduler,
+                           const std::vector<Vertex> &vertices);
+  void createIndexBuffer(HtUploadScheduler &uploadScheduler,
+                         const std::vector<uint32_t> &indices);
 };
 } // namespace ht
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // glm assumes openGl standard, depth [-1,1]
+                                    // instead of [0,1]
+#include <glm/glm.hpp>
+
+// std
+#include <cstddef>
+#include <cstdint>
+
+namespace ht {
+
+// per-object data read by shaders from storage buffers, matches the std430
+// layout of
+//   struct ObjectData { vec2 offset; float boundingRadius; uint drawBatch;
+//                       vec3 color; }
+// (32 bytes). boundingRadius and drawBatch are only read by the indirect
+// culling pass and sit in what would otherwise be padding.
+struct ObjectData {
+  glm::vec2 offset;
+  float boundingRadius = 0.0f;
+  uint32_t drawBatch = 0;
+  alignas(16) glm::vec3 color;
+};
+
+static_assert(sizeof(ObjectData) == 32 && offsetof(ObjectData, color) == 16,
+              "ObjectData must match std430 layout");
+
+} // namespace ht
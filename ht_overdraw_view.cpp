@@ -0,0 +1,441 @@
+#include "ht_overdraw_view.hpp"
+
+// std
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace ht {
+
+// mirrors the push constant block of shaders/overdraw_resolve.frag
+struct ResolvePushConstantData {
+  float rampMax;
+};
+
+static constexpr uint32_t STATS_WORKGROUP_SIZE = 16;
+
+HtOverdrawView::HtOverdrawView(HtDevice &device, uint32_t frameCount)
+    : htDevice{device}, frames(frameCount) {
+  createRenderPass();
+  createSampler();
+  createDescriptorSets();
+  createPipelineLayouts();
+  statsPipeline = std::make_unique<HtComputePipeline>(
+      htDevice, "shaders/overdraw_stats.comp.spv", statsPipelineLayout);
+
+  std::vector<HtModel::Vertex> vertices{{{-1.0f, -1.0f}, {0.0f, 0.0f, 0.0f}},
+                                        {{3.0f, -1.0f}, {0.0f, 0.0f, 0.0f}},
+                                        {{-1.0f, 3.0f}, {0.0f, 0.0f, 0.0f}}};
+  fullscreenTriangle = std::make_unique<HtModel>(htDevice, vertices);
+}
+
+HtOverdrawView::~HtOverdrawView() {
+  // frames in flight may still use the targets, pipelines go through the
+  // deletion queue on their own
+  VkDevice device = htDevice.device();
+  const VkAllocationCallbacks *allocator = htDevice.allocator();
+  for (Frame &frame : frames) {
+    Frame retired = frame;
+    htDevice.deletionQueue().push([device, allocator, retired]() {
+      vkDestroyFramebuffer(device, retired.framebuffer, allocator);
+      vkDestroyImageView(device, retired.imageView, allocator);
+      vkDestroyImage(device, retired.image, allocator);
+      vkFreeMemory(device, retired.imageMemory, allocator);
+      vkDestroyBuffer(device, retired.statsBuffer, allocator);
+      vkFreeMemory(device, retired.statsMemory, allocator);
+    });
+  }
+  resolvePipeline.reset();
+  statsPipeline.reset();
+  VkRenderPass retiredRenderPass = renderPass;
+  VkSampler retiredSampler = sampler;
+  VkDescriptorPool retiredPool = descriptorPool;
+  htDevice.deletionQueue().push(
+      [device, allocator, retiredRenderPass, retiredSampler, retiredPool]() {
+        vkDestroyDescriptorPool(device, retiredPool, allocator);
+        vkDestroySampler(device, retiredSampler, allocator);
+        vkDestroyRenderPass(device, retiredRenderPass, allocator);
+      });
+  vkDestroyPipelineLayout(device, resolvePipelineLayout, allocator);
+  vkDestroyPipelineLayout(device, statsPipelineLayout, allocator);
+  vkDestroyDescriptorSetLayout(device, descriptorSetLayout, allocator);
+}
+
+// the count target is cleared on load and left ready for the resolve and
+// reduction reads, which also have to finish before the next clear
+void HtOverdrawView::createRenderPass() {
+  VkAttachmentDescription countAttachment{};
+  countAttachment.format = COUNT_FORMAT;
+  countAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  countAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  countAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  countAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  countAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  countAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  countAttachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+  VkAttachmentReference countAttachmentRef{};
+  countAttachmentRef.attachment = 0;
+  countAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &countAttachmentRef;
+
+  VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask = readStages;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = readStages;
+  dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = 1;
+  renderPassInfo.pAttachments = &countAttachment;
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(htDevice.device(), &renderPassInfo,
+                         htDevice.allocator(), &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw render pass!");
+  }
+}
+
+// counts are only ever fetched texel by texel
+void HtOverdrawView::createSampler() {
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.maxLod = 0.0f;
+
+  if (vkCreateSampler(htDevice.device(), &samplerInfo, htDevice.allocator(),
+                      &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw sampler!");
+  }
+}
+
+void HtOverdrawView::createDescriptorSets() {
+  std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+  bindings[0].binding = 0;
+  bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  bindings[0].descriptorCount = 1;
+  bindings[0].stageFlags =
+      VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+  bindings[1].binding = 1;
+  bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+  bindings[1].descriptorCount = 1;
+  bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+  VkDescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+  layoutInfo.pBindings = bindings.data();
+
+  if (vkCreateDescriptorSetLayout(htDevice.device(), &layoutInfo,
+                                  htDevice.allocator(),
+                                  &descriptorSetLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw set layout!");
+  }
+
+  uint32_t frameCount = static_cast<uint32_t>(frames.size());
+  std::array<VkDescriptorPoolSize, 2> poolSizes = {
+      {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount},
+       {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount}}};
+
+  VkDescriptorPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+  poolInfo.maxSets = frameCount;
+  poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+  poolInfo.pPoolSizes = poolSizes.data();
+
+  if (vkCreateDescriptorPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                             &descriptorPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw descriptor pool!");
+  }
+
+  // the stats buffers never change, the image binding is written whenever
+  // the count target is recreated
+  for (Frame &frame : frames) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(htDevice.device(), &allocInfo,
+                                 &frame.descriptorSet) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate overdraw descriptor set!");
+    }
+
+    htDevice.createBuffer(sizeof(GpuStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                          frame.statsBuffer, frame.statsMemory);
+    void *data;
+    vkMapMemory(htDevice.device(), frame.statsMemory, 0, sizeof(GpuStats), 0,
+                &data);
+    frame.gpuStats = static_cast<GpuStats *>(data);
+    *frame.gpuStats = GpuStats{};
+
+    VkDescriptorBufferInfo bufferInfo{frame.statsBuffer, 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = frame.descriptorSet;
+    write.dstBinding = 1;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(htDevice.device(), 1, &write, 0, nullptr);
+  }
+}
+
+void HtOverdrawView::createPipelineLayouts() {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(ResolvePushConstantData);
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo,
+                             htDevice.allocator(),
+                             &resolvePipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create resolve pipeline layout!");
+  }
+
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo,
+                             htDevice.allocator(),
+                             &statsPipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw stats layout!");
+  }
+}
+
+void HtOverdrawView::configureScenePipeline(PipelineConfigInfo &configInfo) {
+  configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
+  configInfo.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  configInfo.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+  configInfo.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+  configInfo.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+  configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+  // the count pass has no depth attachment, every rasterized fragment counts
+  configInfo.depthStencilInfo.depthTestEnable = VK_FALSE;
+  configInfo.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  configInfo.renderPass = renderPass;
+  configInfo.subpass = 0;
+  configInfo.colorAttachmentFormat = COUNT_FORMAT;
+  configInfo.depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+}
+
+void HtOverdrawView::createResolvePipeline(HtSwapChain &swapChain) {
+  PipelineConfigInfo pipelineConfig{};
+  HtPipeline::defaultPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  pipelineConfig.renderPass = swapChain.getRenderPass();
+  pipelineConfig.colorAttachmentFormat = swapChain.getSwapChainImageFormat();
+  pipelineConfig.depthAttachmentFormat = swapChain.getDepthFormat();
+  pipelineConfig.pipelineLayout = resolvePipelineLayout;
+  resolvePipeline = std::make_unique<HtPipeline>(
+      htDevice, "shaders/overdraw_resolve.vert.spv",
+      "shaders/overdraw_resolve.frag.spv", pipelineConfig);
+}
+
+bool HtOverdrawView::beginFrame(uint32_t frameIndex, uint64_t frameNumber,
+                                VkExtent2D extent) {
+  assert(frameIndex < frames.size() && "frame index out of range");
+  currentFrame = frameIndex;
+  Frame &frame = frames[frameIndex];
+
+  bool collected = frame.recorded;
+  if (collected) {
+    const GpuStats &gpuStats = *frame.gpuStats;
+    uint64_t pixels =
+        static_cast<uint64_t>(frame.extent.width) * frame.extent.height;
+    stats.frameNumber = frame.frameNumber;
+    stats.averageCovered =
+        gpuStats.coveredPixels == 0
+            ? 0.0
+            : static_cast<double>(gpuStats.fragments) / gpuStats.coveredPixels;
+    stats.averageScreen =
+        pixels == 0 ? 0.0 : static_cast<double>(gpuStats.fragments) / pixels;
+    stats.maxOverdraw = gpuStats.maxCount;
+  }
+  // host writes are visible to the next submission without a barrier
+  *frame.gpuStats = GpuStats{};
+  frame.recorded = false;
+  frame.frameNumber = frameNumber;
+
+  if (frame.extent.width != extent.width ||
+      frame.extent.height != extent.height) {
+    destroyCountTarget(frame);
+    createCountTarget(frame, extent);
+  }
+  return collected;
+}
+
+void HtOverdrawView::beginCount(VkCommandBuffer commandBuffer) {
+  Frame &frame = frames[currentFrame];
+
+  VkClearValue clearValue{};
+  clearValue.color = {{0.0f, 0.0f, 0.0f, 0.0f}};
+
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = renderPass;
+  renderPassInfo.framebuffer = frame.framebuffer;
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = frame.extent;
+  renderPassInfo.clearValueCount = 1;
+  renderPassInfo.pClearValues = &clearValue;
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                       VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void HtOverdrawView::endCount(VkCommandBuffer commandBuffer) {
+  Frame &frame = frames[currentFrame];
+  vkCmdEndRenderPass(commandBuffer);
+
+  statsPipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          statsPipelineLayout, 0, 1, &frame.descriptorSet, 0,
+                          nullptr);
+  vkCmdDispatch(
+      commandBuffer,
+      (frame.extent.width + STATS_WORKGROUP_SIZE - 1) / STATS_WORKGROUP_SIZE,
+      (frame.extent.height + STATS_WORKGROUP_SIZE - 1) / STATS_WORKGROUP_SIZE,
+      1);
+
+  // read on the host once the frame fence has been waited on
+  VkMemoryBarrier statsBarrier{};
+  statsBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &statsBarrier, 0,
+                       nullptr, 0, nullptr);
+  frame.recorded = true;
+}
+
+void HtOverdrawView::recordResolve(VkCommandBuffer commandBuffer) {
+  assert(resolvePipeline != nullptr && "resolve pipeline not created");
+  Frame &frame = frames[currentFrame];
+
+  resolvePipeline->bind(commandBuffer);
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                          resolvePipelineLayout, 0, 1, &frame.descriptorSet, 0,
+                          nullptr);
+  ResolvePushConstantData push{};
+  push.rampMax = rampMax;
+  vkCmdPushConstants(commandBuffer, resolvePipelineLayout,
+                     VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+                     sizeof(ResolvePushConstantData), &push);
+  fullscreenTriangle->bind(commandBuffer);
+  fullscreenTriangle->draw(commandBuffer);
+}
+
+void HtOverdrawView::createCountTarget(Frame &frame, VkExtent2D extent) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = extent.width;
+  imageInfo.extent.height = extent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = COUNT_FORMAT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage =
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  htDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               frame.image, frame.imageMemory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = frame.image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = COUNT_FORMAT;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(htDevice.device(), &viewInfo, htDevice.allocator(),
+                        &frame.imageView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw image view!");
+  }
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = renderPass;
+  framebufferInfo.attachmentCount = 1;
+  framebufferInfo.pAttachments = &frame.imageView;
+  framebufferInfo.width = extent.width;
+  framebufferInfo.height = extent.height;
+  framebufferInfo.layers = 1;
+  if (vkCreateFramebuffer(htDevice.device(), &framebufferInfo,
+                          htDevice.allocator(),
+                          &frame.framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create overdraw framebuffer!");
+  }
+
+  VkDescriptorImageInfo imageDescriptor{};
+  imageDescriptor.sampler = sampler;
+  imageDescriptor.imageView = frame.imageView;
+  imageDescriptor.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = frame.descriptorSet;
+  write.dstBinding = 0;
+  write.descriptorCount = 1;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.pImageInfo = &imageDescriptor;
+  vkUpdateDescriptorSets(htDevice.device(), 1, &write, 0, nullptr);
+
+  frame.extent = extent;
+}
+
+// only called for a slot the GPU is done with
+void HtOverdrawView::destroyCountTarget(Frame &frame) {
+  vkDestroyFramebuffer(htDevice.device(), frame.framebuffer,
+                       htDevice.allocator());
+  vkDestroyImageView(htDevice.device(), frame.imageView, htDevice.allocator());
+  vkDestroyImage(htDevice.device(), frame.image, htDevice.allocator());
+  vkFreeMemory(htDevice.device(), frame.imageMemory, htDevice.allocator());
+  frame.framebuffer = VK_NULL_HANDLE;
+  frame.imageView = VK_NULL_HANDLE;
+  frame.image = VK_NULL_HANDLE;
+  frame.imageMemory = VK_NULL_HANDLE;
+  frame.extent = {0, 0};
+}
+
+} // namespace ht
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "ht_compute_pipeline.hpp"
+#include "ht_device.hpp"
+#include "ht_model.hpp"
+#include "ht_pipeline.hpp"
+#include "ht_swap_chain.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ht {
+
+// Overdraw heat map. While active, the scene is drawn with pipeline variants
+// from configureScenePipeline() into a per-frame count target, where every
+// fragment adds one through additive blending. A compute pass reduces the
+// counts to per-frame figures and the resolve draw maps them to a color ramp
+// in the swap chain pass.
+class HtOverdrawView {
+public:
+  // blendable everywhere and exact up to 2048 layers
+  static constexpr VkFormat COUNT_FORMAT = VK_FORMAT_R16_SFLOAT;
+  static constexpr float DEFAULT_RAMP_MAX = 8.0f;
+
+  struct Stats {
+    uint64_t frameNumber = 0;
+    // fragments per pixel that was drawn at all, and per screen pixel
+    double averageCovered = 0.0;
+    double averageScreen = 0.0;
+    uint32_t maxOverdraw = 0;
+  };
+
+  HtOverdrawView(HtDevice &device, uint32_t frameCount);
+  ~HtOverdrawView();
+
+  HtOverdrawView(const HtOverdrawView &) = delete;
+  HtOverdrawView &operator=(const HtOverdrawView &) = delete;
+
+  // turns a default config into the counting variant of a scene pipeline:
+  // additive blending, no depth test or writes, the count render pass
+  void configureScenePipeline(PipelineConfigInfo &configInfo);
+  // the resolve pipeline draws into the swap chain, so it follows its
+  // render pass and formats
+  void createResolvePipeline(HtSwapChain &swapChain);
+
+  // collects the slot's figures and resizes its count target, true when
+  // lastStats() changed. Must only be called once the GPU is done with
+  // frameIndex's previous use
+  bool beginFrame(uint32_t frameIndex, uint64_t frameNumber,
+                  VkExtent2D extent);
+  // scene draws go between these two, outside of any other render pass;
+  // endCount() also records the reduction
+  void beginCount(VkCommandBuffer commandBuffer);
+  void endCount(VkCommandBuffer commandBuffer);
+  // inside the swap chain pass, replaces the scene
+  void recordResolve(VkCommandBuffer commandBuffer);
+
+  // figures of the most recent frame whose reduction has finished
+  const Stats &lastStats() const { return stats; }
+  void setRampMax(float rampMax) { this->rampMax = rampMax; }
+
+private:
+  // mirrors the stats buffer of shaders/overdraw_stats.comp
+  struct GpuStats {
+    uint32_t fragments;
+    uint32_t coveredPixels;
+    uint32_t maxCount;
+  };
+
+  struct Frame {
+    VkExtent2D extent{0, 0};
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkBuffer statsBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory statsMemory = VK_NULL_HANDLE;
+    GpuStats *gpuStats = nullptr;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    uint64_t frameNumber = 0;
+    bool recorded = false;
+  };
+
+  void createRenderPass();
+  void createSampler();
+  void createDescriptorSets();
+  void createPipelineLayouts();
+  void createCountTarget(Frame &frame, VkExtent2D extent);
+  void destroyCountTarget(Frame &frame);
+
+  HtDevice &htDevice;
+  std::vector<Frame> frames;
+  uint32_t currentFrame = 0;
+  float rampMax = DEFAULT_RAMP_MAX;
+  Stats stats;
+
+  VkRenderPass renderPass;
+  VkSampler sampler;
+  VkDescriptorSetLayout descriptorSetLayout;
+  VkDescriptorPool descriptorPool;
+  VkPipelineLayout resolvePipelineLayout;
+  VkPipelineLayout statsPipelineLayout;
+  std::unique_ptr<HtPipeline> resolvePipeline;
+  std::unique_ptr<HtComputePipeline> statsPipeline;
+  // one triangle covering the screen
+  std::unique_ptr<HtModel> fullscreenTriangle;
+};
+
+} // namespace ht
@@ -11,14 +11,21 @@ namespace ht {
 HtPipeline::HtPipeline(HtDevice &device, const std::string &vertFilePath,
                        const std::string &fragFilePath,
                        const PipelineConfigInfo &configInfo)
-    : htDevice{device} {
+    : htDevice{device}, vertFilePath{vertFilePath},
+      fragFilePath{fragFilePath} {
   createGraphicsPipeline(vertFilePath, fragFilePath, configInfo);
 }
 
 HtPipeline::~HtPipeline() {
-  vkDestroyShaderModule(htDevice.device(), vertShaderModule, nullptr);
-  vkDestroyShaderModule(htDevice.device(), fragShaderModule, nullptr);
-  vkDestroyPipeline(htDevice.device(), graphicsPipeline, nullptr);
+  VkDevice device = htDevice.device();
+  const VkAllocationCallbacks *allocator = htDevice.allocator();
+  vkDestroyShaderModule(device, vertShaderModule, allocator);
+  vkDestroyShaderModule(device, fragShaderModule, allocator);
+  // command buffers still in flight may reference the pipeline
+  VkPipeline pipeline = graphicsPipeline;
+  htDevice.deletionQueue().push([device, pipeline, allocator]() {
+    vkDestroyPipeline(device, pipeline, allocator);
+  });
 }
 
 std::vector<char> HtPipeline::readFile(const std::string &filePath) {
@@ -43,9 +50,10 @@ void HtPipeline::createGraphicsPipeline(const std::string &vertFilePath,
   assert(configInfo.pipelineLayout != VK_NULL_HANDLE &&
          "Cannot Create graphics pipeline [no pipelineLayout provided in "
          "configInfo]");
-  assert(configInfo.renderPass != VK_NULL_HANDLE &&
-         "Cannot Create graphics pipeline [no renderpass provided in "
-         "configInfo]");
+  assert((configInfo.renderPass != VK_NULL_HANDLE ||
+          configInfo.colorAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+         "Cannot Create graphics pipeline [no renderpass or attachment "
+         "formats provided in configInfo]");
 
   auto vertCode = readFile(vertFilePath);
   auto fragCode = readFile(fragFilePath);
@@ -100,11 +108,22 @@ void HtPipeline::createGraphicsPipeline(const std::string &vertFilePath,
   pipelineInfo.renderPass = configInfo.renderPass;
   pipelineInfo.subpass = configInfo.subpass;
 
+  // without a render pass the attachment formats are given directly
+  VkPipelineRenderingCreateInfoKHR renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+  if (configInfo.renderPass == VK_NULL_HANDLE) {
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &configInfo.colorAttachmentFormat;
+    renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+    pipelineInfo.pNext = &renderingInfo;
+    pipelineInfo.subpass = 0;
+  }
+
   pipelineInfo.basePipelineIndex = -1;
   pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
   if (vkCreateGraphicsPipelines(htDevice.device(), VK_NULL_HANDLE, 1,
-                                &pipelineInfo, nullptr,
+                                &pipelineInfo, htDevice.allocator(),
                                 &graphicsPipeline) != VK_SUCCESS) {
     throw std::runtime_error("failed to create graphics pipeline!");
   }
@@ -119,7 +138,7 @@ void HtPipeline::createShaderModule(const std::vector<char> &code,
       code.data()); // can do because vec allocator ensures char array satisfies
                     // worst-case alignment
 
-  if (vkCreateShaderModule(htDevice.device(), &createInfo, nullptr,
+  if (vkCreateShaderModule(htDevice.device(), &createInfo, htDevice.allocator(),
                            shaderModule) != VK_SUCCESS) {
     throw std::runtime_error("failed to create shader module!");
   }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ht_device.hpp"
+#include "ht_sort_id.hpp"
 
 #include <string>
 #include <vector>
@@ -19,6 +20,9 @@ struct PipelineConfigInfo {
   VkPipelineLayout pipelineLayout = nullptr;
   VkRenderPass renderPass = nullptr;
   uint32_t subpass = 0;
+  // used instead of renderPass for dynamic rendering
+  VkFormat colorAttachmentFormat = VK_FORMAT_UNDEFINED;
+  VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
 
   PipelineConfigInfo(const PipelineConfigInfo &) = delete;
   PipelineConfigInfo &operator=(const PipelineConfigInfo &) = delete;
@@ -35,11 +39,15 @@ public:
   HtPipeline &operator=(const HtPipeline &) = delete;
 
   void bind(VkCommandBuffer commandBuffer);
+  const std::string &getVertFilePath() const { return vertFilePath; }
+  const std::string &getFragFilePath() const { return fragFilePath; }
+  // draw queue sort key id, unique among live pipelines
+  uint32_t getSortId() const { return sortId.value(); }
 
   static void defaultPipelineConfigInfo(PipelineConfigInfo &configInfo);
+  static std::vector<char> readFile(const std::string &filePath);
 
 private:
-  static std::vector<char> readFile(const std::string &filePath);
 
   void createGraphicsPipeline(const std::string &vertFilePath,
                               const std::string &fragFilePath,
@@ -48,8 +56,11 @@ private:
   void createShaderModule(const std::vector<char> &code,
                           VkShaderModule *shaderModule);
   HtDevice &htDevice; // device outlives any pipeline, so memory-safe
+  std::string vertFilePath;
+  std::string fragFilePath;
   VkPipeline graphicsPipeline;
   VkShaderModule vertShaderModule;
   VkShaderModule fragShaderModule;
+  HtSortId<HtPipeline> sortId;
 };
 } // namespace ht
\ No newline at end of file
@@ -0,0 +1,149 @@
+#include "ht_query_profiler.hpp"
+
+// std
+#include <stdexcept>
+
+namespace ht {
+
+static constexpr VkQueryPipelineStatisticFlags STATISTICS =
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+    VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+// one value per statistic bit, in bit order, then the availability word
+static constexpr uint32_t STATISTICS_VALUES = 6 + 1;
+static constexpr uint32_t OCCLUSION_VALUES = 1 + 1;
+
+HtQueryProfiler::HtQueryProfiler(HtDevice &device, uint32_t frameCount)
+    : htDevice{device}, slots(frameCount),
+      statistics{device.pipelineStatisticsEnabled()} {
+  if (htDevice.preciseOcclusionEnabled()) {
+    occlusionFlags = VK_QUERY_CONTROL_PRECISE_BIT;
+  }
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryCount = MAX_SCOPES;
+  for (Slot &slot : slots) {
+    poolInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+    poolInfo.pipelineStatistics = 0;
+    if (vkCreateQueryPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                          &slot.occlusionPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create occlusion query pool!");
+    }
+    if (!statistics) {
+      continue;
+    }
+    poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    poolInfo.pipelineStatistics = STATISTICS;
+    if (vkCreateQueryPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                          &slot.statisticsPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create statistics query pool!");
+    }
+  }
+  statisticsData.resize(MAX_SCOPES * STATISTICS_VALUES);
+  occlusionData.resize(MAX_SCOPES * OCCLUSION_VALUES);
+}
+
+HtQueryProfiler::~HtQueryProfiler() {
+  // frames in flight may still write their queries
+  for (Slot &slot : slots) {
+    VkDevice device = htDevice.device();
+    const VkAllocationCallbacks *allocator = htDevice.allocator();
+    VkQueryPool statisticsPool = slot.statisticsPool;
+    VkQueryPool occlusionPool = slot.occlusionPool;
+    htDevice.deletionQueue().push(
+        [device, allocator, statisticsPool, occlusionPool]() {
+          vkDestroyQueryPool(device, statisticsPool, allocator);
+          vkDestroyQueryPool(device, occlusionPool, allocator);
+        });
+  }
+}
+
+void HtQueryProfiler::beginFrame(VkCommandBuffer commandBuffer,
+                                 uint32_t frameIndex, uint64_t frameNumber) {
+  currentFrame = frameIndex;
+  Slot &slot = slots[frameIndex];
+  collect(slot);
+
+  slot.names.clear();
+  slot.frameNumber = frameNumber;
+  vkCmdResetQueryPool(commandBuffer, slot.occlusionPool, 0, MAX_SCOPES);
+  if (statistics) {
+    vkCmdResetQueryPool(commandBuffer, slot.statisticsPool, 0, MAX_SCOPES);
+  }
+}
+
+uint32_t HtQueryProfiler::beginScope(VkCommandBuffer commandBuffer,
+                                     const std::string &name) {
+  Slot &slot = slots[currentFrame];
+  if (slot.names.size() >= MAX_SCOPES) {
+    return NO_SCOPE;
+  }
+  uint32_t scope = static_cast<uint32_t>(slot.names.size());
+  slot.names.push_back(name);
+  vkCmdBeginQuery(commandBuffer, slot.occlusionPool, scope, occlusionFlags);
+  if (statistics) {
+    vkCmdBeginQuery(commandBuffer, slot.statisticsPool, scope, 0);
+  }
+  return scope;
+}
+
+void HtQueryProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (scope == NO_SCOPE) {
+    return;
+  }
+  Slot &slot = slots[currentFrame];
+  if (statistics) {
+    vkCmdEndQuery(commandBuffer, slot.statisticsPool, scope);
+  }
+  vkCmdEndQuery(commandBuffer, slot.occlusionPool, scope);
+}
+
+// no WAIT_BIT: the fence has normally retired the frame already, and a frame
+// whose queries are not all available yet is dropped rather than waited on
+void HtQueryProfiler::collect(Slot &slot) {
+  uint32_t count = static_cast<uint32_t>(slot.names.size());
+  if (count == 0) {
+    return;
+  }
+  const VkQueryResultFlags flags =
+      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+  if (vkGetQueryPoolResults(htDevice.device(), slot.occlusionPool, 0, count,
+                            count * OCCLUSION_VALUES * sizeof(uint64_t),
+                            occlusionData.data(),
+                            OCCLUSION_VALUES * sizeof(uint64_t),
+                            flags) != VK_SUCCESS) {
+    return;
+  }
+  if (statistics &&
+      vkGetQueryPoolResults(htDevice.device(), slot.statisticsPool, 0, count,
+                            count * STATISTICS_VALUES * sizeof(uint64_t),
+                            statisticsData.data(),
+                            STATISTICS_VALUES * sizeof(uint64_t),
+                            flags) != VK_SUCCESS) {
+    return;
+  }
+
+  lastResults.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    Result &result = lastResults[i];
+    result = Result{};
+    result.name = slot.names[i];
+    result.samplesPassed = occlusionData[i * OCCLUSION_VALUES];
+    if (statistics) {
+      const uint64_t *values = &statisticsData[i * STATISTICS_VALUES];
+      result.inputVertices = values[0];
+      result.inputPrimitives = values[1];
+      result.vertexInvocations = values[2];
+      result.clippingInvocations = values[3];
+      result.clippingPrimitives = values[4];
+      result.fragmentInvocations = values[5];
+    }
+  }
+  lastResultsFrame = slot.frameNumber;
+}
+
+} // namespace ht
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ht {
+
+// Pipeline statistics and occlusion queries around named draw ranges. Each
+// frame in flight has its own query pools; beginFrame() reads back what the
+// slot's previous frame recorded, which the frame fence has already waited
+// for, so the host never stalls on a query.
+class HtQueryProfiler {
+public:
+  static constexpr uint32_t MAX_SCOPES = 256;
+  static constexpr uint32_t NO_SCOPE = ~0u;
+
+  struct Result {
+    std::string name;
+    // input assembly vertices and primitives, vertex shader invocations,
+    // primitives entering and leaving clipping, fragment shader invocations;
+    // all zero without statistics support
+    uint64_t inputVertices = 0;
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0;
+    uint64_t clippingPrimitives = 0;
+    uint64_t fragmentInvocations = 0;
+    uint64_t samplesPassed = 0;
+
+    // fraction of input vertices served from the post transform cache
+    double vertexReuse() const {
+      return inputVertices == 0
+                 ? 0.0
+                 : 1.0 - static_cast<double>(vertexInvocations) /
+                             static_cast<double>(inputVertices);
+    }
+    // primitives dropped by clipping and culling
+    uint64_t clippedPrimitives() const {
+      return clippingInvocations > clippingPrimitives
+                 ? clippingInvocations - clippingPrimitives
+                 : 0;
+    }
+  };
+
+  HtQueryProfiler(HtDevice &device, uint32_t frameCount);
+  ~HtQueryProfiler();
+
+  HtQueryProfiler(const HtQueryProfiler &) = delete;
+  HtQueryProfiler &operator=(const HtQueryProfiler &) = delete;
+
+  // collects the slot's last results and resets its pools. Records into
+  // commandBuffer, so it has to come before the render pass begins
+  void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex,
+                  uint64_t frameNumber);
+  // scopes cannot nest and have to end in the subpass they began in.
+  // Returns NO_SCOPE once the frame is out of queries
+  uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string &name);
+  void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  // scopes of the most recent frame whose queries were all available
+  const std::vector<Result> &results() const { return lastResults; }
+  uint64_t resultsFrame() const { return lastResultsFrame; }
+  bool statisticsEnabled() const { return statistics; }
+
+private:
+  struct Slot {
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    VkQueryPool occlusionPool = VK_NULL_HANDLE;
+    std::vector<std::string> names;
+    uint64_t frameNumber = 0;
+  };
+
+  void collect(Slot &slot);
+
+  HtDevice &htDevice;
+  std::vector<Slot> slots;
+  uint32_t currentFrame = 0;
+  bool statistics;
+  VkQueryControlFlags occlusionFlags = 0;
+
+  std::vector<Result> lastResults;
+  uint64_t lastResultsFrame = 0;
+  // readback scratch, kept between frames
+  std::vector<uint64_t> statisticsData;
+  std::vector<uint64_t> occlusionData;
+};
+
+} // namespace ht
@@ -0,0 +1,239 @@
+#include "ht_readback_ring.hpp"
+
+// std
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace ht {
+
+HtReadbackRing::HtReadbackRing(HtDevice &device, uint32_t frameCount)
+    : htDevice{device}, slots(frameCount) {
+  // cached memory makes the host reads fast, coherent saves the invalidate
+  const VkMemoryPropertyFlags preferred[] = {
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+          VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+  memoryProperties = preferred[2];
+  for (VkMemoryPropertyFlags properties : preferred) {
+    if (htDevice.hasMemoryType(~0u, properties)) {
+      memoryProperties = properties;
+      break;
+    }
+  }
+  coherent = (memoryProperties & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+HtReadbackRing::~HtReadbackRing() {
+  // frames in flight may still copy into the buffers
+  for (Slot &slot : slots) {
+    VkDevice device = htDevice.device();
+    const VkAllocationCallbacks *allocator = htDevice.allocator();
+    VkBuffer buffer = slot.buffer;
+    VkDeviceMemory memory = slot.memory;
+    htDevice.deletionQueue().push([device, allocator, buffer, memory]() {
+      vkDestroyBuffer(device, buffer, allocator);
+      vkFreeMemory(device, memory, allocator);
+    });
+  }
+}
+
+void HtReadbackRing::request(Callback callback, uint32_t frameCount) {
+  requestedCallback = std::move(callback);
+  requestedFrames = frameCount;
+}
+
+void HtReadbackRing::beginFrame(uint32_t frameIndex) {
+  currentFrame = frameIndex;
+  Slot &slot = slots[frameIndex];
+  if (!slot.callback) {
+    return;
+  }
+  if (!coherent) {
+    VkMappedMemoryRange range{};
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = slot.memory;
+    range.offset = 0;
+    range.size = VK_WHOLE_SIZE;
+    vkInvalidateMappedMemoryRanges(htDevice.device(), 1, &range);
+  }
+  slot.image.pixels = slot.mapped;
+  Callback callback = std::move(slot.callback);
+  slot.callback = nullptr;
+  callback(slot.image);
+}
+
+void HtReadbackRing::recordCopy(VkCommandBuffer commandBuffer, VkImage image,
+                                VkFormat format, VkExtent2D extent,
+                                uint64_t frameNumber) {
+  if (requestedFrames == 0) {
+    return;
+  }
+  uint32_t bytesPerPixel = texelSize(format);
+  if (bytesPerPixel == 0) {
+    std::cout << "readback: cannot copy format " << format << std::endl;
+    requestedCallback = nullptr;
+    requestedFrames = 0;
+    return;
+  }
+  Slot &slot = slots[currentFrame];
+  resizeSlot(slot, static_cast<VkDeviceSize>(extent.width) * extent.height *
+                       bytesPerPixel);
+
+  // HtSwapChain ends rendering with a transition to PRESENT_SRC whose
+  // second scope is COLOR_ATTACHMENT_OUTPUT, so this chains after it
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  VkBufferImageCopy region{};
+  region.bufferOffset = 0;
+  region.bufferRowLength = 0;
+  region.bufferImageHeight = 0;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {0, 0, 0};
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, image,
+                         VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer, 1,
+                         &region);
+
+  // the fence wait alone does not make the copy visible to host reads
+  VkBufferMemoryBarrier bufferBarrier{};
+  bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  bufferBarrier.buffer = slot.buffer;
+  bufferBarrier.offset = 0;
+  bufferBarrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1,
+                       &bufferBarrier, 0, nullptr);
+
+  // back for presentation, the semaphore wait orders the present after it
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0,
+                       nullptr, 1, &barrier);
+
+  slot.callback = requestedCallback;
+  slot.image = Image{frameNumber, extent, format, bytesPerPixel, nullptr};
+  if (--requestedFrames == 0) {
+    requestedCallback = nullptr;
+  }
+}
+
+// only grows; the slot's previous copy is known to be finished here
+void HtReadbackRing::resizeSlot(Slot &slot, VkDeviceSize size) {
+  if (slot.size >= size) {
+    return;
+  }
+  destroySlot(slot);
+  htDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                        memoryProperties, slot.buffer, slot.memory);
+  void *data;
+  vkMapMemory(htDevice.device(), slot.memory, 0, size, 0, &data);
+  slot.mapped = static_cast<uint8_t *>(data);
+  slot.size = size;
+}
+
+void HtReadbackRing::destroySlot(Slot &slot) {
+  vkDestroyBuffer(htDevice.device(), slot.buffer, htDevice.allocator());
+  vkFreeMemory(htDevice.device(), slot.memory, htDevice.allocator());
+  slot = Slot{};
+}
+
+uint32_t HtReadbackRing::texelSize(VkFormat format) {
+  switch (format) {
+  case VK_FORMAT_R5G6B5_UNORM_PACK16:
+  case VK_FORMAT_B5G6R5_UNORM_PACK16:
+  case VK_FORMAT_A1R5G5B5_UNORM_PACK16:
+    return 2;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_B8G8R8A8_SNORM:
+  case VK_FORMAT_B8G8R8A8_SRGB:
+  case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+  case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+  case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+  case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+  case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+  case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
+    return 4;
+  case VK_FORMAT_R16G16B16A16_UNORM:
+  case VK_FORMAT_R16G16B16A16_SFLOAT:
+    return 8;
+  case VK_FORMAT_R32G32B32A32_SFLOAT:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+bool HtReadbackRing::writePpm(const Image &image,
+                              const std::string &filePath) {
+  bool bgra;
+  switch (image.format) {
+  case VK_FORMAT_B8G8R8A8_UNORM:
+  case VK_FORMAT_B8G8R8A8_SRGB:
+    bgra = true;
+    break;
+  case VK_FORMAT_R8G8B8A8_UNORM:
+  case VK_FORMAT_R8G8B8A8_SRGB:
+    bgra = false;
+    break;
+  default:
+    std::cout << "readback: cannot write format " << image.format << " as ppm"
+              << std::endl;
+    return false;
+  }
+
+  std::ofstream file{filePath, std::ios::binary};
+  if (!file.is_open()) {
+    std::cout << "readback: failed to open " << filePath << std::endl;
+    return false;
+  }
+  file << "P6\n" << image.extent.width << ' ' << image.extent.height
+       << "\n255\n";
+  std::vector<char> row(image.extent.width * 3);
+  const uint8_t *pixel = image.pixels;
+  for (uint32_t y = 0; y < image.extent.height; y++) {
+    for (uint32_t x = 0; x < image.extent.width; x++, pixel += 4) {
+      row[x * 3 + 0] = static_cast<char>(pixel[bgra ? 2 : 0]);
+      row[x * 3 + 1] = static_cast<char>(pixel[1]);
+      row[x * 3 + 2] = static_cast<char>(pixel[bgra ? 0 : 2]);
+    }
+    file.write(row.data(), row.size());
+  }
+  return static_cast<bool>(file);
+}
+
+} // namespace ht
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace ht {
+
+// Copies rendered images into host cached buffers, one per frame in flight,
+// and hands the pixels to a callback once the frame's slot comes around
+// again. The fence wait in HtSwapChain::acquireNextImage already guarantees
+// the copy has finished by then, so a readback never waits on the GPU.
+//
+// Pixels arrive MAX_FRAMES_IN_FLIGHT frames late, on the render thread, and
+// are only valid during the callback.
+class HtReadbackRing {
+public:
+  struct Image {
+    uint64_t frameNumber;
+    VkExtent2D extent;
+    VkFormat format;
+    uint32_t bytesPerPixel;
+    const uint8_t *pixels; // tightly packed rows
+  };
+  using Callback = std::function<void(const Image &image)>;
+
+  HtReadbackRing(HtDevice &device, uint32_t frameCount);
+  ~HtReadbackRing();
+
+  HtReadbackRing(const HtReadbackRing &) = delete;
+  HtReadbackRing &operator=(const HtReadbackRing &) = delete;
+
+  // reads back the next frameCount frames that recordCopy() sees
+  void request(Callback callback, uint32_t frameCount = 1);
+  bool pending() const { return requestedFrames > 0; }
+
+  // delivers the readback previously recorded for frameIndex, must only be
+  // called once the GPU is done with it (after HtSwapChain::acquireNextImage)
+  void beginFrame(uint32_t frameIndex);
+  // after rendering: copies image, which must be in PRESENT_SRC_KHR layout
+  // and have been created with TRANSFER_SRC usage, if a readback is pending.
+  // Formats texelSize() does not know drop the pending readback
+  void recordCopy(VkCommandBuffer commandBuffer, VkImage image,
+                  VkFormat format, VkExtent2D extent, uint64_t frameNumber);
+
+  // binary PPM for 8-bit RGBA / BGRA formats, returns false for others
+  static bool writePpm(const Image &image, const std::string &filePath);
+  // bytes per pixel of the uncompressed color formats a swap chain can use,
+  // 0 for any other format
+  static uint32_t texelSize(VkFormat format);
+
+private:
+  struct Slot {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint8_t *mapped = nullptr;
+    // set while a copy is in flight
+    Callback callback;
+    Image image{};
+  };
+
+  void resizeSlot(Slot &slot, VkDeviceSize size);
+  void destroySlot(Slot &slot);
+
+  HtDevice &htDevice;
+  std::vector<Slot> slots;
+  uint32_t currentFrame = 0;
+  VkMemoryPropertyFlags memoryProperties;
+  bool coherent;
+
+  Callback requestedCallback;
+  uint32_t requestedFrames = 0;
+};
+
+} // namespace ht
@@ -0,0 +1,521 @@
+#include "ht_replayer.hpp"
+
+#include "ht_env.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+namespace ht {
+
+// checks every id once so replayCommands() can index without bounds checks
+static void validateTrace(const HtTrace &trace) {
+  for (const HtTrace::Frame &frame : trace.frames) {
+    bool pipelineBound = false;
+    bool modelBound = false;
+    for (const HtTrace::Command &command : frame.commands) {
+      switch (command.op) {
+      case HtTrace::Op::BindPipeline:
+        if (command.value >= trace.pipelines.size()) {
+          throw std::runtime_error("failed to replay trace: bad pipeline id!");
+        }
+        pipelineBound = true;
+        break;
+      case HtTrace::Op::BindModel:
+        if (command.value >= trace.models.size() ||
+            trace.models[command.value].vertices.size() < 3) {
+          throw std::runtime_error("failed to replay trace: bad model id!");
+        }
+        modelBound = true;
+        break;
+      case HtTrace::Op::PushConstants:
+        break;
+      case HtTrace::Op::Draw:
+        if (!pipelineBound || !modelBound) {
+          throw std::runtime_error("failed to replay trace: unbound draw!");
+        }
+        break;
+      }
+    }
+  }
+}
+
+HtReplayer::HtReplayer(HtWindow &window, HtDevice &device,
+                       const HtTrace &trace, bool offscreen)
+    : htWindow{window}, htDevice{device}, trace{trace}, offscreen{offscreen} {
+  validateTrace(trace);
+  createModels();
+  createPipelineLayout();
+  createCommandBuffers();
+  if (offscreen) {
+    createOffscreenTarget();
+    createPipelines();
+  } else {
+    recreateSwapChain();
+  }
+}
+
+HtReplayer::~HtReplayer() {
+  vkDeviceWaitIdle(htDevice.device());
+  pipelines.clear();
+  models.clear();
+  htSwapChain.reset();
+  destroyOffscreenTarget();
+  vkDestroyPipelineLayout(htDevice.device(), pipelineLayout,
+                          htDevice.allocator());
+}
+
+void HtReplayer::createModels() {
+  for (const HtTrace::Model &model : trace.models) {
+    if (model.indices.empty()) {
+      models.push_back(std::make_unique<HtModel>(htDevice, model.vertices));
+    } else {
+      models.push_back(std::make_unique<HtModel>(htDevice, model.vertices,
+                                                 model.indices));
+    }
+  }
+}
+
+// one range covering every push constant update in the trace
+void HtReplayer::createPipelineLayout() {
+  VkPushConstantRange pushConstantRange{};
+  for (const HtTrace::Frame &frame : trace.frames) {
+    for (const HtTrace::Command &command : frame.commands) {
+      if (command.op == HtTrace::Op::PushConstants) {
+        pushConstantRange.stageFlags |= command.pushStages;
+        pushConstantRange.size = std::max(
+            pushConstantRange.size, command.pushOffset + command.pushSize);
+      }
+    }
+  }
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 0;
+  pipelineLayoutInfo.pSetLayouts = nullptr;
+  pipelineLayoutInfo.pushConstantRangeCount =
+      pushConstantRange.size > 0 ? 1 : 0;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(htDevice.device(), &pipelineLayoutInfo,
+                             htDevice.allocator(),
+                             &pipelineLayout) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+void HtReplayer::createPipelines() {
+  PipelineConfigInfo pipelineConfig{};
+  HtPipeline::defaultPipelineConfigInfo(pipelineConfig);
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  if (offscreen) {
+    pipelineConfig.renderPass = offscreenRenderPass;
+  } else {
+    pipelineConfig.renderPass = htSwapChain->getRenderPass();
+    pipelineConfig.colorAttachmentFormat =
+        htSwapChain->getSwapChainImageFormat();
+    pipelineConfig.depthAttachmentFormat = htSwapChain->getDepthFormat();
+  }
+
+  pipelines.clear();
+  for (const HtTrace::Pipeline &pipeline : trace.pipelines) {
+    pipelines.push_back(std::make_unique<HtPipeline>(
+        htDevice, pipeline.vertFilePath, pipeline.fragFilePath,
+        pipelineConfig));
+  }
+}
+
+void HtReplayer::createCommandBuffers() {
+  commandBuffers.resize(HtSwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = htDevice.getCommandPool();
+  allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+
+  if (vkAllocateCommandBuffers(htDevice.device(), &allocInfo,
+                               commandBuffers.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate command buffers!");
+  }
+}
+
+void HtReplayer::createOffscreenTarget() {
+  // every frame is drawn at the first frame's extent
+  offscreenExtent = trace.frames[0].extent;
+  offscreenDepthFormat = htDevice.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT,
+       VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+  createOffscreenImage(OFFSCREEN_COLOR_FORMAT,
+                       VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+                       VK_IMAGE_ASPECT_COLOR_BIT, colorImage, colorImageMemory,
+                       colorImageView);
+  createOffscreenImage(offscreenDepthFormat,
+                       VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                       VK_IMAGE_ASPECT_DEPTH_BIT, depthImage, depthImageMemory,
+                       depthImageView);
+  createOffscreenRenderPass();
+
+  std::array<VkImageView, 2> attachments = {colorImageView, depthImageView};
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = offscreenRenderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  framebufferInfo.pAttachments = attachments.data();
+  framebufferInfo.width = offscreenExtent.width;
+  framebufferInfo.height = offscreenExtent.height;
+  framebufferInfo.layers = 1;
+  if (vkCreateFramebuffer(htDevice.device(), &framebufferInfo,
+                          htDevice.allocator(),
+                          &offscreenFramebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create framebuffer!");
+  }
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  inFlightFences.resize(HtSwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (VkFence &fence : inFlightFences) {
+    if (vkCreateFence(htDevice.device(), &fenceInfo, htDevice.allocator(),
+                      &fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create synchronization objects!");
+    }
+  }
+}
+
+void HtReplayer::createOffscreenImage(VkFormat format, VkImageUsageFlags usage,
+                                      VkImageAspectFlags aspect,
+                                      VkImage &image, VkDeviceMemory &memory,
+                                      VkImageView &view) {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = offscreenExtent.width;
+  imageInfo.extent.height = offscreenExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = format;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = usage;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  htDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                               image, memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = format;
+  viewInfo.subresourceRange.aspectMask = aspect;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(htDevice.device(), &viewInfo, htDevice.allocator(),
+                        &view) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
+  }
+}
+
+// same attachments as the swap chain's render pass, except that color ends
+// up ready for the next frame instead of presentation
+void HtReplayer::createOffscreenRenderPass() {
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = OFFSCREEN_COLOR_FORMAT;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = offscreenDepthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef{};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // both images are shared by the frames in flight, so the previous frame's
+  // writes must finish before this frame clears them
+  VkSubpassDependency dependency{};
+  dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependency.dstSubpass = 0;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                             VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment,
+                                                        depthAttachment};
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = 1;
+  renderPassInfo.pDependencies = &dependency;
+  if (vkCreateRenderPass(htDevice.device(), &renderPassInfo,
+                         htDevice.allocator(),
+                         &offscreenRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render pass!");
+  }
+}
+
+void HtReplayer::destroyOffscreenTarget() {
+  VkDevice device = htDevice.device();
+  const VkAllocationCallbacks *allocator = htDevice.allocator();
+  for (VkFence fence : inFlightFences) {
+    vkDestroyFence(device, fence, allocator);
+  }
+  inFlightFences.clear();
+  vkDestroyFramebuffer(device, offscreenFramebuffer, allocator);
+  vkDestroyRenderPass(device, offscreenRenderPass, allocator);
+  vkDestroyImageView(device, colorImageView, allocator);
+  vkDestroyImage(device, colorImage, allocator);
+  vkFreeMemory(device, colorImageMemory, allocator);
+  vkDestroyImageView(device, depthImageView, allocator);
+  vkDestroyImage(device, depthImage, allocator);
+  vkFreeMemory(device, depthImageMemory, allocator);
+}
+
+void HtReplayer::recreateSwapChain() {
+  auto extent = htWindow.getExtent();
+  while (extent.width == 0 || extent.height == 0) {
+    htWindow.waitEvents();
+    extent = htWindow.getExtent();
+  }
+
+  bool formatsChanged = true;
+  if (htSwapChain == nullptr) {
+    htSwapChain = std::make_unique<HtSwapChain>(htDevice, extent);
+  } else {
+    std::shared_ptr<HtSwapChain> oldSwapChain = std::move(htSwapChain);
+    htSwapChain = std::make_unique<HtSwapChain>(htDevice, extent, oldSwapChain);
+    formatsChanged = !oldSwapChain->compareSwapFormats(*htSwapChain);
+    htDevice.deletionQueue().push(
+        [oldSwapChain]() mutable { oldSwapChain.reset(); });
+  }
+  if (pipelines.empty() || !htSwapChain->usesDynamicRendering() ||
+      formatsChanged) {
+    createPipelines();
+  }
+}
+
+void HtReplayer::run(uint32_t frameCount) {
+  std::ofstream csv;
+  std::string csvPath = envString("HT_REPLAY_CSV");
+  if (!csvPath.empty()) {
+    csv.open(csvPath);
+    if (!csv.is_open()) {
+      throw std::runtime_error("failed to open replay csv: " + csvPath);
+    }
+    csv << "frame,trace_frame,ms" << std::endl;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> frameTimes;
+  frameTimes.reserve(frameCount);
+  Clock::time_point start = Clock::now();
+  Clock::time_point last = start;
+  while (frameTimes.size() < frameCount && !htWindow.shouldClose()) {
+    // nothing reacts to input, but the queue has to be drained
+    HtWindowEvent event;
+    htWindow.pollEvents();
+    while (htWindow.pollEvent(event)) {
+      if (event.type == HtWindowEvent::Type::Resize) {
+        framebufferResized = true;
+      }
+    }
+
+    uint32_t frameIndex =
+        static_cast<uint32_t>(frameTimes.size() % trace.frames.size());
+    const HtTrace::Frame &frame = trace.frames[frameIndex];
+    if (offscreen) {
+      drawOffscreenFrame(frame);
+    } else if (!drawFrame(frame)) {
+      last = Clock::now();
+      continue;
+    }
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - last).count();
+    last = now;
+    if (csv.is_open()) {
+      csv << frameTimes.size() << ',' << frameIndex << ',' << ms << '\n';
+    }
+    frameTimes.push_back(ms);
+  }
+  vkDeviceWaitIdle(htDevice.device());
+  double totalMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  if (frameTimes.empty()) {
+    return;
+  }
+  auto minmax = std::minmax_element(frameTimes.begin(), frameTimes.end());
+  std::cout << "replay: " << frameTimes.size() << " frames ("
+            << trace.frames.size() << " captured, "
+            << (offscreen ? "offscreen" : "presented") << ") in " << totalMs
+            << " ms, " << totalMs / frameTimes.size() << " ms/frame, min "
+            << *minmax.first << " ms, max " << *minmax.second << " ms"
+            << std::endl;
+}
+
+bool HtReplayer::drawFrame(const HtTrace::Frame &frame) {
+  uint32_t imageIndex;
+  auto result = htSwapChain->acquireNextImage(&imageIndex);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+    recreateSwapChain();
+    return false;
+  }
+  if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+    throw std::runtime_error("failed to acquire swap chain image!");
+  }
+
+  VkCommandBuffer commandBuffer =
+      commandBuffers[htSwapChain->getCurrentFrame()];
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
+  htSwapChain->beginRendering(commandBuffer, imageIndex, frame.clearColor);
+  replayCommands(commandBuffer, frame, htSwapChain->getSwapChainExtent());
+  htSwapChain->endRendering(commandBuffer, imageIndex);
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+
+  result = htSwapChain->submitCommandBuffers(&commandBuffer, &imageIndex);
+  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
+      framebufferResized) {
+    // the frame was still submitted
+    framebufferResized = false;
+    recreateSwapChain();
+  } else if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to present swapchain image!");
+  }
+  return true;
+}
+
+void HtReplayer::drawOffscreenFrame(const HtTrace::Frame &frame) {
+  VkFence fence = inFlightFences[currentFrame];
+  vkWaitForFences(htDevice.device(), 1, &fence, VK_TRUE,
+                  std::numeric_limits<uint64_t>::max());
+  vkResetFences(htDevice.device(), 1, &fence);
+
+  VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording command buffer!");
+  }
+
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color = frame.clearColor;
+  clearValues[1].depthStencil = {1.0f, 0};
+  VkRenderPassBeginInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  renderPassInfo.renderPass = offscreenRenderPass;
+  renderPassInfo.framebuffer = offscreenFramebuffer;
+  renderPassInfo.renderArea.offset = {0, 0};
+  renderPassInfo.renderArea.extent = offscreenExtent;
+  renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+  renderPassInfo.pClearValues = clearValues.data();
+  vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                       VK_SUBPASS_CONTENTS_INLINE);
+  replayCommands(commandBuffer, frame, offscreenExtent);
+  vkCmdEndRenderPass(commandBuffer);
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record command buffer!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &commandBuffer;
+  {
+    std::lock_guard<std::mutex> lock{
+        htDevice.queueMutex(htDevice.graphicsQueue())};
+    if (vkQueueSubmit(htDevice.graphicsQueue(), 1, &submitInfo, fence) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+  }
+  currentFrame = (currentFrame + 1) % HtSwapChain::MAX_FRAMES_IN_FLIGHT;
+}
+
+// draws into the target's extent with the same viewport the app sets up
+void HtReplayer::replayCommands(VkCommandBuffer commandBuffer,
+                                const HtTrace::Frame &frame,
+                                VkExtent2D extent) {
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 0.0f;
+  VkRect2D scissor{{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  HtModel *model = nullptr;
+  for (const HtTrace::Command &command : frame.commands) {
+    switch (command.op) {
+    case HtTrace::Op::BindPipeline:
+      pipelines[command.value]->bind(commandBuffer);
+      break;
+    case HtTrace::Op::BindModel:
+      model = models[command.value].get();
+      model->bind(commandBuffer);
+      break;
+    case HtTrace::Op::PushConstants:
+      vkCmdPushConstants(commandBuffer, pipelineLayout, command.pushStages,
+                         command.pushOffset, command.pushSize,
+                         frame.pushData.data() + command.pushData);
+      break;
+    case HtTrace::Op::Draw:
+      model->draw(commandBuffer, command.value);
+      break;
+    }
+  }
+}
+
+} // namespace ht
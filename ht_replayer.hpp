@@ -0,0 +1,87 @@
+#pragma once
+
+#include "ht_command_trace.hpp"
+#include "ht_device.hpp"
+#include "ht_model.hpp"
+#include "ht_pipeline.hpp"
+#include "ht_swap_chain.hpp"
+#include "ht_window.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ht {
+
+// Plays a captured HtTrace back against a device, without the app's scene,
+// simulation or event handling, to time the GPU side on its own.
+//
+// Presented replays go through a swap chain like the app. Offscreen replays
+// render into an image of the captured extent that is never presented, so
+// only the GPU and the submission path are measured.
+//
+// HT_REPLAY_CSV=<file> writes the time of every replayed frame, so runs on
+// different drivers or builds can be compared frame by frame.
+class HtReplayer {
+public:
+  HtReplayer(HtWindow &window, HtDevice &device, const HtTrace &trace,
+             bool offscreen);
+  ~HtReplayer();
+
+  HtReplayer(const HtReplayer &) = delete;
+  HtReplayer &operator=(const HtReplayer &) = delete;
+
+  // replays frameCount frames, looping over the trace, and prints timings
+  void run(uint32_t frameCount);
+
+private:
+  void createModels();
+  void createPipelineLayout();
+  void createPipelines();
+  void createCommandBuffers();
+  void createOffscreenTarget();
+  void createOffscreenImage(VkFormat format, VkImageUsageFlags usage,
+                            VkImageAspectFlags aspect, VkImage &image,
+                            VkDeviceMemory &memory, VkImageView &view);
+  void createOffscreenRenderPass();
+  void destroyOffscreenTarget();
+  void recreateSwapChain();
+
+  // returns false when the frame was skipped for a swap chain recreation
+  bool drawFrame(const HtTrace::Frame &frame);
+  void drawOffscreenFrame(const HtTrace::Frame &frame);
+  void replayCommands(VkCommandBuffer commandBuffer,
+                      const HtTrace::Frame &frame, VkExtent2D extent);
+
+  HtWindow &htWindow;
+  HtDevice &htDevice;
+  const HtTrace &trace;
+  bool offscreen;
+
+  std::vector<std::unique_ptr<HtModel>> models;
+  std::vector<std::unique_ptr<HtPipeline>> pipelines;
+  VkPipelineLayout pipelineLayout;
+  std::vector<VkCommandBuffer> commandBuffers;
+
+  std::unique_ptr<HtSwapChain> htSwapChain;
+  bool framebufferResized = false;
+
+  // offscreen target: one color and depth image shared by every frame in
+  // flight, ordered by the render pass dependency like the swap chain's depth
+  static constexpr VkFormat OFFSCREEN_COLOR_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
+  VkExtent2D offscreenExtent{};
+  VkFormat offscreenDepthFormat = VK_FORMAT_UNDEFINED;
+  VkImage colorImage = VK_NULL_HANDLE;
+  VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
+  VkImageView colorImageView = VK_NULL_HANDLE;
+  VkImage depthImage = VK_NULL_HANDLE;
+  VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
+  VkImageView depthImageView = VK_NULL_HANDLE;
+  VkRenderPass offscreenRenderPass = VK_NULL_HANDLE;
+  VkFramebuffer offscreenFramebuffer = VK_NULL_HANDLE;
+  std::vector<VkFence> inFlightFences;
+  uint32_t currentFrame = 0;
+};
+
+} // namespace ht
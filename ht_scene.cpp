@@ -0,0 +1,244 @@
+#include "ht_scene.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ht {
+
+HtScene::ModelHandle HtScene::addModel(HtModel &model) {
+  models.push_back(&model);
+  return static_cast<ModelHandle>(models.size() - 1);
+}
+
+void HtScene::reserve(uint32_t objectCount) {
+  offsets_.reserve(objectCount);
+  velocities_.reserve(objectCount);
+  colors_.reserve(objectCount);
+  modelHandles_.reserve(objectCount);
+  flags_.reserve(objectCount);
+  denseToSparse.reserve(objectCount);
+  sparseToDense.reserve(objectCount);
+  generations.reserve(objectCount);
+}
+
+HtScene::ObjectId HtScene::add(ModelHandle model, glm::vec2 offset,
+                               glm::vec3 color, glm::vec2 velocity,
+                               uint32_t flags) {
+  assert(model < models.size() && "invalid model handle");
+
+  ObjectId id{};
+  if (!freeIds.empty()) {
+    id.index = freeIds.back();
+    freeIds.pop_back();
+  } else {
+    id.index = static_cast<uint32_t>(sparseToDense.size());
+    sparseToDense.push_back(0);
+    generations.push_back(0);
+  }
+  id.generation = generations[id.index];
+  sparseToDense[id.index] = size();
+
+  offsets_.push_back(offset);
+  velocities_.push_back(velocity);
+  colors_.push_back(color);
+  modelHandles_.push_back(model);
+  flags_.push_back(flags);
+  denseToSparse.push_back(id.index);
+  return id;
+}
+
+void HtScene::remove(ObjectId id) {
+  uint32_t dense = denseIndex(id);
+  uint32_t last = size() - 1;
+
+  // move the last object into the hole so the arrays stay packed
+  if (dense != last) {
+    offsets_[dense] = offsets_[last];
+    velocities_[dense] = velocities_[last];
+    colors_[dense] = colors_[last];
+    modelHandles_[dense] = modelHandles_[last];
+    flags_[dense] = flags_[last];
+    denseToSparse[dense] = denseToSparse[last];
+    sparseToDense[denseToSparse[dense]] = dense;
+  }
+  offsets_.pop_back();
+  velocities_.pop_back();
+  colors_.pop_back();
+  modelHandles_.pop_back();
+  flags_.pop_back();
+  denseToSparse.pop_back();
+
+  // stale ids for this slot no longer match
+  generations[id.index]++;
+  freeIds.push_back(id.index);
+}
+
+bool HtScene::contains(ObjectId id) const {
+  return id.index < generations.size() &&
+         generations[id.index] == id.generation;
+}
+
+uint32_t HtScene::denseIndex(ObjectId id) const {
+  assert(contains(id) && "stale or invalid object id");
+  return sparseToDense[id.index];
+}
+
+void HtScene::setWrapBounds(glm::vec2 boundsMin, glm::vec2 boundsMax) {
+  wrap = true;
+  wrapMin = boundsMin;
+  wrapMax = boundsMax;
+}
+
+void HtScene::update(float dt) {
+  uint32_t count = size();
+  glm::vec2 *offsets = offsets_.data();
+  const glm::vec2 *velocities = velocities_.data();
+
+  // plain loops over the dense arrays so the compiler can vectorize them
+  for (uint32_t i = 0; i < count; i++) {
+    offsets[i] += velocities[i] * dt;
+  }
+
+  if (!wrap) {
+    return;
+  }
+  glm::vec2 extent = wrapMax - wrapMin;
+  for (uint32_t i = 0; i < count; i++) {
+    glm::vec2 &offset = offsets[i];
+    offset.x += offset.x > wrapMax.x ? -extent.x : 0.0f;
+    offset.x += offset.x < wrapMin.x ? extent.x : 0.0f;
+    offset.y += offset.y > wrapMax.y ? -extent.y : 0.0f;
+    offset.y += offset.y < wrapMin.y ? extent.y : 0.0f;
+  }
+}
+
+const std::vector<HtScene::InstanceBatch> &
+HtScene::writeInstances(ObjectData *dst, const glm::vec2 *offsets,
+                        HtThreadPool *pool) {
+  uint32_t count = size();
+  if (offsets == nullptr) {
+    offsets = offsets_.data();
+  }
+  uint32_t modelCount = static_cast<uint32_t>(models.size());
+  uint32_t chunkCount = (count + INSTANCE_CHUNK - 1) / INSTANCE_CHUNK;
+  modelRadius.resize(modelCount);
+  for (ModelHandle model = 0; model < modelCount; model++) {
+    modelRadius[model] = models[model]->getBoundingRadius();
+  }
+
+  // counting sort by model, per chunk so the chunks can run in parallel:
+  // count, prefix sum over (model, chunk), scatter
+  chunkCursors.assign(static_cast<size_t>(chunkCount) * modelCount, 0);
+  uint32_t *cursors = chunkCursors.data();
+  auto forEachChunk = [&](const HtThreadPool::RangeFunction &function) {
+    if (pool != nullptr) {
+      pool->parallelFor(chunkCount, 1, function);
+    } else {
+      function(0, chunkCount);
+    }
+  };
+  forEachChunk([&](uint32_t firstChunk, uint32_t endChunk) {
+    for (uint32_t chunk = firstChunk; chunk < endChunk; chunk++) {
+      uint32_t begin = chunk * INSTANCE_CHUNK;
+      countInstances(begin, std::min(count, begin + INSTANCE_CHUNK),
+                     cursors + chunk * modelCount);
+    }
+  });
+
+  batches.clear();
+  batchOfModel.assign(modelCount, 0);
+  uint32_t first = 0;
+  for (ModelHandle model = 0; model < modelCount; model++) {
+    uint32_t batchFirst = first;
+    for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+      uint32_t &cursor = cursors[chunk * modelCount + model];
+      uint32_t chunkInstances = cursor;
+      cursor = first;
+      first += chunkInstances;
+    }
+    if (first > batchFirst) {
+      batchOfModel[model] = static_cast<uint32_t>(batches.size());
+      batches.push_back({models[model], batchFirst, first - batchFirst});
+    }
+  }
+
+  forEachChunk([&](uint32_t firstChunk, uint32_t endChunk) {
+    for (uint32_t chunk = firstChunk; chunk < endChunk; chunk++) {
+      uint32_t begin = chunk * INSTANCE_CHUNK;
+      scatterInstances(begin, std::min(count, begin + INSTANCE_CHUNK),
+                       offsets, cursors + chunk * modelCount, dst);
+    }
+  });
+  return batches;
+}
+
+void HtScene::countInstances(uint32_t begin, uint32_t end,
+                             uint32_t *counts) const {
+  for (uint32_t i = begin; i < end; i++) {
+    counts[modelHandles_[i]] += (flags_[i] & OBJECT_HIDDEN) ? 0 : 1;
+  }
+}
+
+void HtScene::scatterInstances(uint32_t begin, uint32_t end,
+                               const glm::vec2 *offsets, uint32_t *cursors,
+                               ObjectData *dst) const {
+  for (uint32_t i = begin; i < end; i++) {
+    if (flags_[i] & OBJECT_HIDDEN) {
+      continue;
+    }
+    ModelHandle model = modelHandles_[i];
+    ObjectData *object = dst + cursors[model]++;
+#ifdef __SSE2__
+    // dst is usually mapped write-combined memory: two whole 16 byte
+    // streaming stores per record never read it back or pollute the cache
+    uint32_t drawBatch = batchOfModel[model];
+    float drawBatchBits;
+    memcpy(&drawBatchBits, &drawBatch, sizeof(float));
+    const glm::vec2 &offset = offsets[i];
+    const glm::vec3 &color = colors_[i];
+    auto *out = reinterpret_cast<float *>(object);
+    _mm_stream_ps(out, _mm_setr_ps(offset.x, offset.y, modelRadius[model],
+                                   drawBatchBits));
+    _mm_stream_ps(out + 4, _mm_setr_ps(color.x, color.y, color.z, 0.0f));
+#else
+    // build the record locally and store it whole
+    ObjectData record{};
+    record.offset = offsets[i];
+    record.boundingRadius = modelRadius[model];
+    record.drawBatch = batchOfModel[model];
+    record.color = colors_[i];
+    *object = record;
+#endif
+  }
+#ifdef __SSE2__
+  // streaming stores are weakly ordered, make them visible before submit
+  _mm_sfence();
+#endif
+}
+
+void HtScene::writeBounds(HtFrustumCuller &culler,
+                          const glm::vec2 *offsets) const {
+  uint32_t count = size();
+  if (offsets == nullptr) {
+    offsets = offsets_.data();
+  }
+  culler.reserve(culler.objectCount() + count);
+  for (uint32_t i = 0; i < count; i++) {
+    if (flags_[i] & OBJECT_HIDDEN) {
+      culler.add(glm::vec2{std::numeric_limits<float>::max()},
+                 glm::vec2{std::numeric_limits<float>::lowest()});
+      continue;
+    }
+    const HtModel &model = *models[modelHandles_[i]];
+    culler.add(model.getBoundsMin() + offsets[i],
+               model.getBoundsMax() + offsets[i]);
+  }
+}
+
+} // namespace ht
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "ht_frustum_culler.hpp"
+#include "ht_model.hpp"
+#include "ht_object_data.hpp"
+#include "ht_thread_pool.hpp"
+
+// std lib headers
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ht {
+
+// Object store with one contiguous array per component. Objects are addressed
+// by generational ids through a sparse table, so ids stay valid while the
+// dense arrays are compacted by swap-remove; add and remove are O(1) and
+// nothing is allocated per object once the arrays have grown.
+class HtScene {
+public:
+  using ModelHandle = uint32_t;
+
+  struct ObjectId {
+    uint32_t index = std::numeric_limits<uint32_t>::max();
+    uint32_t generation = 0;
+  };
+
+  enum ObjectFlags : uint32_t {
+    OBJECT_HIDDEN = 1u << 0,
+  };
+
+  // a run of instances in writeInstances() output sharing one model
+  struct InstanceBatch {
+    HtModel *model;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+  };
+
+  HtScene() = default;
+
+  HtScene(const HtScene &) = delete;
+  HtScene &operator=(const HtScene &) = delete;
+
+  ModelHandle addModel(HtModel &model);
+  HtModel &getModel(ModelHandle handle) { return *models[handle]; }
+
+  void reserve(uint32_t objectCount);
+  ObjectId add(ModelHandle model, glm::vec2 offset, glm::vec3 color,
+               glm::vec2 velocity = glm::vec2{0.0f}, uint32_t flags = 0);
+  void remove(ObjectId id);
+  bool contains(ObjectId id) const;
+
+  glm::vec2 &offset(ObjectId id) { return offsets_[denseIndex(id)]; }
+  glm::vec2 &velocity(ObjectId id) { return velocities_[denseIndex(id)]; }
+  glm::vec3 &color(ObjectId id) { return colors_[denseIndex(id)]; }
+  uint32_t &flags(ObjectId id) { return flags_[denseIndex(id)]; }
+
+  // positions wrap around inside these bounds in update(), off by default
+  void setWrapBounds(glm::vec2 boundsMin, glm::vec2 boundsMax);
+  // zero when wrapping is off
+  glm::vec2 getWrapExtent() const {
+    return wrap ? wrapMax - wrapMin : glm::vec2{0.0f};
+  }
+  void update(float dt);
+
+  // dense component arrays, valid for [0, size()); removing an object moves
+  // the last one into its place
+  uint32_t size() const { return static_cast<uint32_t>(offsets_.size()); }
+  const glm::vec2 *offsets() const { return offsets_.data(); }
+  const glm::vec3 *colors() const { return colors_.data(); }
+  const ModelHandle *modelHandles() const { return modelHandles_.data(); }
+  const uint32_t *flags() const { return flags_.data(); }
+
+  // streams every visible object into dst (room for size() entries, 16 byte
+  // aligned) grouped by model; the batches stay valid until the next call.
+  // offsets replaces the scene's own positions when given, e.g. interpolated
+  // ones. Large scenes are split across pool when given
+  const std::vector<InstanceBatch> &
+  writeInstances(ObjectData *dst, const glm::vec2 *offsets = nullptr,
+                 HtThreadPool *pool = nullptr);
+  // adds world space bounds for every object, culler index == dense index.
+  // Hidden objects get empty bounds so they are never reported visible
+  void writeBounds(HtFrustumCuller &culler,
+                   const glm::vec2 *offsets = nullptr) const;
+
+private:
+  uint32_t denseIndex(ObjectId id) const;
+
+  std::vector<HtModel *> models;
+
+  // dense, one entry per live object
+  std::vector<glm::vec2> offsets_;
+  std::vector<glm::vec2> velocities_;
+  std::vector<glm::vec3> colors_;
+  std::vector<ModelHandle> modelHandles_;
+  std::vector<uint32_t> flags_;
+  std::vector<uint32_t> denseToSparse;
+
+  // sparse, indexed by ObjectId::index
+  std::vector<uint32_t> sparseToDense;
+  std::vector<uint32_t> generations;
+  std::vector<uint32_t> freeIds;
+
+  bool wrap = false;
+  glm::vec2 wrapMin{0.0f};
+  glm::vec2 wrapMax{0.0f};
+
+  // objects per writeInstances chunk
+  static constexpr uint32_t INSTANCE_CHUNK = 16 * 1024;
+
+  void countInstances(uint32_t begin, uint32_t end, uint32_t *counts) const;
+  void scatterInstances(uint32_t begin, uint32_t end, const glm::vec2 *offsets,
+                        uint32_t *cursors, ObjectData *dst) const;
+
+  // scratch for writeInstances, reused every frame. chunkCursors holds one
+  // cursor per model for every chunk of objects
+  std::vector<uint32_t> chunkCursors;
+  std::vector<uint32_t> batchOfModel;
+  std::vector<float> modelRadius;
+  std::vector<InstanceBatch> batches;
+};
+
+} // namespace ht
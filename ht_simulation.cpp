@@ -0,0 +1,152 @@
+#include "ht_simulation.hpp"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace ht {
+
+HtSimulation::HtSimulation(HtScene &scene, double timestep)
+    : scene{scene},
+      timestep{std::chrono::duration_cast<Clock::duration>(
+          std::chrono::duration<double>(timestep))},
+      timestepSeconds{static_cast<float>(timestep)} {}
+
+HtSimulation::~HtSimulation() { stop(); }
+
+void HtSimulation::start() {
+  if (thread.joinable()) {
+    return;
+  }
+  // the reader starts from the current state so interpolate() never sees an
+  // empty snapshot
+  Snapshot &initial = snapshots[readIndex];
+  initial.current.assign(scene.offsets(), scene.offsets() + scene.size());
+  initial.previous = initial.current;
+  initial.time = Clock::now();
+
+  stopRequested = false;
+  thread = std::thread([this]() { run(); });
+}
+
+void HtSimulation::stop() {
+  if (!thread.joinable()) {
+    return;
+  }
+  stopRequested = true;
+  thread.join();
+}
+
+void HtSimulation::run() {
+  Clock::time_point simulationTime = Clock::now();
+  while (!stopRequested) {
+    Clock::time_point now = Clock::now();
+    if (now < simulationTime + timestep) {
+      std::this_thread::sleep_until(simulationTime + timestep);
+      continue;
+    }
+
+    uint32_t due = static_cast<uint32_t>((now - simulationTime) / timestep);
+    uint32_t count = std::min(due, MAX_CATCH_UP_STEPS);
+    for (uint32_t i = 0; i < count; i++) {
+      if (i == count - 1) {
+        Snapshot &snapshot = snapshots[writeIndex];
+        snapshot.previous.assign(scene.offsets(),
+                                 scene.offsets() + scene.size());
+      }
+      scene.update(timestepSeconds);
+      simulationTime += timestep;
+    }
+    // fell too far behind, e.g. after a debugger break: skip ahead instead
+    // of spiralling
+    if (count < due) {
+      simulationTime = now;
+    }
+    steps.fetch_add(count, std::memory_order_relaxed);
+    publish(simulationTime);
+  }
+}
+
+void HtSimulation::publish(Clock::time_point time) {
+  Snapshot &snapshot = snapshots[writeIndex];
+  snapshot.current.assign(scene.offsets(), scene.offsets() + scene.size());
+  snapshot.time = time;
+  writeIndex =
+      ready.exchange(writeIndex | FRESH_BIT, std::memory_order_acq_rel) &
+      INDEX_MASK;
+}
+
+// blends [begin, end), objects that wrapped around during the step jump
+// instead of sliding across the whole scene
+static void blendRange(const glm::vec2 *previous, const glm::vec2 *current,
+                       float alpha, glm::vec2 jump, uint32_t begin,
+                       uint32_t end, glm::vec2 *out) {
+  uint32_t i = begin;
+#ifdef __SSE2__
+  // two objects per register
+  const __m128 alpha4 = _mm_set1_ps(alpha);
+  const __m128 jump4 = _mm_setr_ps(jump.x, jump.y, jump.x, jump.y);
+  const __m128 wraps = _mm_cmpgt_ps(jump4, _mm_setzero_ps());
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  for (; i + 2 <= end; i += 2) {
+    __m128 p = _mm_loadu_ps(&previous[i].x);
+    __m128 c = _mm_loadu_ps(&current[i].x);
+    __m128 delta = _mm_sub_ps(c, p);
+    __m128 jumped =
+        _mm_and_ps(wraps, _mm_cmpgt_ps(_mm_and_ps(delta, absMask), jump4));
+    // a jump on either axis snaps both
+    jumped = _mm_or_ps(jumped,
+                       _mm_shuffle_ps(jumped, jumped, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128 blended = _mm_add_ps(p, _mm_mul_ps(delta, alpha4));
+    _mm_storeu_ps(&out[i].x, _mm_or_ps(_mm_and_ps(jumped, c),
+                                       _mm_andnot_ps(jumped, blended)));
+  }
+#endif
+  for (; i < end; i++) {
+    glm::vec2 delta = current[i] - previous[i];
+    if ((jump.x > 0.0f && std::abs(delta.x) > jump.x) ||
+        (jump.y > 0.0f && std::abs(delta.y) > jump.y)) {
+      out[i] = current[i];
+    } else {
+      out[i] = previous[i] + delta * alpha;
+    }
+  }
+}
+
+void HtSimulation::interpolate(std::vector<glm::vec2> &offsets,
+                               HtThreadPool *pool) {
+  if (ready.load(std::memory_order_acquire) & FRESH_BIT) {
+    readIndex = ready.exchange(readIndex, std::memory_order_acq_rel) &
+                INDEX_MASK;
+  }
+  const Snapshot &snapshot = snapshots[readIndex];
+
+  // rendering one step behind keeps alpha within [0, 1] until the next
+  // snapshot arrives
+  float alpha =
+      std::chrono::duration<float>(Clock::now() - snapshot.time).count() /
+      timestepSeconds;
+  alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+  glm::vec2 jump = scene.getWrapExtent() * 0.5f;
+
+  uint32_t count = static_cast<uint32_t>(snapshot.current.size());
+  offsets.resize(count);
+  const glm::vec2 *previous = snapshot.previous.data();
+  const glm::vec2 *current = snapshot.current.data();
+  glm::vec2 *out = offsets.data();
+  if (pool == nullptr) {
+    blendRange(previous, current, alpha, jump, 0, count, out);
+    return;
+  }
+  pool->parallelFor(count, INTERPOLATE_CHUNK,
+                    [=](uint32_t begin, uint32_t end) {
+                      blendRange(previous, current, alpha, jump, begin, end,
+                                 out);
+                    });
+}
+
+} // namespace ht
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ht_scene.hpp"
+#include "ht_thread_pool.hpp"
+
+// std lib headers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace ht {
+
+// Steps an HtScene at a fixed rate on its own thread, independent of the
+// frame rate. After each batch of steps the object positions are published
+// into one of three snapshots, so the render thread always finds a complete
+// one without waiting, and blends the last two steps of it.
+//
+// While running, the simulation thread owns the scene's offsets and reads
+// its velocities. The render thread may read every other component but must
+// not add or remove objects until stop() returns.
+class HtSimulation {
+public:
+  static constexpr double DEFAULT_TIMESTEP = 1.0 / 60.0;
+  // steps taken at most per wake-up, beyond that simulation time is dropped
+  static constexpr uint32_t MAX_CATCH_UP_STEPS = 8;
+
+  HtSimulation(HtScene &scene, double timestep = DEFAULT_TIMESTEP);
+  ~HtSimulation();
+
+  HtSimulation(const HtSimulation &) = delete;
+  HtSimulation &operator=(const HtSimulation &) = delete;
+
+  void start();
+  void stop();
+
+  // render thread: positions for the current time, interpolated one step
+  // behind the simulation. Resized to the scene's object count; large scenes
+  // are split across pool when given
+  void interpolate(std::vector<glm::vec2> &offsets,
+                   HtThreadPool *pool = nullptr);
+  uint64_t stepCount() const { return steps.load(std::memory_order_relaxed); }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Snapshot {
+    std::vector<glm::vec2> previous;
+    std::vector<glm::vec2> current;
+    Clock::time_point time; // when current is valid, previous is one step older
+  };
+
+  // objects per parallel chunk
+  static constexpr uint32_t INTERPOLATE_CHUNK = 16 * 1024;
+  static constexpr uint32_t FRESH_BIT = 4;
+  static constexpr uint32_t INDEX_MASK = 3;
+
+  void run();
+  void publish(Clock::time_point time);
+
+  HtScene &scene;
+  Clock::duration timestep;
+  float timestepSeconds;
+
+  // triple buffer: the writer and the reader each own one snapshot, the
+  // third one is handed over through ready
+  std::array<Snapshot, 3> snapshots;
+  std::atomic<uint32_t> ready{0};
+  uint32_t writeIndex = 1;
+  uint32_t readIndex = 2;
+
+  std::atomic<bool> stopRequested{false};
+  std::atomic<uint64_t> steps{0};
+  std::thread thread;
+};
+
+} // namespace ht
@@ -0,0 +1,53 @@
+#pragma once
+
+// std lib headers
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ht {
+
+// Small integer id held by an object for its whole lifetime, e.g. to build
+// sort keys. Ids are unique among the live objects of one Owner type and
+// handed out again once their object is destroyed, so they stay as small
+// as the number of live objects.
+template <typename Owner> class HtSortId {
+public:
+  HtSortId() : id{pool().acquire()} {}
+  ~HtSortId() { pool().release(id); }
+
+  HtSortId(const HtSortId &) = delete;
+  HtSortId &operator=(const HtSortId &) = delete;
+
+  uint32_t value() const { return id; }
+
+private:
+  struct Pool {
+    std::mutex mutex;
+    std::vector<uint32_t> freeIds;
+    uint32_t next = 0;
+
+    uint32_t acquire() {
+      std::lock_guard<std::mutex> lock{mutex};
+      if (freeIds.empty()) {
+        return next++;
+      }
+      uint32_t freeId = freeIds.back();
+      freeIds.pop_back();
+      return freeId;
+    }
+    void release(uint32_t freeId) {
+      std::lock_guard<std::mutex> lock{mutex};
+      freeIds.push_back(freeId);
+    }
+  };
+
+  static Pool &pool() {
+    static Pool instance;
+    return instance;
+  }
+
+  uint32_t id;
+};
+
+} // namespace ht
@@ -0,0 +1,53 @@
+#pragma once
+
+// std lib headers
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace ht {
+
+// Fixed size lock-free ring buffer for exactly one producer thread and one
+// consumer thread. Capacity must be a power of two; one slot stays empty to
+// tell a full queue from an empty one.
+template <typename T, size_t Capacity> class HtSpscQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+public:
+  HtSpscQueue() = default;
+
+  HtSpscQueue(const HtSpscQueue &) = delete;
+  HtSpscQueue &operator=(const HtSpscQueue &) = delete;
+
+  // producer side, returns false when the queue is full
+  bool tryPush(const T &value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t next = (head + 1) & (Capacity - 1);
+    if (next == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[head] = value;
+    head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side, returns false when the queue is empty
+  bool tryPop(T &value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == head_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    value = slots[tail];
+    tail_.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::array<T, Capacity> slots{};
+  // kept on separate cache lines so the two threads do not false share
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace ht
@@ -0,0 +1,138 @@
+#include "ht_submit_thread.hpp"
+
+// std lib headers
+#include <stdexcept>
+
+namespace ht {
+
+HtSubmitThread::HtSubmitThread(HtDevice &device) : htDevice{device} {
+  thread = std::thread([this]() { run(); });
+}
+
+HtSubmitThread::~HtSubmitThread() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopRequested = true;
+  }
+  frameQueued.notify_one();
+  thread.join();
+}
+
+uint64_t HtSubmitThread::push(const Submission &submission) {
+  std::unique_lock<std::mutex> lock{mutex};
+  rethrowError();
+  // the worker frees a slot before it reports the frame as done
+  while (!queue.tryPush(submission)) {
+    frameDone.wait(lock);
+    rethrowError();
+  }
+  pushed++;
+  frameQueued.notify_one();
+  return pushed;
+}
+
+void HtSubmitThread::waitFor(uint64_t ticket) {
+  std::unique_lock<std::mutex> lock{mutex};
+  frameDone.wait(lock,
+                 [this, ticket]() { return completed >= ticket || error; });
+  rethrowError();
+}
+
+void HtSubmitThread::flush() {
+  std::unique_lock<std::mutex> lock{mutex};
+  frameDone.wait(lock, [this]() { return completed == pushed || error; });
+  rethrowError();
+}
+
+uint64_t HtSubmitThread::pending() {
+  std::lock_guard<std::mutex> lock{mutex};
+  return pushed - completed;
+}
+
+void HtSubmitThread::rethrowError() {
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+void HtSubmitThread::run() {
+  Submission submission;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      frameQueued.wait(
+          lock, [this]() { return stopRequested || completed < pushed; });
+      if (completed == pushed) {
+        return;
+      }
+    }
+    queue.tryPop(submission);
+
+    VkResult result;
+    try {
+      result = execute(htDevice, submission);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock{mutex};
+      error = std::current_exception();
+      frameDone.notify_all();
+      return;
+    }
+    if (result != VK_SUCCESS) {
+      VkResult expected = VK_SUCCESS;
+      presentResult.compare_exchange_strong(expected, result,
+                                            std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock{mutex};
+    completed++;
+    frameDone.notify_all();
+  }
+}
+
+VkResult HtSubmitThread::execute(HtDevice &device,
+                                 const Submission &submission) {
+  VkSubmitInfo submitInfo = {};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+  VkPipelineStageFlags waitStages[] = {
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+  submitInfo.waitSemaphoreCount = 1;
+  submitInfo.pWaitSemaphores = &submission.imageAvailable;
+  submitInfo.pWaitDstStageMask = waitStages;
+
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &submission.commandBuffer;
+
+  submitInfo.signalSemaphoreCount = 1;
+  submitInfo.pSignalSemaphores = &submission.renderFinished;
+
+  {
+    std::lock_guard<std::mutex> lock{
+        device.queueMutex(device.graphicsQueue())};
+    if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
+                      submission.fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
+  }
+
+  VkPresentInfoKHR presentInfo = {};
+  presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+  presentInfo.waitSemaphoreCount = 1;
+  presentInfo.pWaitSemaphores = &submission.renderFinished;
+
+  presentInfo.swapchainCount = 1;
+  presentInfo.pSwapchains = &submission.swapChain;
+
+  presentInfo.pImageIndices = &submission.imageIndex;
+
+  std::unique_lock<std::mutex> swapChainLock;
+  if (submission.swapChainMutex) {
+    swapChainLock = std::unique_lock<std::mutex>{*submission.swapChainMutex};
+  }
+  // with a shared graphics and present queue, uploads wait for this
+  std::lock_guard<std::mutex> lock{device.queueMutex(device.presentQueue())};
+  return vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+}
+
+} // namespace ht
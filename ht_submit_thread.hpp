@@ -0,0 +1,97 @@
+#pragma once
+
+#include "ht_device.hpp"
+#include "ht_spsc_queue.hpp"
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace ht {
+
+// Submits finished frames and presents them on its own thread, so a present
+// that blocks in the driver or compositor does not hold up the thread that
+// records. Frames arrive through a lock-free queue and are handled strictly
+// in order; the mutex is only used to sleep and wake.
+//
+// HtSwapChain keeps its guarantees by doing everything ordering related on
+// the recording thread: the slot fence is reset before a frame is pushed, and
+// acquireNextImage waits for the ticket of the frame that last used the slot
+// before waiting on its fence. Queued frames still hold their images, so
+// acquiring only waits when the swap chain has no image left to hand out.
+class HtSubmitThread {
+public:
+  // everything one frame needs for its submit and present
+  struct Submission {
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailable = VK_NULL_HANDLE;
+    VkSemaphore renderFinished = VK_NULL_HANDLE;
+    // reset by the caller, signaled once the command buffer has executed
+    VkFence fence = VK_NULL_HANDLE;
+    VkSwapchainKHR swapChain = VK_NULL_HANDLE;
+    uint32_t imageIndex = 0;
+    // held around the present, as acquires on the same swap chain run on
+    // the recording thread
+    std::mutex *swapChainMutex = nullptr;
+  };
+
+  explicit HtSubmitThread(HtDevice &device);
+  // submits and presents whatever is still queued
+  ~HtSubmitThread();
+
+  HtSubmitThread(const HtSubmitThread &) = delete;
+  HtSubmitThread &operator=(const HtSubmitThread &) = delete;
+
+  // recording thread: hands a frame over, only waits while the queue is full.
+  // Returns the frame's ticket for waitFor() and rethrows the error of a
+  // failed earlier submit
+  uint64_t push(const Submission &submission);
+  // recording thread: returns once the frame with the given ticket and every
+  // frame before it have been submitted and presented
+  void waitFor(uint64_t ticket);
+  // recording thread: waitFor() the last pushed frame
+  void flush();
+  // frames pushed but not yet presented
+  uint64_t pending();
+  // first result other than VK_SUCCESS since the last call, so an out of
+  // date swap chain is noticed one frame late
+  VkResult takePresentResult() {
+    return presentResult.exchange(VK_SUCCESS, std::memory_order_relaxed);
+  }
+
+  // submit and present on the calling thread, also used when there is no
+  // submit thread. Throws when the submit fails
+  static VkResult execute(HtDevice &device, const Submission &submission);
+
+private:
+  // MAX_FRAMES_IN_FLIGHT frames at most are pending, as acquireNextImage
+  // waits for the ticket of the frame that last used its slot
+  static constexpr size_t QUEUE_CAPACITY = 4;
+
+  void run();
+  void rethrowError();
+
+  HtDevice &htDevice;
+  HtSpscQueue<Submission, QUEUE_CAPACITY> queue;
+  std::atomic<VkResult> presentResult{VK_SUCCESS};
+
+  // guard the counters below, never held while submitting or presenting
+  std::mutex mutex;
+  std::condition_variable frameQueued;
+  std::condition_variable frameDone;
+  uint64_t pushed = 0;
+  uint64_t completed = 0;
+  bool stopRequested = false;
+  std::exception_ptr error;
+
+  std::thread thread;
+};
+
+} // namespace ht
@@ -1,5 +1,7 @@
 #include "ht_swap_chain.hpp"
 
+#include "ht_env.hpp"
+
 // std
 #include <array>
 #include <cstdlib>
@@ -11,14 +13,22 @@
 
 namespace ht {
 
-HtSwapChain::HtSwapChain(HtDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+HtSwapChain::HtSwapChain(HtDevice &deviceRef, VkExtent2D extent,
+                         bool readable, HtSubmitThread *submitThread)
+    : device{deviceRef}, windowExtent{extent}, readable{readable},
+      submitThread{submitThread} {
   init();
 }
 
 HtSwapChain::HtSwapChain(HtDevice &deviceRef, VkExtent2D extent,
                          std::shared_ptr<HtSwapChain> previous)
-    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+    : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous},
+      readable{previous->readable}, submitThread{previous->submitThread} {
+  // the old swap chain is handed to the new one, so no present to it may
+  // still be running
+  if (submitThread) {
+    submitThread->flush();
+  }
   init();
 
   oldSwapChain = nullptr; // signal that the old swapchain destructor should be
@@ -27,47 +37,80 @@ HtSwapChain::HtSwapChain(HtDevice &deviceRef, VkExtent2D extent,
 void HtSwapChain::init() {
   createSwapChain();
   createImageViews();
-  createRenderPass();
+  depthFormat = findDepthFormat();
+  // dynamic rendering needs neither a render pass nor framebuffers, so a
+  // resize only recreates images and views
+  if (!device.dynamicRenderingEnabled()) {
+    createRenderPass();
+  }
   createDepthResources();
-  createFramebuffers();
+  if (!device.dynamicRenderingEnabled()) {
+    createFramebuffers();
+  }
   createSyncObjects();
 }
 
 HtSwapChain::~HtSwapChain() {
   for (auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device.device(), imageView, nullptr);
+    vkDestroyImageView(device.device(), imageView, device.allocator());
   }
   swapChainImageViews.clear();
 
   if (swapChain != nullptr) {
-    vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
+    vkDestroySwapchainKHR(device.device(), swapChain, device.allocator());
     swapChain = nullptr;
   }
 
-  for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
-  }
+  vkDestroyImageView(device.device(), depthImageView, device.allocator());
+  vkDestroyImage(device.device(), depthImage, device.allocator());
+  vkFreeMemory(device.device(), depthImageMemory, device.allocator());
 
   for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    vkDestroyFramebuffer(device.device(), framebuffer, device.allocator());
   }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+  vkDestroyRenderPass(device.device(), renderPass, device.allocator());
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
+  // cleanup synchronization objects, unless a newer swap chain took them over
+  for (size_t i = 0; i < inFlightFences.size(); i++) {
+    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i],
+                       device.allocator());
+    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i],
+                       device.allocator());
+    vkDestroyFence(device.device(), inFlightFences[i], device.allocator());
   }
 }
 
 VkResult HtSwapChain::acquireNextImage(uint32_t *imageIndex) {
+  // a failed submit never signals its fence, waiting for the slot's ticket
+  // rethrows the error instead. Later frames may still be queued, recording
+  // overlaps their present
+  if (submitThread) {
+    submitThread->waitFor(frameTickets[currentFrame]);
+  }
+
   vkWaitForFences(device.device(), 1, &inFlightFences[currentFrame], VK_TRUE,
                   std::numeric_limits<uint64_t>::max());
 
+  // the fence of this slot was last signaled by the frame submitted
+  // MAX_FRAMES_IN_FLIGHT frames ago, and every frame before it has been
+  // waited on the same way
+  HtDeletionQueue &deletionQueue = device.deletionQueue();
+  uint64_t recordingFrame = deletionQueue.submittedFrames() + 1;
+  if (recordingFrame > MAX_FRAMES_IN_FLIGHT) {
+    deletionQueue.collect(recordingFrame - MAX_FRAMES_IN_FLIGHT);
+  }
+
+  // queued frames still hold their images, only wait for the oldest of them
+  // when the swap chain might have none left to hand out
+  if (submitThread) {
+    uint64_t acquirable = imageCount() - minImageCount;
+    if (submitThread->pending() > acquirable) {
+      submitThread->waitFor(lastTicket - acquirable);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock{swapChainMutex};
   VkResult result = vkAcquireNextImageKHR(
       device.device(), swapChain, std::numeric_limits<uint64_t>::max(),
       imageAvailableSemaphores[currentFrame], // must be a not signaled
@@ -85,46 +128,156 @@ VkResult HtSwapChain::submitCommandBuffers(const VkCommandBuffer *buffers,
   }
   imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
-  VkSubmitInfo submitInfo = {};
-  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  // reset here rather than on the submit thread: once pushed, the frame must
+  // hold off acquireNextImage on this slot even before it is submitted
+  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
 
-  VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-  VkPipelineStageFlags waitStages[] = {
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  HtSubmitThread::Submission submission{};
+  submission.commandBuffer = *buffers;
+  submission.imageAvailable = imageAvailableSemaphores[currentFrame];
+  submission.renderFinished = renderFinishedSemaphores[currentFrame];
+  submission.fence = inFlightFences[currentFrame];
+  submission.swapChain = swapChain;
+  submission.imageIndex = *imageIndex;
+  submission.swapChainMutex = &swapChainMutex;
+
+  VkResult result;
+  if (submitThread) {
+    lastTicket = submitThread->push(submission);
+    frameTickets[currentFrame] = lastTicket;
+    result = submitThread->takePresentResult();
+  } else {
+    result = HtSubmitThread::execute(device, submission);
+  }
+  // counted when handed over, the reset fence covers the rest
+  device.deletionQueue().frameSubmitted();
 
-  submitInfo.commandBufferCount = 1;
-  submitInfo.pCommandBuffers = buffers;
+  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 
-  VkSemaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  return result;
+}
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo,
-                    inFlightFences[currentFrame]) != VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
+void HtSwapChain::beginRendering(VkCommandBuffer commandBuffer,
+                                 uint32_t imageIndex,
+                                 const VkClearColorValue &clearColor,
+                                 bool secondaryContents) {
+  VkClearDepthStencilValue clearDepth = {1.0f, 0};
+
+  if (!usesDynamicRendering()) {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = swapChainExtent;
+
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = clearColor;
+    clearValues[1].depthStencil = clearDepth;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo,
+                         secondaryContents
+                             ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                             : VK_SUBPASS_CONTENTS_INLINE);
+    return;
   }
 
-  VkPresentInfoKHR presentInfo = {};
-  presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-  presentInfo.waitSemaphoreCount = 1;
-  presentInfo.pWaitSemaphores = signalSemaphores;
+  // the layout transitions and the dependency on the previous frame's depth
+  // writes are what the render pass did implicitly
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[0].srcAccessMask = 0;
+  barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[0].image = swapChainImages[imageIndex];
+  barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+  bool hasStencil = depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT ||
+                    depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+  barriers[1].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barriers[1].image = depthImage;
+  barriers[1].subresourceRange = {
+      VK_IMAGE_ASPECT_DEPTH_BIT |
+          (hasStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0u),
+      0, 1, 0, 1};
+
+  VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  vkCmdPipelineBarrier(commandBuffer, stages, stages, 0, 0, nullptr, 0,
+                       nullptr, static_cast<uint32_t>(barriers.size()),
+                       barriers.data());
+
+  VkRenderingAttachmentInfoKHR colorAttachment{};
+  colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  colorAttachment.imageView = swapChainImageViews[imageIndex];
+  colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.clearValue.color = clearColor;
 
-  VkSwapchainKHR swapChains[] = {swapChain};
-  presentInfo.swapchainCount = 1;
-  presentInfo.pSwapchains = swapChains;
+  VkRenderingAttachmentInfoKHR depthAttachment{};
+  depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  depthAttachment.imageView = depthImageView;
+  depthAttachment.imageLayout =
+      VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.clearValue.depthStencil = clearDepth;
 
-  presentInfo.pImageIndices = imageIndex;
+  VkRenderingInfoKHR renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+  if (secondaryContents) {
+    renderingInfo.flags =
+        VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+  }
+  renderingInfo.renderArea = {{0, 0}, swapChainExtent};
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthAttachment;
 
-  auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+  device.cmdBeginRendering(commandBuffer, &renderingInfo);
+}
 
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+void HtSwapChain::endRendering(VkCommandBuffer commandBuffer,
+                               uint32_t imageIndex) {
+  if (!usesDynamicRendering()) {
+    vkCmdEndRenderPass(commandBuffer);
+    return;
+  }
 
-  return result;
+  device.cmdEndRendering(commandBuffer);
+
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = swapChainImages[imageIndex];
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  // not BOTTOM_OF_PIPE, so a readback barrier with source stage
+  // COLOR_ATTACHMENT_OUTPUT is ordered after this transition
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                       VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0,
+                       nullptr, 0, nullptr, 1, &barrier);
 }
 
 void HtSwapChain::createSwapChain() {
@@ -136,7 +289,10 @@ void HtSwapChain::createSwapChain() {
       chooseSwapPresentMode(swapChainSupport.presentModes);
   VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
-  uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+  // one image more with a submit thread, so the next acquire rarely waits
+  // for the present still queued on it
+  minImageCount = swapChainSupport.capabilities.minImageCount;
+  uint32_t imageCount = minImageCount + (submitThread ? 2 : 1);
   if (swapChainSupport.capabilities.maxImageCount > 0 &&
       imageCount > swapChainSupport.capabilities.maxImageCount) {
     imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -152,6 +308,15 @@ void HtSwapChain::createSwapChain() {
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  if (readable) {
+    if (swapChainSupport.capabilities.supportedUsageFlags &
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT) {
+      createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    } else {
+      std::cout << "swap chain: images cannot be read back" << std::endl;
+      readable = false;
+    }
+  }
 
   QueueFamilyIndices indices = device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = {indices.graphicsFamily,
@@ -176,8 +341,8 @@ void HtSwapChain::createSwapChain() {
   createInfo.oldSwapchain =
       oldSwapChain == nullptr ? VK_NULL_HANDLE : oldSwapChain->swapChain;
 
-  if (vkCreateSwapchainKHR(device.device(), &createInfo, nullptr, &swapChain) !=
-      VK_SUCCESS) {
+  if (vkCreateSwapchainKHR(device.device(), &createInfo, device.allocator(),
+                           &swapChain) != VK_SUCCESS) {
     throw std::runtime_error("failed to create swap chain!");
   }
 
@@ -209,7 +374,7 @@ void HtSwapChain::createImageViews() {
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr,
+    if (vkCreateImageView(device.device(), &viewInfo, device.allocator(),
                           &swapChainImageViews[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create texture image view!");
     }
@@ -218,7 +383,7 @@ void HtSwapChain::createImageViews() {
 
 void HtSwapChain::createRenderPass() {
   VkAttachmentDescription depthAttachment{};
-  depthAttachment.format = findDepthFormat();
+  depthAttachment.format = depthFormat;
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
   depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -254,15 +419,34 @@ void HtSwapChain::createRenderPass() {
 
   VkSubpassDependency dependency = {};
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
+  // the depth image is shared between frames in flight, so the previous
+  // frame's depth writes must finish before this frame clears it
+  dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
   dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstSubpass = 0;
   dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
                              VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+  // replaces the implicit dependency to BOTTOM_OF_PIPE, so a readback
+  // barrier after the pass (source stage COLOR_ATTACHMENT_OUTPUT) is ordered
+  // after the transition to PRESENT_SRC
+  VkSubpassDependency presentDependency = {};
+  presentDependency.srcSubpass = 0;
+  presentDependency.srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  presentDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  presentDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+  presentDependency.dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  presentDependency.dstAccessMask = 0;
+  std::array<VkSubpassDependency, 2> dependencies = {dependency,
+                                                     presentDependency};
+
   std::array<VkAttachmentDescription, 2> attachments = {colorAttachment,
                                                         depthAttachment};
   VkRenderPassCreateInfo renderPassInfo = {};
@@ -271,10 +455,10 @@ void HtSwapChain::createRenderPass() {
   renderPassInfo.pAttachments = attachments.data();
   renderPassInfo.subpassCount = 1;
   renderPassInfo.pSubpasses = &subpass;
-  renderPassInfo.dependencyCount = 1;
-  renderPassInfo.pDependencies = &dependency;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
 
-  if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr,
+  if (vkCreateRenderPass(device.device(), &renderPassInfo, device.allocator(),
                          &renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
@@ -284,7 +468,7 @@ void HtSwapChain::createFramebuffers() {
   swapChainFramebuffers.resize(imageCount());
   for (size_t i = 0; i < imageCount(); i++) {
     std::array<VkImageView, 2> attachments = {swapChainImageViews[i],
-                                              depthImageViews[i]};
+                                              depthImageView};
 
     VkExtent2D swapChainExtent = getSwapChainExtent();
     VkFramebufferCreateInfo framebufferInfo = {};
@@ -296,7 +480,8 @@ void HtSwapChain::createFramebuffers() {
     framebufferInfo.height = swapChainExtent.height;
     framebufferInfo.layers = 1;
 
-    if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr,
+    if (vkCreateFramebuffer(device.device(), &framebufferInfo,
+                            device.allocator(),
                             &swapChainFramebuffers[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create framebuffer!");
     }
@@ -304,56 +489,103 @@ void HtSwapChain::createFramebuffers() {
 }
 
 void HtSwapChain::createDepthResources() {
-  VkFormat depthFormat = findDepthFormat();
   VkExtent2D swapChainExtent = getSwapChainExtent();
 
-  depthImages.resize(imageCount());
-  depthImageMemorys.resize(imageCount());
-  depthImageViews.resize(imageCount());
-
-  for (int i = 0; i < depthImages.size(); i++) {
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = swapChainExtent.width;
-    imageInfo.extent.height = swapChainExtent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.extent.width = swapChainExtent.width;
+  imageInfo.extent.height = swapChainExtent.height;
+  imageInfo.extent.depth = 1;
+  imageInfo.mipLevels = 1;
+  imageInfo.arrayLayers = 1;
+  imageInfo.format = depthFormat;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.flags = 0;
+
+  // depth is never stored, so on tiled GPUs it can live in tile memory only.
+  // That takes a lazily allocated type among the ones a transient image
+  // allows, otherwise the image is created as a regular attachment
+  VkMemoryPropertyFlags memoryProperties =
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+      VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+  VkImage probeImage;
+  if (vkCreateImage(device.device(), &imageInfo, device.allocator(),
+                    &probeImage) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create image!");
+  }
+  VkMemoryRequirements probeRequirements;
+  vkGetImageMemoryRequirements(device.device(), probeImage,
+                               &probeRequirements);
+  vkDestroyImage(device.device(), probeImage, device.allocator());
+  bool lazy = device.hasMemoryType(probeRequirements.memoryTypeBits,
+                                   memoryProperties);
+  if (!lazy) {
     imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.flags = 0;
-
-    device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                               depthImages[i], depthImageMemorys[i]);
-
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = depthImages[i];
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = depthFormat;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
+    memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+  }
 
-    if (vkCreateImageView(device.device(), &viewInfo, nullptr,
-                          &depthImageViews[i]) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create texture image view!");
-    }
+  device.createImageWithInfo(imageInfo, memoryProperties, depthImage,
+                             depthImageMemory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = depthImage;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = depthFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+
+  if (vkCreateImageView(device.device(), &viewInfo, device.allocator(),
+                        &depthImageView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture image view!");
   }
+
+  // compare against the old layout of one 32-bit depth image per swapchain
+  // image
+  VkMemoryRequirements memRequirements;
+  vkGetImageMemoryRequirements(device.device(), depthImage, &memRequirements);
+  VkDeviceSize previousBytes = static_cast<VkDeviceSize>(imageCount()) *
+                               swapChainExtent.width *
+                               swapChainExtent.height * 4;
+  VkDeviceSize savedBytes = previousBytes > memRequirements.size
+                                ? previousBytes - memRequirements.size
+                                : 0;
+  std::cout << "Depth buffer: 1 shared "
+            << (depthFormat == VK_FORMAT_D16_UNORM ? "D16" : "D32/D24")
+            << " image, " << memRequirements.size / 1024 << " KiB"
+            << (lazy ? " lazily allocated" : "") << ", saved "
+            << savedBytes / 1024 << " KiB" << std::endl;
 }
 
 void HtSwapChain::createSyncObjects() {
+  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+
+  // frames submitted on the old swap chain may still be running, keep their
+  // fences so the frame slots and the deletion queue stay in step
+  if (oldSwapChain != nullptr) {
+    HtSwapChain &previous = *oldSwapChain;
+    imageAvailableSemaphores = std::move(previous.imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(previous.renderFinishedSemaphores);
+    inFlightFences = std::move(previous.inFlightFences);
+    currentFrame = previous.currentFrame;
+    previous.imageAvailableSemaphores.clear();
+    previous.renderFinishedSemaphores.clear();
+    previous.inFlightFences.clear();
+    return;
+  }
+
   imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
   inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -363,11 +595,11 @@ void HtSwapChain::createSyncObjects() {
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
   for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
+    if (vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocator(),
                           &imageAvailableSemaphores[i]) != VK_SUCCESS ||
-        vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr,
+        vkCreateSemaphore(device.device(), &semaphoreInfo, device.allocator(),
                           &renderFinishedSemaphores[i]) != VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr,
+        vkCreateFence(device.device(), &fenceInfo, device.allocator(),
                       &inFlightFences[i]) != VK_SUCCESS) {
       throw std::runtime_error(
           "failed to create synchronization objects for a frame!");
@@ -426,6 +658,15 @@ HtSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
 }
 
 VkFormat HtSwapChain::findDepthFormat() {
+  // 16 bits are plenty for the flat scenes drawn so far, HT_DEPTH_D16=1
+  // halves the depth buffer
+  if (envFlag("HT_DEPTH_D16")) {
+    return device.findSupportedFormat(
+        {VK_FORMAT_D16_UNORM, VK_FORMAT_D32_SFLOAT,
+         VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+        VK_IMAGE_TILING_OPTIMAL,
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+  }
   return device.findSupportedFormat(
       {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT,
        VK_FORMAT_D24_UNORM_S8_UINT},
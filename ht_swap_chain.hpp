@@ -1,12 +1,16 @@
 #pragma once
 
 #include "ht_device.hpp"
+#include "ht_submit_thread.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <array>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -16,7 +20,15 @@ class HtSwapChain {
 public:
   static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
 
-  HtSwapChain(HtDevice &deviceRef, VkExtent2D windowExtent);
+  // readable adds TRANSFER_SRC usage to the images where the surface allows
+  // it, for HtReadbackRing. Without a submit thread frames are submitted and
+  // presented on the calling thread; the thread must outlive the swap chain
+  // and every one recreated from it
+  HtSwapChain(HtDevice &deviceRef, VkExtent2D windowExtent,
+              bool readable = false, HtSubmitThread *submitThread = nullptr);
+  // takes over the frame slots, readability and submit thread of previous,
+  // which may still be in flight and should be destroyed through the
+  // device's deletion queue
   HtSwapChain(HtDevice &deviceRef, VkExtent2D windowExtent,
               std::shared_ptr<HtSwapChain> previous);
   ~HtSwapChain();
@@ -27,21 +39,44 @@ public:
   VkFramebuffer getFrameBuffer(int index) {
     return swapChainFramebuffers[index];
   }
+  // null with dynamic rendering, pipelines are then built against
+  // getSwapChainImageFormat() and getDepthFormat()
   VkRenderPass getRenderPass() { return renderPass; }
+  bool usesDynamicRendering() { return renderPass == VK_NULL_HANDLE; }
+  VkFormat getDepthFormat() { return depthFormat; }
   VkImageView getImageView(int index) { return swapChainImageViews[index]; }
+  VkImage getImage(int index) { return swapChainImages[index]; }
+  // images can be copied from, see the readable constructor argument
+  bool isReadable() { return readable; }
   size_t imageCount() { return swapChainImages.size(); }
   VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
   VkExtent2D getSwapChainExtent() { return swapChainExtent; }
   uint32_t width() { return swapChainExtent.width; }
   uint32_t height() { return swapChainExtent.height; }
+  // frame-in-flight slot used by the next submitCommandBuffers call
+  uint32_t getCurrentFrame() { return static_cast<uint32_t>(currentFrame); }
 
   float extentAspectRatio() {
     return static_cast<float>(swapChainExtent.width) /
            static_cast<float>(swapChainExtent.height);
   }
   VkFormat findDepthFormat();
+  bool compareSwapFormats(const HtSwapChain &other) const {
+    return swapChainImageFormat == other.swapChainImageFormat &&
+           depthFormat == other.depthFormat;
+  }
+
+  // starts drawing into the given image with cleared color and depth, through
+  // the render pass or with dynamic rendering. With secondaryContents the
+  // pass may only execute secondary command buffers
+  void beginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+                      const VkClearColorValue &clearColor,
+                      bool secondaryContents = false);
+  void endRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
   VkResult acquireNextImage(uint32_t *imageIndex);
+  // with a submit thread the frame is only queued, and the result is that of
+  // earlier presents
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers,
                                 uint32_t *imageIndex);
 
@@ -65,11 +100,15 @@ private:
   VkExtent2D swapChainExtent;
 
   std::vector<VkFramebuffer> swapChainFramebuffers;
-  VkRenderPass renderPass;
-
-  std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
-  std::vector<VkImageView> depthImageViews;
+  VkRenderPass renderPass = VK_NULL_HANDLE;
+
+  // one depth attachment shared by every framebuffer: it is cleared on load
+  // and never stored, and the render pass dependency orders each frame's
+  // depth writes after the previous frame's on the graphics queue
+  VkFormat depthFormat;
+  VkImage depthImage;
+  VkDeviceMemory depthImageMemory;
+  VkImageView depthImageView;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
@@ -78,6 +117,16 @@ private:
 
   VkSwapchainKHR swapChain;
   std::shared_ptr<HtSwapChain> oldSwapChain;
+  bool readable;
+  HtSubmitThread *submitThread = nullptr;
+  // from the surface capabilities, acquiring more than imageCount() minus
+  // this many images at once may block forever
+  uint32_t minImageCount = 0;
+  // acquires run on the recording thread and presents on the submit thread
+  std::mutex swapChainMutex;
+  // submit thread tickets of the last frame pushed for each slot and overall
+  std::array<uint64_t, MAX_FRAMES_IN_FLIGHT> frameTickets{};
+  uint64_t lastTicket = 0;
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
@@ -0,0 +1,97 @@
+#include "ht_thread_pool.hpp"
+
+#include "ht_env.hpp"
+
+// std
+#include <algorithm>
+
+namespace ht {
+
+HtThreadPool::HtThreadPool(uint32_t workerCount) {
+  if (workerCount == 0) {
+    uint32_t threads = static_cast<uint32_t>(
+        envNumber("HT_THREADS", std::thread::hardware_concurrency()));
+    workerCount = std::max(threads, 1u) - 1;
+  }
+  workers.reserve(workerCount);
+  for (uint32_t i = 0; i < workerCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+HtThreadPool::~HtThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void HtThreadPool::parallelFor(uint32_t count, uint32_t minChunk,
+                               const RangeFunction &function) {
+  if (count == 0) {
+    return;
+  }
+  // a few chunks per thread even out uneven chunk costs
+  uint32_t chunks = threadCount() * 4;
+  uint32_t size = std::max({minChunk, 1u, (count + chunks - 1) / chunks});
+  if (workers.empty() || size >= count) {
+    function(0, count);
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    job = &function;
+    jobCount = count;
+    chunkSize = size;
+    chunkCount = (count + size - 1) / size;
+    nextChunk = 0;
+    busyWorkers = static_cast<uint32_t>(workers.size());
+    generation++;
+  }
+  wake.notify_all();
+
+  runChunks();
+
+  std::unique_lock<std::mutex> lock{mutex};
+  done.wait(lock, [this]() { return busyWorkers == 0; });
+  job = nullptr;
+}
+
+void HtThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      wake.wait(lock, [&]() {
+        return stopping || generation != seenGeneration;
+      });
+      if (stopping) {
+        return;
+      }
+      seenGeneration = generation;
+    }
+
+    runChunks();
+
+    std::lock_guard<std::mutex> lock{mutex};
+    if (--busyWorkers == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+void HtThreadPool::runChunks() {
+  uint32_t chunk;
+  while ((chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) <
+         chunkCount) {
+    uint32_t begin = chunk * chunkSize;
+    (*job)(begin, std::min(jobCount, begin + chunkSize));
+  }
+}
+
+} // namespace ht
@@ -0,0 +1,59 @@
+#pragma once
+
+// std lib headers
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ht {
+
+// Persistent worker threads for data parallel frame work. parallelFor()
+// hands out chunks of an index range to the workers and the calling thread
+// and returns once every chunk is done, so no thread is created per frame.
+class HtThreadPool {
+public:
+  using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+  // workerCount 0 uses one worker per hardware thread besides the caller,
+  // HT_THREADS=<n> overrides the total thread count
+  explicit HtThreadPool(uint32_t workerCount = 0);
+  ~HtThreadPool();
+
+  HtThreadPool(const HtThreadPool &) = delete;
+  HtThreadPool &operator=(const HtThreadPool &) = delete;
+
+  // workers plus the calling thread
+  uint32_t threadCount() const {
+    return static_cast<uint32_t>(workers.size()) + 1;
+  }
+
+  // runs function over [0, count) in chunks of at least minChunk indices.
+  // Small ranges run inline; one caller at a time
+  void parallelFor(uint32_t count, uint32_t minChunk,
+                   const RangeFunction &function);
+
+private:
+  void workerLoop();
+  void runChunks();
+
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  uint64_t generation = 0;
+  uint32_t busyWorkers = 0;
+  bool stopping = false;
+
+  // current job, published under mutex
+  const RangeFunction *job = nullptr;
+  uint32_t jobCount = 0;
+  uint32_t chunkSize = 0;
+  uint32_t chunkCount = 0;
+  std::atomic<uint32_t> nextChunk{0};
+};
+
+} // namespace ht
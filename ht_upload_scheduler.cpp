@@ -0,0 +1,475 @@
+#include "ht_upload_scheduler.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+namespace ht {
+
+HtUploadScheduler::HtUploadScheduler(HtDevice &device, VkDeviceSize stagingSize)
+    : htDevice{device}, stagingSize{stagingSize} {
+  QueueFamilyIndices indices = htDevice.findPhysicalQueueFamilies();
+  graphicsFamily = indices.graphicsFamily;
+  transferFamily = indices.transferFamilyHasValue ? indices.transferFamily
+                                                  : indices.graphicsFamily;
+  createCommandPools();
+  createStagingRing();
+}
+
+HtUploadScheduler::~HtUploadScheduler() {
+  for (auto &batch : inFlight) {
+    vkWaitForFences(htDevice.device(), 1, &batch.fence, VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+  }
+  collect();
+
+  // uploads that were never submitted are dropped
+  retire(recordingBatch);
+  pendingUploads.clear();
+
+  vkUnmapMemory(htDevice.device(), stagingMemory);
+  vkDestroyBuffer(htDevice.device(), stagingBuffer, htDevice.allocator());
+  vkFreeMemory(htDevice.device(), stagingMemory, htDevice.allocator());
+  vkDestroyCommandPool(htDevice.device(), transferCommandPool,
+                       htDevice.allocator());
+  vkDestroyCommandPool(htDevice.device(), graphicsCommandPool,
+                       htDevice.allocator());
+}
+
+void HtUploadScheduler::createCommandPools() {
+  VkCommandPoolCreateInfo poolInfo = {};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                   VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+  poolInfo.queueFamilyIndex = transferFamily;
+  if (vkCreateCommandPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                          &transferCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create transfer command pool!");
+  }
+
+  poolInfo.queueFamilyIndex = graphicsFamily;
+  if (vkCreateCommandPool(htDevice.device(), &poolInfo, htDevice.allocator(),
+                          &graphicsCommandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload command pool!");
+  }
+}
+
+void HtUploadScheduler::createStagingRing() {
+  htDevice.createBuffer(stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        stagingBuffer, stagingMemory);
+  void *data;
+  vkMapMemory(htDevice.device(), stagingMemory, 0, stagingSize, 0, &data);
+  stagingData = static_cast<uint8_t *>(data);
+}
+
+// batches retire in submission order, so the ring only needs a head and the
+// number of bytes still owned by unfinished batches (wrap padding included)
+bool HtUploadScheduler::allocateFromRing(VkDeviceSize size,
+                                         VkDeviceSize &offset) {
+  VkDeviceSize aligned = (ringHead + 15) & ~VkDeviceSize{15};
+  VkDeviceSize needed;
+  if (aligned + size > stagingSize) {
+    needed = (stagingSize - ringHead) + size;
+    aligned = 0;
+  } else {
+    needed = (aligned - ringHead) + size;
+  }
+
+  if (size > stagingSize || ringUsed + needed > stagingSize) {
+    return false;
+  }
+
+  offset = aligned;
+  ringHead = aligned + size;
+  ringUsed += needed;
+  recordingBatch.ringBytes += needed;
+  return true;
+}
+
+VkBuffer HtUploadScheduler::stage(const void *data, VkDeviceSize size,
+                                  VkDeviceSize &srcOffset) {
+  if (allocateFromRing(size, srcOffset)) {
+    memcpy(stagingData + srcOffset, data, static_cast<size_t>(size));
+    return stagingBuffer;
+  }
+
+  // too large for the ring right now, give it its own staging buffer that
+  // lives as long as the batch
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  htDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                            VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                        buffer, memory);
+  void *mapped;
+  vkMapMemory(htDevice.device(), memory, 0, size, 0, &mapped);
+  memcpy(mapped, data, static_cast<size_t>(size));
+  vkUnmapMemory(htDevice.device(), memory);
+
+  recordingBatch.dedicatedBuffers.push_back(buffer);
+  recordingBatch.dedicatedMemorys.push_back(memory);
+  srcOffset = 0;
+  return buffer;
+}
+
+void HtUploadScheduler::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset,
+                                     const void *data, VkDeviceSize size,
+                                     VkPipelineStageFlags dstStageMask,
+                                     VkAccessFlags dstAccessMask,
+                                     UploadCallback onComplete) {
+  assert(dstStageMask != 0 && "upload needs a destination stage");
+
+  PendingUpload upload{};
+  upload.srcBuffer = stage(data, size, upload.srcOffset);
+  upload.size = size;
+  upload.dstBuffer = dstBuffer;
+  upload.dstOffset = dstOffset;
+  upload.dstStageMask = dstStageMask;
+  upload.dstAccessMask = dstAccessMask;
+  upload.onComplete = std::move(onComplete);
+  pendingUploads.push_back(std::move(upload));
+}
+
+void HtUploadScheduler::uploadImage(VkImage dstImage, uint32_t width,
+                                    uint32_t height, uint32_t layerCount,
+                                    const void *data, VkDeviceSize size,
+                                    VkImageLayout finalLayout,
+                                    VkPipelineStageFlags dstStageMask,
+                                    VkAccessFlags dstAccessMask,
+                                    UploadCallback onComplete) {
+  assert(dstStageMask != 0 && "upload needs a destination stage");
+
+  PendingUpload upload{};
+  upload.srcBuffer = stage(data, size, upload.srcOffset);
+  upload.size = size;
+  upload.dstImage = dstImage;
+  upload.width = width;
+  upload.height = height;
+  upload.layerCount = layerCount;
+  upload.finalLayout = finalLayout;
+  upload.dstStageMask = dstStageMask;
+  upload.dstAccessMask = dstAccessMask;
+  upload.onComplete = std::move(onComplete);
+  pendingUploads.push_back(std::move(upload));
+}
+
+VkCommandBuffer HtUploadScheduler::allocateCommandBuffer(VkCommandPool pool) {
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = pool;
+  allocInfo.commandBufferCount = 1;
+
+  VkCommandBuffer commandBuffer;
+  if (vkAllocateCommandBuffers(htDevice.device(), &allocInfo,
+                               &commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to allocate upload command buffer!");
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  return commandBuffer;
+}
+
+static VkImageSubresourceRange colorSubresourceRange(uint32_t layerCount) {
+  VkImageSubresourceRange range{};
+  range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  range.baseMipLevel = 0;
+  range.levelCount = 1;
+  range.baseArrayLayer = 0;
+  range.layerCount = layerCount;
+  return range;
+}
+
+// records the copies. With releaseOwnership the trailing barriers release the
+// destinations to the graphics family, otherwise they make the writes visible
+// to the destination stages directly
+void HtUploadScheduler::recordTransfer(VkCommandBuffer commandBuffer,
+                                       bool releaseOwnership) {
+  std::vector<VkImageMemoryBarrier> toTransferDst;
+  for (const auto &upload : pendingUploads) {
+    if (upload.dstImage == VK_NULL_HANDLE) {
+      continue;
+    }
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = upload.dstImage;
+    barrier.subresourceRange = colorSubresourceRange(upload.layerCount);
+    toTransferDst.push_back(barrier);
+  }
+  if (!toTransferDst.empty()) {
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+                         nullptr, static_cast<uint32_t>(toTransferDst.size()),
+                         toTransferDst.data());
+  }
+
+  for (const auto &upload : pendingUploads) {
+    if (upload.dstImage == VK_NULL_HANDLE) {
+      VkBufferCopy copyRegion{};
+      copyRegion.srcOffset = upload.srcOffset;
+      copyRegion.dstOffset = upload.dstOffset;
+      copyRegion.size = upload.size;
+      vkCmdCopyBuffer(commandBuffer, upload.srcBuffer, upload.dstBuffer, 1,
+                      &copyRegion);
+    } else {
+      VkBufferImageCopy region{};
+      region.bufferOffset = upload.srcOffset;
+      region.bufferRowLength = 0;
+      region.bufferImageHeight = 0;
+      region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel = 0;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount = upload.layerCount;
+      region.imageOffset = {0, 0, 0};
+      region.imageExtent = {upload.width, upload.height, 1};
+      vkCmdCopyBufferToImage(commandBuffer, upload.srcBuffer, upload.dstImage,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    }
+  }
+
+  std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  VkPipelineStageFlags dstStages = 0;
+  for (const auto &upload : pendingUploads) {
+    dstStages |= upload.dstStageMask;
+    uint32_t srcFamily =
+        releaseOwnership ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dstFamily =
+        releaseOwnership ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    VkAccessFlags dstAccess = releaseOwnership ? 0 : upload.dstAccessMask;
+
+    if (upload.dstImage == VK_NULL_HANDLE) {
+      VkBufferMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = dstAccess;
+      barrier.srcQueueFamilyIndex = srcFamily;
+      barrier.dstQueueFamilyIndex = dstFamily;
+      barrier.buffer = upload.dstBuffer;
+      barrier.offset = upload.dstOffset;
+      barrier.size = upload.size;
+      bufferBarriers.push_back(barrier);
+    } else {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = dstAccess;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = upload.finalLayout;
+      barrier.srcQueueFamilyIndex = srcFamily;
+      barrier.dstQueueFamilyIndex = dstFamily;
+      barrier.image = upload.dstImage;
+      barrier.subresourceRange = colorSubresourceRange(upload.layerCount);
+      imageBarriers.push_back(barrier);
+    }
+  }
+
+  vkCmdPipelineBarrier(
+      commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+      releaseOwnership ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dstStages, 0, 0,
+      nullptr, static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(), static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
+}
+
+// the acquire half of the queue family ownership transfer; must match the
+// release barriers recorded by recordTransfer
+void HtUploadScheduler::recordAcquire(VkCommandBuffer commandBuffer) {
+  std::vector<VkBufferMemoryBarrier> bufferBarriers;
+  std::vector<VkImageMemoryBarrier> imageBarriers;
+  VkPipelineStageFlags dstStages = 0;
+  for (const auto &upload : pendingUploads) {
+    dstStages |= upload.dstStageMask;
+    if (upload.dstImage == VK_NULL_HANDLE) {
+      VkBufferMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = upload.dstAccessMask;
+      barrier.srcQueueFamilyIndex = transferFamily;
+      barrier.dstQueueFamilyIndex = graphicsFamily;
+      barrier.buffer = upload.dstBuffer;
+      barrier.offset = upload.dstOffset;
+      barrier.size = upload.size;
+      bufferBarriers.push_back(barrier);
+    } else {
+      VkImageMemoryBarrier barrier{};
+      barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+      barrier.srcAccessMask = 0;
+      barrier.dstAccessMask = upload.dstAccessMask;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = upload.finalLayout;
+      barrier.srcQueueFamilyIndex = transferFamily;
+      barrier.dstQueueFamilyIndex = graphicsFamily;
+      barrier.image = upload.dstImage;
+      barrier.subresourceRange = colorSubresourceRange(upload.layerCount);
+      imageBarriers.push_back(barrier);
+    }
+  }
+
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                       dstStages, 0, 0, nullptr,
+                       static_cast<uint32_t>(bufferBarriers.size()),
+                       bufferBarriers.data(),
+                       static_cast<uint32_t>(imageBarriers.size()),
+                       imageBarriers.data());
+}
+
+void HtUploadScheduler::submit() {
+  if (pendingUploads.empty()) {
+    return;
+  }
+
+  Batch batch = std::move(recordingBatch);
+  recordingBatch = Batch{};
+
+  VkFenceCreateInfo fenceInfo = {};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(htDevice.device(), &fenceInfo, htDevice.allocator(),
+                    &batch.fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create upload fence!");
+  }
+
+  if (htDevice.hasDedicatedTransferQueue()) {
+    batch.transferCommandBuffer = allocateCommandBuffer(transferCommandPool);
+    recordTransfer(batch.transferCommandBuffer, true);
+    vkEndCommandBuffer(batch.transferCommandBuffer);
+
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(htDevice.device(), &semaphoreInfo,
+                          htDevice.allocator(),
+                          &batch.transferComplete) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create upload semaphore!");
+    }
+
+    VkSubmitInfo transferSubmit{};
+    transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    transferSubmit.commandBufferCount = 1;
+    transferSubmit.pCommandBuffers = &batch.transferCommandBuffer;
+    transferSubmit.signalSemaphoreCount = 1;
+    transferSubmit.pSignalSemaphores = &batch.transferComplete;
+    {
+      std::lock_guard<std::mutex> lock{
+          htDevice.queueMutex(htDevice.transferQueue())};
+      if (vkQueueSubmit(htDevice.transferQueue(), 1, &transferSubmit,
+                        VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload command buffer!");
+      }
+    }
+
+    batch.graphicsCommandBuffer = allocateCommandBuffer(graphicsCommandPool);
+    recordAcquire(batch.graphicsCommandBuffer);
+    vkEndCommandBuffer(batch.graphicsCommandBuffer);
+
+    VkPipelineStageFlags waitStages = 0;
+    for (const auto &upload : pendingUploads) {
+      waitStages |= upload.dstStageMask;
+    }
+
+    VkSubmitInfo acquireSubmit{};
+    acquireSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    acquireSubmit.waitSemaphoreCount = 1;
+    acquireSubmit.pWaitSemaphores = &batch.transferComplete;
+    acquireSubmit.pWaitDstStageMask = &waitStages;
+    acquireSubmit.commandBufferCount = 1;
+    acquireSubmit.pCommandBuffers = &batch.graphicsCommandBuffer;
+    std::lock_guard<std::mutex> lock{
+        htDevice.queueMutex(htDevice.graphicsQueue())};
+    if (vkQueueSubmit(htDevice.graphicsQueue(), 1, &acquireSubmit,
+                      batch.fence) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit upload acquire!");
+    }
+  } else {
+    batch.graphicsCommandBuffer = allocateCommandBuffer(graphicsCommandPool);
+    recordTransfer(batch.graphicsCommandBuffer, false);
+    vkEndCommandBuffer(batch.graphicsCommandBuffer);
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+    std::lock_guard<std::mutex> lock{
+        htDevice.queueMutex(htDevice.graphicsQueue())};
+    if (vkQueueSubmit(htDevice.graphicsQueue(), 1, &submitInfo, batch.fence) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to submit upload command buffer!");
+    }
+  }
+
+  for (auto &upload : pendingUploads) {
+    if (upload.onComplete) {
+      batch.callbacks.push_back(std::move(upload.onComplete));
+    }
+  }
+  pendingUploads.clear();
+  inFlight.push_back(std::move(batch));
+}
+
+void HtUploadScheduler::collect() {
+  while (!inFlight.empty() &&
+         vkGetFenceStatus(htDevice.device(), inFlight.front().fence) ==
+             VK_SUCCESS) {
+    retire(inFlight.front());
+    inFlight.pop_front();
+  }
+}
+
+void HtUploadScheduler::waitIdle() {
+  submit();
+  for (auto &batch : inFlight) {
+    vkWaitForFences(htDevice.device(), 1, &batch.fence, VK_TRUE,
+                    std::numeric_limits<uint64_t>::max());
+  }
+  collect();
+}
+
+void HtUploadScheduler::retire(Batch &batch) {
+  for (auto &callback : batch.callbacks) {
+    callback();
+  }
+
+  if (batch.transferCommandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(htDevice.device(), transferCommandPool, 1,
+                         &batch.transferCommandBuffer);
+  }
+  if (batch.graphicsCommandBuffer != VK_NULL_HANDLE) {
+    vkFreeCommandBuffers(htDevice.device(), graphicsCommandPool, 1,
+                         &batch.graphicsCommandBuffer);
+  }
+  if (batch.transferComplete != VK_NULL_HANDLE) {
+    vkDestroySemaphore(htDevice.device(), batch.transferComplete,
+                       htDevice.allocator());
+  }
+  if (batch.fence != VK_NULL_HANDLE) {
+    vkDestroyFence(htDevice.device(), batch.fence, htDevice.allocator());
+  }
+  for (size_t i = 0; i < batch.dedicatedBuffers.size(); i++) {
+    vkDestroyBuffer(htDevice.device(), batch.dedicatedBuffers[i],
+                    htDevice.allocator());
+    vkFreeMemory(htDevice.device(), batch.dedicatedMemorys[i],
+                 htDevice.allocator());
+  }
+
+  ringUsed -= batch.ringBytes;
+  if (ringUsed == 0) {
+    ringHead = 0;
+  }
+  batch = Batch{};
+}
+
+} // namespace ht
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "ht_device.hpp"
+
+// std lib headers
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace ht {
+
+// Streams buffer and image data to the GPU on the dedicated transfer queue
+// (or the graphics queue when the device has none) without stalling the
+// frame loop. Uploads are batched between calls to submit(); each batch
+// signals a semaphore that the graphics-side ownership acquire waits on, and
+// completion is observed by polling a fence in collect().
+//
+// submit() and collect() must be called from the thread that submits to the
+// graphics queue, once per frame.
+class HtUploadScheduler {
+public:
+  using UploadCallback = std::function<void()>;
+
+  static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32 * 1024 * 1024;
+
+  HtUploadScheduler(HtDevice &device,
+                    VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+  ~HtUploadScheduler();
+
+  HtUploadScheduler(const HtUploadScheduler &) = delete;
+  HtUploadScheduler &operator=(const HtUploadScheduler &) = delete;
+
+  // data is copied into staging memory before returning. dstStageMask and
+  // dstAccessMask describe the first graphics-queue use of the destination
+  void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset,
+                    const void *data, VkDeviceSize size,
+                    VkPipelineStageFlags dstStageMask,
+                    VkAccessFlags dstAccessMask,
+                    UploadCallback onComplete = nullptr);
+  // the image is transitioned from VK_IMAGE_LAYOUT_UNDEFINED to finalLayout
+  void uploadImage(VkImage dstImage, uint32_t width, uint32_t height,
+                   uint32_t layerCount, const void *data, VkDeviceSize size,
+                   VkImageLayout finalLayout, VkPipelineStageFlags dstStageMask,
+                   VkAccessFlags dstAccessMask,
+                   UploadCallback onComplete = nullptr);
+
+  void submit();
+  void collect();
+  void waitIdle();
+  bool idle() const { return pendingUploads.empty() && inFlight.empty(); }
+
+private:
+  struct PendingUpload {
+    VkBuffer srcBuffer;
+    VkDeviceSize srcOffset;
+    VkDeviceSize size;
+    VkBuffer dstBuffer = VK_NULL_HANDLE;
+    VkDeviceSize dstOffset = 0;
+    VkImage dstImage = VK_NULL_HANDLE;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t layerCount = 0;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags dstStageMask;
+    VkAccessFlags dstAccessMask;
+    UploadCallback onComplete;
+  };
+
+  struct Batch {
+    VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE;
+    VkCommandBuffer graphicsCommandBuffer = VK_NULL_HANDLE;
+    VkSemaphore transferComplete = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    VkDeviceSize ringBytes = 0;
+    std::vector<VkBuffer> dedicatedBuffers;
+    std::vector<VkDeviceMemory> dedicatedMemorys;
+    std::vector<UploadCallback> callbacks;
+  };
+
+  void createCommandPools();
+  void createStagingRing();
+  bool allocateFromRing(VkDeviceSize size, VkDeviceSize &offset);
+  VkBuffer stage(const void *data, VkDeviceSize size, VkDeviceSize &srcOffset);
+  VkCommandBuffer allocateCommandBuffer(VkCommandPool pool);
+  void recordTransfer(VkCommandBuffer commandBuffer, bool releaseOwnership);
+  void recordAcquire(VkCommandBuffer commandBuffer);
+  void retire(Batch &batch);
+
+  HtDevice &htDevice;
+  uint32_t graphicsFamily;
+  uint32_t transferFamily;
+  VkCommandPool transferCommandPool;
+  VkCommandPool graphicsCommandPool;
+
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  uint8_t *stagingData;
+  VkDeviceSize stagingSize;
+  VkDeviceSize ringHead = 0;
+  VkDeviceSize ringUsed = 0;
+
+  std::vector<PendingUpload> pendingUploads;
+  Batch recordingBatch;
+  std::deque<Batch> inFlight;
+};
+
+} // namespace ht
@@ -1,5 +1,6 @@
 #include "ht_window.hpp"
 
+#include <iostream>
 #include <stdexcept>
 
 namespace ht {
@@ -15,6 +16,25 @@ HtWindow::~HtWindow() {
 
 bool HtWindow::shouldClose() { return glfwWindowShouldClose(window); }
 
+void HtWindow::requestClose() {
+  glfwSetWindowShouldClose(window, GLFW_TRUE);
+  wakeEventLoop();
+}
+
+void HtWindow::waitEvents() { glfwWaitEvents(); }
+
+void HtWindow::pollEvents() { glfwPollEvents(); }
+
+void HtWindow::wakeEventLoop() { glfwPostEmptyEvent(); }
+
+void HtWindow::pushEvent(const HtWindowEvent &event) {
+  // the render thread is far behind, dropping input beats blocking the
+  // event loop. Size changes are still visible through getExtent()
+  if (!events.tryPush(event)) {
+    std::cerr << "window event queue full, event dropped" << std::endl;
+  }
+}
+
 void HtWindow::initWindow() {
   glfwInit();
   glfwWindowHint(GLFW_CLIENT_API,
@@ -25,10 +45,13 @@ void HtWindow::initWindow() {
       glfwCreateWindow(width, height, windowName.c_str(), nullptr, nullptr);
   glfwSetWindowUserPointer(window, this);
   glfwSetFramebufferSizeCallback(window, framebufferResizeCallback);
+  glfwSetWindowCloseCallback(window, closeCallback);
+  glfwSetKeyCallback(window, keyCallback);
 }
 
-void HtWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface) {
-  if (glfwCreateWindowSurface(instance, window, nullptr, surface) !=
+void HtWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR *surface,
+                                   const VkAllocationCallbacks *allocator) {
+  if (glfwCreateWindowSurface(instance, window, allocator, surface) !=
       VK_SUCCESS) {
     throw std::runtime_error("failed to create window surface!");
   }
@@ -38,9 +61,31 @@ void HtWindow::framebufferResizeCallback(GLFWwindow *window, int width,
                                          int height) {
   auto htWindow =
       reinterpret_cast<HtWindow *>(glfwGetWindowUserPointer(window));
-  htWindow->framebufferResized = true;
   htWindow->width = width;
   htWindow->height = height;
+
+  HtWindowEvent event{HtWindowEvent::Type::Resize};
+  event.width = width;
+  event.height = height;
+  htWindow->pushEvent(event);
+}
+
+void HtWindow::closeCallback(GLFWwindow *window) {
+  auto htWindow =
+      reinterpret_cast<HtWindow *>(glfwGetWindowUserPointer(window));
+  htWindow->pushEvent(HtWindowEvent{HtWindowEvent::Type::Close});
+}
+
+void HtWindow::keyCallback(GLFWwindow *window, int key,
+                           [[maybe_unused]] int scancode, int action,
+                           int mods) {
+  auto htWindow =
+      reinterpret_cast<HtWindow *>(glfwGetWindowUserPointer(window));
+  HtWindowEvent event{HtWindowEvent::Type::Key};
+  event.key = key;
+  event.action = action;
+  event.mods = mods;
+  htWindow->pushEvent(event);
 }
 
 } // namespace ht
\ No newline at end of file
@@ -3,33 +3,62 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "ht_spsc_queue.hpp"
+
+#include <atomic>
 #include <string>
 
 namespace ht {
 
+struct HtWindowEvent {
+  enum class Type { Resize, Close, Key };
+
+  Type type;
+  int width = 0; // Resize, framebuffer size in pixels
+  int height = 0;
+  int key = 0; // Key, GLFW key code, action and modifier bits
+  int action = 0;
+  int mods = 0;
+};
+
+// GLFW callbacks run on the thread that pumps events (the main thread) and
+// forward everything through a lock-free queue, which the render thread
+// drains with pollEvent() at frame boundaries.
 class HtWindow {
 public:
+  static constexpr size_t EVENT_QUEUE_SIZE = 256;
+
   HtWindow(int w, int h, std::string name);
   ~HtWindow();
 
   HtWindow(const HtWindow &) = delete;
   HtWindow &operator=(const HtWindow &) = delete;
 
+  // may be called from any thread
   bool shouldClose();
-
+  void requestClose();
   VkExtent2D getExtent() {
-    return {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
+    return {static_cast<uint32_t>(width.load()),
+            static_cast<uint32_t>(height.load())};
   }
 
-  bool wasWindowResized() { return framebufferResized; }
-  void resetWindowResizedFlag() { framebufferResized = false; }
+  // main thread only, blocks until at least one event has been handled
+  void waitEvents();
+  // main thread only, handles pending events without blocking
+  void pollEvents();
+  // wakes a main thread blocked in waitEvents(), callable from any thread
+  void wakeEventLoop();
+  // render thread only
+  bool pollEvent(HtWindowEvent &event) { return events.tryPop(event); }
 
-  void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface);
+  void createWindowSurface(VkInstance instance, VkSurfaceKHR *surface,
+                           const VkAllocationCallbacks *allocator = nullptr);
 
 private:
-  int width;
-  int height;
-  bool framebufferResized = false;
+  // written by the event thread, read by the render thread
+  std::atomic<int> width;
+  std::atomic<int> height;
+  HtSpscQueue<HtWindowEvent, EVENT_QUEUE_SIZE> events;
 
   std::string windowName;
 
@@ -37,6 +66,10 @@ private:
 
   static void framebufferResizeCallback(GLFWwindow *window, int width,
                                         int height);
+  static void closeCallback(GLFWwindow *window);
+  static void keyCallback(GLFWwindow *window, int key, int scancode,
+                          int action, int mods);
+  void pushEvent(const HtWindowEvent &event);
   void initWindow();
 };
 } // namespace ht
\ No newline at end of file
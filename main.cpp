@@ -1,10 +1,53 @@
 #include "app.hpp"
+#include "ht_command_trace.hpp"
+#include "ht_replayer.hpp"
 
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+// app --replay <trace> [--frames <n>] [--offscreen]
+static void replay(const std::vector<std::string> &args) {
+  if (args.size() < 2) {
+    throw std::runtime_error(
+        "usage: app --replay <trace> [--frames <n>] [--offscreen]");
+  }
+  ht::HtTrace trace = ht::HtCommandTrace::load(args[1]);
+  uint32_t frameCount = static_cast<uint32_t>(trace.frames.size());
+  bool offscreen = false;
+  for (size_t i = 2; i < args.size(); i++) {
+    if (args[i] == "--frames" && i + 1 < args.size()) {
+      frameCount = static_cast<uint32_t>(std::stoul(args[++i]));
+    } else if (args[i] == "--offscreen") {
+      offscreen = true;
+    } else {
+      throw std::runtime_error("unknown replay option: " + args[i]);
+    }
+  }
+
+  // the device needs a surface even offscreen, so a window is always opened
+  VkExtent2D extent = trace.frames[0].extent;
+  ht::HtWindow window{static_cast<int>(extent.width),
+                      static_cast<int>(extent.height), "Replay"};
+  ht::HtDevice device{window};
+  ht::HtReplayer replayer{window, device, trace, offscreen};
+  replayer.run(frameCount);
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (!args.empty() && args[0] == "--replay") {
+    try {
+      replay(args);
+    } catch (const std::exception &e) {
+      std::cerr << e.what() << '\n';
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
 
-int main() {
   ht::App myApp{};
 
   try {
@@ -15,4 +58,4 @@ int main() {
   }
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
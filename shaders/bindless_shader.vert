@@ -0,0 +1,34 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 fragColor;
+
+struct ObjectData {
+  vec2 offset;
+  float boundingRadius;
+  uint drawBatch;
+  vec3 color;
+};
+
+// set 0 is the global bindless table (see HtBindlessTable)
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+  ObjectData objects[];
+}
+objectBuffers[];
+
+layout(push_constant) uniform Push {
+  uint objectBuffer;
+  uint firstObject;
+}
+push;
+
+void main() {
+  ObjectData object =
+      objectBuffers[nonuniformEXT(push.objectBuffer)]
+          .objects[push.firstObject + gl_InstanceIndex];
+  gl_Position = vec4(position + object.offset, 0.0, 1.0);
+  fragColor = object.color;
+}
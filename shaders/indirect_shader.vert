@@ -0,0 +1,25 @@
+#version 450
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+
+layout(location = 0) out vec3 fragColor;
+
+struct ObjectData {
+  vec2 offset;
+  float boundingRadius;
+  uint drawBatch;
+  vec3 color;
+};
+
+// set 0 is the indirect renderer's per-frame set, firstInstance of every
+// indirect command is the object index
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+  ObjectData objects[];
+};
+
+void main() {
+  ObjectData object = objects[gl_InstanceIndex];
+  gl_Position = vec4(position + object.offset, 0.0, 1.0);
+  fragColor = object.color;
+}
@@ -0,0 +1,8 @@
+#version 450
+
+// overdraw variant of every scene fragment shader: each fragment adds one to
+// the count target through additive blending (see HtOverdrawView)
+
+layout(location = 0) out vec4 outCount;
+
+void main() { outCount = vec4(1.0); }
@@ -0,0 +1,28 @@
+#version 450
+
+// maps the overdraw count of each pixel to a heat ramp
+
+layout(location = 0) out vec4 outColour;
+
+layout(set = 0, binding = 0) uniform sampler2D overdrawCount;
+
+layout(push_constant) uniform Push {
+  // count shown at the hot end of the ramp
+  float rampMax;
+}
+push;
+
+// black, blue, green, yellow, red, white at equal steps
+vec3 heat(float t) {
+  const vec3 stops[6] = vec3[](vec3(0.0), vec3(0.0, 0.0, 1.0),
+                               vec3(0.0, 1.0, 0.0), vec3(1.0, 1.0, 0.0),
+                               vec3(1.0, 0.0, 0.0), vec3(1.0));
+  float x = clamp(t, 0.0, 1.0) * 5.0;
+  int i = min(int(x), 4);
+  return mix(stops[i], stops[i + 1], x - float(i));
+}
+
+void main() {
+  float count = texelFetch(overdrawCount, ivec2(gl_FragCoord.xy), 0).r;
+  outColour = vec4(heat(count / push.rampMax), 1.0);
+}
@@ -0,0 +1,8 @@
+#version 450
+
+// fullscreen triangle, the position is already in clip space
+
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec3 color;
+
+void main() { gl_Position = vec4(position, 0.0, 1.0); }